@@ -0,0 +1,900 @@
+/**
+Offline asset processing for ProjectBasics. Run from the ProjectBasics directory, so that model
+paths resolve the same way they do in the game.
+
+	AssetTool bake <model> [--no-flip]       bake one model file
+	AssetTool bake-all <dir> [--no-flip]     bake every model file under a directory
+	AssetTool bench-load <dir> [--only assimp|baked]
+	                                         compare assimpLoad against loadBakedModel
+	AssetTool compress <image>               write a block-compressed .ktx2 next to one image
+	AssetTool compress-all <dir>             compress every image under a directory
+	AssetTool bench-textures <dir>           compare RGBA and compressed uploads and VRAM size
+	AssetTool bench-streaming <image> [bytes per frame]
+	                                         compare a synchronous upload against streaming
+	AssetTool analyze-meshes <dir> [--no-flip]
+	                                         report vertex cache efficiency before and after optimizeMesh
+	AssetTool bench-vertices <dir> [--no-flip]
+	                                         compare float and packed vertices: size, precision, fetch time
+	AssetTool bench-transforms [nodes]       compare recursive and flattened world matrix propagation
+	AssetTool leak-check <dir> [--no-flip]   load and destroy every model, checking that no GL object outlives it
+	AssetTool scene-check                    spawn and despawn scene objects, checking the scene tree stays in step
+*/
+
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <SFML/Window.hpp>
+#include <SFML/Graphics.hpp>
+#include <assimp/Importer.hpp>
+
+#include "AssimpImport.h"
+#include "BakedModel.h"
+#include "MeshOptimizer.h"
+#include "CompressedTexture.h"
+#include "GeometryArena.h"
+#include "GLObject.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "MultiDrawIndirect.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+#include "TransformSystem.h"
+#include "UniformBlocks.h"
+#include "VertexPacking.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * @brief The peak resident set size of this process so far, in bytes.
+ */
+size_t peakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+/**
+ * @brief Every model file Assimp should import under the given directory.
+ */
+std::vector<std::filesystem::path> findModels(const std::filesystem::path& directory) {
+	std::vector<std::filesystem::path> models;
+	for (auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		auto extension = entry.path().extension().string();
+		if (extension == ".gltf" || extension == ".glb" || extension == ".fbx" || extension == ".obj") {
+			models.push_back(entry.path());
+		}
+	}
+	std::sort(models.begin(), models.end());
+	return models;
+}
+
+/**
+ * @brief Every image file the game loads textures from under the given directory.
+ */
+std::vector<std::filesystem::path> findImages(const std::filesystem::path& directory) {
+	std::vector<std::filesystem::path> images;
+	for (auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		auto extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		if (extension == ".png" || extension == ".jpg" || extension == ".jpeg") {
+			images.push_back(entry.path());
+		}
+	}
+	std::sort(images.begin(), images.end());
+	return images;
+}
+
+/**
+ * @brief Runs the given function once and returns how long it took, in milliseconds.
+ */
+double timeMilliseconds(const std::function<void()>& function) {
+	auto start = std::chrono::high_resolution_clock::now();
+	function();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * @brief Makes an offscreen OpenGL context current, for commands that upload to the GPU.
+ */
+sf::Context& glContext() {
+	static sf::Context context;
+	static bool loaded = gladLoadGL();
+	if (!loaded) {
+		std::cout << "ERROR: failed to load OpenGL" << std::endl;
+		exit(1);
+	}
+	return context;
+}
+
+int bake(const std::filesystem::path& model, bool flipTextureCoords) {
+	try {
+		auto imported = importAssimpModel(model.string(), flipTextureCoords);
+		auto output = bakedModelPath(model);
+		writeBakedModel(imported, assimpImportFlags(flipTextureCoords), output);
+		std::cout << model.string() << " -> " << output.string() << " ("
+			<< std::filesystem::file_size(output) / 1024 << " KiB)" << std::endl;
+		return 0;
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << model.string() << ": " << e.what() << std::endl;
+		return 1;
+	}
+}
+
+/**
+ * @brief Writes a .ktx2 copy of the image with a full mip chain, in BC3 if the image has any
+ * transparency and BC1 otherwise.
+ */
+int compress(const std::filesystem::path& imagePath) {
+	sf::Image image;
+	if (!image.loadFromFile(imagePath.string())) {
+		std::cout << "ERROR: " << imagePath.string() << ": failed to load image" << std::endl;
+		return 1;
+	}
+	auto width = image.getSize().x, height = image.getSize().y;
+	auto format = hasTransparency(image.getPixelsPtr(), width, height)
+		? CompressedFormat::BC3_RGBA : CompressedFormat::BC1_RGB;
+
+	try {
+		std::vector<std::vector<uint8_t>> levels;
+		size_t uncompressedBytes = 0;
+		for (auto& level : buildMipChain(image.getPixelsPtr(), width, height)) {
+			levels.push_back(compressLevel(level, format));
+			uncompressedBytes += level.rgba.size();
+		}
+		auto output = compressedTexturePath(imagePath);
+		writeKtx2(output, format, width, height, levels);
+		std::cout << imagePath.string() << " -> " << output.string() << " ("
+			<< (format == CompressedFormat::BC1_RGB ? "BC1" : "BC3") << ", " << levels.size() << " levels, "
+			<< uncompressedBytes / 1024 << " KiB RGBA -> " << std::filesystem::file_size(output) / 1024 << " KiB)"
+			<< std::endl;
+		return 0;
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << imagePath.string() << ": " << e.what() << std::endl;
+		return 1;
+	}
+}
+
+/**
+ * @brief Uploads every image under the directory both as RGBA with glGenerateMipmap and from its
+ * .ktx2 copy, and reports the time each took and the VRAM each level chain occupies.
+ */
+int benchTextures(const std::filesystem::path& directory) {
+	glContext();
+	double rgbaTotal = 0, compressedTotal = 0;
+	size_t rgbaBytesTotal = 0, compressedBytesTotal = 0;
+
+	std::cout << "image, RGBA ms, compressed ms, RGBA KiB, compressed KiB" << std::endl;
+	for (auto& imagePath : findImages(directory)) {
+		if (!isCompressedTextureCurrent(imagePath)) {
+			std::cout << imagePath.string() << ": no current .ktx2 file; run compress-all first" << std::endl;
+			continue;
+		}
+
+		double rgbaMs = 0, compressedMs = 0;
+		size_t rgbaBytes = 0, compressedBytes = 0;
+		try {
+			MappedFile file(compressedTexturePath(imagePath));
+			auto compressed = parseKtx2(file.data(), file.size());
+			if (!TextureRegistry::global().supportsFormat(compressed.format)) {
+				std::cout << imagePath.string() << ": format not supported by this GPU" << std::endl;
+				continue;
+			}
+			for (auto& level : compressed.levels) {
+				compressedBytes += level.size;
+			}
+
+			GLTexture rgbaTexture, compressedTexture;
+			rgbaMs = timeMilliseconds([&]() {
+				sf::Image image;
+				image.loadFromFile(imagePath.string());
+				rgbaTexture = Texture::loadImage(image);
+				rgbaBytes = size_t(image.getSize().x) * image.getSize().y * 4;
+				glFinish();
+			});
+			compressedMs = timeMilliseconds([&]() {
+				compressedTexture = Texture::loadCompressedImage(compressed);
+				glFinish();
+			});
+			// A full mip chain adds a third to the base level.
+			rgbaBytes = rgbaBytes * 4 / 3;
+		}
+		catch (std::runtime_error& e) {
+			std::cout << imagePath.string() << ": " << e.what() << std::endl;
+			continue;
+		}
+
+		rgbaTotal += rgbaMs;
+		compressedTotal += compressedMs;
+		rgbaBytesTotal += rgbaBytes;
+		compressedBytesTotal += compressedBytes;
+		std::cout << imagePath.string() << ", " << rgbaMs << ", " << compressedMs << ", "
+			<< rgbaBytes / 1024 << ", " << compressedBytes / 1024 << std::endl;
+	}
+
+	std::cout << "total, " << rgbaTotal << ", " << compressedTotal << ", "
+		<< rgbaBytesTotal / 1024 << ", " << compressedBytesTotal / 1024 << std::endl;
+	return 0;
+}
+
+/**
+ * @brief Uploads an image synchronously with loadImage, then again through a TextureStreamer
+ * with the given per-frame budget, and reports the longest "frame" each spent uploading.
+ */
+int benchStreaming(const std::filesystem::path& imagePath, size_t bytesPerFrame) {
+	glContext();
+	sf::Image image;
+	if (!image.loadFromFile(imagePath.string())) {
+		std::cout << "ERROR: " << imagePath.string() << ": failed to load image" << std::endl;
+		return 1;
+	}
+
+	GLTexture synchronous;
+	double synchronousMs = timeMilliseconds([&]() {
+		synchronous = Texture::loadImage(image);
+		glFinish();
+	});
+	synchronous.reset();
+
+	// Building the mip chain happens once per image and off the per-frame path, so it is not
+	// counted against either frame time.
+	auto levels = buildMipChain(image.getPixelsPtr(), image.getSize().x, image.getSize().y);
+	TextureStreamer streamer;
+	std::shared_ptr<const TextureEntry> entry;
+	double firstFrameMs = timeMilliseconds([&]() {
+		entry = std::make_shared<const TextureEntry>(TextureStreamer::createTexture(levels), 0, 0, "", nullptr);
+		glFinish();
+	});
+	streamer.enqueue(entry, std::move(levels));
+
+	double longestFrameMs = 0, totalMs = 0;
+	size_t frames = 0;
+	while (!streamer.isIdle()) {
+		double frameMs = timeMilliseconds([&]() {
+			streamer.update(bytesPerFrame);
+			glFinish();
+		});
+		longestFrameMs = std::max(longestFrameMs, frameMs);
+		totalMs += frameMs;
+		frames++;
+	}
+	streamer.clear();
+
+	auto stats = streamer.stats();
+	std::cout << imagePath.string() << " (" << image.getSize().x << "x" << image.getSize().y << ")" << std::endl
+		<< "synchronous: " << synchronousMs << " ms in one frame" << std::endl
+		<< "streamed: " << firstFrameMs << " ms before first use, then " << frames << " frames of at most "
+		<< longestFrameMs << " ms (" << totalMs << " ms total, " << stats.bytesUploaded / 1024 << " KiB, "
+		<< stats.stalls << " stalls)" << std::endl;
+	return 0;
+}
+
+/**
+ * @brief Runs the given draw calls and returns how long the GPU spent on them, in milliseconds.
+ */
+double gpuMilliseconds(const std::function<void()>& draw) {
+	uint32_t query;
+	glGenQueries(1, &query);
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	draw();
+	glEndQuery(GL_TIME_ELAPSED);
+	uint64_t nanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+	glDeleteQueries(1, &query);
+	return nanoseconds / 1e6;
+}
+
+/**
+ * @brief Imports every model under the directory in Assimp's triangle order, then runs
+ * optimizeMesh on each mesh, and reports ACMR and ATVR (for a 16-entry FIFO cache) before and
+ * after, weighted by triangle and vertex count over all the model's meshes.
+ */
+int analyzeMeshes(const std::filesystem::path& directory, bool flipTextureCoords) {
+	std::cout << "model, triangles, vertices, ACMR before, ACMR after, ATVR before, ATVR after, 16-bit meshes"
+		<< std::endl;
+	for (auto& modelPath : findModels(directory)) {
+		// Skip importAssimpModel, which optimizes meshes itself.
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(modelPath.string(), assimpImportFlags(flipTextureCoords));
+		if (scene == nullptr) {
+			std::cout << modelPath.string() << ": " << importer.GetErrorString() << std::endl;
+			continue;
+		}
+		auto imported = processAssimpNode(scene->mRootNode, scene, modelPath);
+		std::vector<const ImportedMesh*> meshes;
+		collectMeshes(imported, meshes);
+
+		size_t triangles = 0, vertices = 0, shortIndexMeshes = 0;
+		double missesBefore = 0, missesAfter = 0;
+		for (auto* mesh : meshes) {
+			auto optimizedVertices = mesh->vertices;
+			auto optimizedFaces = mesh->faces;
+			optimizeMesh(optimizedVertices, optimizedFaces);
+
+			size_t meshTriangles = mesh->faces.size() / 3;
+			missesBefore += analyzeVertexCache(mesh->faces, mesh->vertices.size()).acmr * meshTriangles;
+			missesAfter += analyzeVertexCache(optimizedFaces, optimizedVertices.size()).acmr * meshTriangles;
+			triangles += meshTriangles;
+			vertices += mesh->vertices.size();
+			shortIndexMeshes += optimizedVertices.size() < 65536 ? 1 : 0;
+		}
+		if (triangles == 0) {
+			continue;
+		}
+		std::cout << modelPath.string() << ", " << triangles << ", " << vertices << ", "
+			<< missesBefore / triangles << ", " << missesAfter / triangles << ", "
+			<< missesBefore / vertices << ", " << missesAfter / vertices << ", "
+			<< shortIndexMeshes << "/" << meshes.size() << std::endl;
+	}
+	return 0;
+}
+
+/**
+ * @brief Packs every mesh under the directory and reports the VRAM each vertex format takes, the
+ * largest error packing introduced, and the GPU time to fetch every vertex through the real
+ * vertex shader. Rasterization is disabled, so the timing is vertex fetch and shading only.
+ */
+int benchVertices(const std::filesystem::path& directory, bool flipTextureCoords) {
+	glContext();
+	ShaderProgram program;
+	program.load("shaders/light_perspective.vert", "shaders/lighting.frag");
+	program.activate();
+	FrameConstants frame = {};
+	frame.view = glm::mat4(1);
+	frame.projection = glm::mat4(1);
+	UniformBlocks::global().setFrame(frame);
+	UniformBlocks::global().bindObject(glm::mat4(1));
+	auto& state = GLStateCache::global();
+	state.setEnabled(GL_RASTERIZER_DISCARD, true);
+	const int DRAWS_PER_FORMAT = 50;
+
+	std::cout << "model, vertices, float KiB, packed KiB, max position error (fraction of extent), "
+		<< "max normal error (degrees), max uv error, float fetch ms, packed fetch ms" << std::endl;
+	for (auto& modelPath : findModels(directory)) {
+		ImportedNode imported;
+		try {
+			imported = importAssimpModel(modelPath.string(), flipTextureCoords);
+		}
+		catch (std::runtime_error& e) {
+			std::cout << modelPath.string() << ": " << e.what() << std::endl;
+			continue;
+		}
+		std::vector<const ImportedMesh*> meshes;
+		collectMeshes(imported, meshes);
+
+		std::vector<Vertex3D> floatVertices;
+		std::vector<PackedVertex3D> packedVertices;
+		float_t positionError = 0, normalError = 0, uvError = 0;
+		for (auto* mesh : meshes) {
+			std::vector<PackedVertex3D> packed;
+			auto bounds = packVertices(mesh->vertices.data(), mesh->vertices.size(), packed);
+			float_t extent = std::max({ bounds.scale.x, bounds.scale.y, bounds.scale.z, 1e-6f });
+			for (size_t i = 0; i < packed.size(); i++) {
+				auto& original = mesh->vertices[i];
+				auto unpacked = unpackVertex(packed[i], bounds);
+				positionError = std::max(positionError, glm::length(glm::vec3(unpacked.x - original.x,
+					unpacked.y - original.y, unpacked.z - original.z)) / extent);
+				glm::vec3 normal(original.nx, original.ny, original.nz);
+				if (glm::length(normal) > 0) {
+					float_t cosine = glm::dot(glm::normalize(normal), glm::vec3(unpacked.nx, unpacked.ny, unpacked.nz));
+					normalError = std::max(normalError, glm::degrees(std::acos(std::clamp(cosine, -1.0f, 1.0f))));
+				}
+				uvError = std::max({ uvError, std::abs(unpacked.u - original.u), std::abs(unpacked.v - original.v) });
+			}
+			floatVertices.insert(floatVertices.end(), mesh->vertices.begin(), mesh->vertices.end());
+			packedVertices.insert(packedVertices.end(), packed.begin(), packed.end());
+		}
+
+		double fetchMs[2];
+		for (int packed = 0; packed < 2; packed++) {
+			auto vao = GLVertexArray::generate();
+			state.bindVertexArray(vao.id());
+			auto vbo = GLBuffer::generate();
+			state.bindBuffer(GL_ARRAY_BUFFER, vbo.id());
+			if (packed) {
+				glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex3D), packedVertices.data(),
+					GL_STATIC_DRAW);
+			}
+			else {
+				glBufferData(GL_ARRAY_BUFFER, floatVertices.size() * sizeof(Vertex3D), floatVertices.data(),
+					GL_STATIC_DRAW);
+			}
+			Mesh3D::setVertexLayout(packed ? VertexFormat::Packed : VertexFormat::Float);
+			program.setUniform("packedVertices", packed == 1);
+
+			// One untimed draw, so neither format pays for the first upload to the GPU.
+			glDrawArrays(GL_POINTS, 0, static_cast<int32_t>(floatVertices.size()));
+			fetchMs[packed] = gpuMilliseconds([&]() {
+				for (int i = 0; i < DRAWS_PER_FORMAT; i++) {
+					glDrawArrays(GL_POINTS, 0, static_cast<int32_t>(floatVertices.size()));
+				}
+			});
+			state.bindVertexArray(0);
+		}
+
+		std::cout << modelPath.string() << ", " << floatVertices.size() << ", "
+			<< floatVertices.size() * sizeof(Vertex3D) / 1024 << ", " << packedVertices.size() * sizeof(PackedVertex3D) / 1024
+			<< ", " << positionError << ", " << normalError << ", " << uvError << ", "
+			<< fetchMs[0] << ", " << fetchMs[1] << std::endl;
+	}
+	state.setEnabled(GL_RASTERIZER_DISCARD, false);
+	UniformBlocks::global().clear();
+	return 0;
+}
+
+/**
+ * @brief Loads every model under the directory through assimpLoad and through its baked file,
+ * and reports the time each took. Peak RSS is per process, so "--only" runs one loader at a
+ * time to compare the memory high-water mark of each.
+ */
+int benchLoad(const std::filesystem::path& directory, const std::string& only, bool flipTextureCoords) {
+	glContext();
+	bool runAssimp = only.empty() || only == "assimp";
+	bool runBaked = only.empty() || only == "baked";
+	double assimpTotal = 0, bakedTotal = 0;
+
+	std::cout << "model, assimp ms, baked ms" << std::endl;
+	for (auto& model : findModels(directory)) {
+		if (runBaked && !isBakedModelCurrent(model, assimpImportFlags(flipTextureCoords))) {
+			std::cout << model.string() << ": no current baked file; run bake-all first" << std::endl;
+			continue;
+		}
+
+		double assimpMs = 0, bakedMs = 0;
+		try {
+			if (runAssimp) {
+				assimpMs = timeMilliseconds([&]() { assimpLoad(model.string(), flipTextureCoords); });
+			}
+			if (runBaked) {
+				bakedMs = timeMilliseconds([&]() { loadBakedModel(bakedModelPath(model)); });
+			}
+		}
+		catch (std::runtime_error& e) {
+			std::cout << model.string() << ": " << e.what() << std::endl;
+			continue;
+		}
+		// Make sure all uploads have actually reached the driver before the next model.
+		glFinish();
+
+		assimpTotal += assimpMs;
+		bakedTotal += bakedMs;
+		std::cout << model.string() << ", " << assimpMs << ", " << bakedMs << std::endl;
+	}
+
+	std::cout << "total, " << assimpTotal << ", " << bakedTotal << std::endl;
+	std::cout << "peak RSS: " << peakResidentBytes() / (1024 * 1024) << " MiB" << std::endl;
+	return 0;
+}
+
+/**
+ * @brief Measures the CPU cost of the uniforms set for each mesh drawn: a material, the
+ * packed-vertex uniforms and a sampler. "by name" is the old path, which asked the driver for
+ * every location with glGetUniformLocation; "by handle" uses locations reflected at link time and
+ * skips values that did not change, as Mesh3D and Object3D now do.
+ */
+int benchUniforms(size_t draws) {
+	glContext();
+	ShaderProgram program;
+	program.load("shaders/light_perspective.vert", "shaders/lighting.frag");
+	program.activate();
+	uint32_t programId = program.id();
+
+	// Every draw gets a different material, like distinct objects; the other uniforms repeat.
+	std::vector<glm::vec4> materials(draws);
+	for (size_t i = 0; i < draws; i++) {
+		materials[i] = glm::vec4(0.1f, 0.5f, 1.0f, static_cast<float_t>(i));
+	}
+	glm::vec3 positionOffset(-1), positionScale(2);
+
+	double byNameMs = timeMilliseconds([&]() {
+		for (size_t i = 0; i < draws; i++) {
+			glUniform4fv(glGetUniformLocation(programId, std::string("material").c_str()), 1, &materials[i][0]);
+			glUniform1i(glGetUniformLocation(programId, std::string("packedVertices").c_str()), 1);
+			glUniform3fv(glGetUniformLocation(programId, std::string("positionOffset").c_str()), 1, &positionOffset[0]);
+			glUniform3fv(glGetUniformLocation(programId, std::string("positionScale").c_str()), 1, &positionScale[0]);
+			glUniform1i(glGetUniformLocation(programId, std::string("baseTexture").c_str()), 0);
+		}
+		glFinish();
+	});
+
+	auto material = program.uniform("material");
+	auto packedVertices = program.uniform("packedVertices");
+	auto offset = program.uniform("positionOffset");
+	auto scale = program.uniform("positionScale");
+	auto baseTexture = program.uniform("baseTexture");
+	double byHandleMs = timeMilliseconds([&]() {
+		for (size_t i = 0; i < draws; i++) {
+			program.setUniform(material, materials[i]);
+			program.setUniform(packedVertices, true);
+			program.setUniform(offset, positionOffset);
+			program.setUniform(scale, positionScale);
+			program.setUniform(baseTexture, 0);
+		}
+		glFinish();
+	});
+
+	auto stats = program.stats();
+	std::cout << "path, ms, ns per draw" << std::endl
+		<< "by name, " << byNameMs << ", " << byNameMs * 1e6 / draws << std::endl
+		<< "by handle, " << byHandleMs << ", " << byHandleMs * 1e6 / draws << std::endl
+		<< "handle calls issued: " << stats.issued << ", skipped: " << stats.skipped << std::endl;
+	return 0;
+}
+
+/**
+ * @brief Measures the CPU cost of submitting a frame of distinct meshes through a RenderQueue,
+ * with one instanced draw per mesh and, where the context supports it, with multi-draw indirect.
+ * Every object is its own quad in one GeometryArena, so no two items share a run; submission
+ * cost per frame should stay flat with indirect drawing as the object count grows.
+ */
+int benchDraws(size_t maxObjects) {
+	glContext();
+	// RenderQueue draws to a window; a hidden one serves.
+	sf::ContextSettings settings;
+	settings.depthBits = 24;
+	sf::RenderWindow window(sf::VideoMode{ 64, 64 }, "AssetTool", sf::Style::None, settings);
+	window.setVisible(false);
+	ShaderProgram program;
+	program.load("shaders/light_perspective_instanced.vert", "shaders/lighting.frag");
+	FrameConstants frame = {};
+	frame.view = glm::lookAt(glm::vec3(0, 0, 50), glm::vec3(0), glm::vec3(0, 1, 0));
+	frame.projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+	UniformBlocks::global().setFrame(frame);
+	auto& indirect = MultiDrawIndirect::global();
+	bool indirectSupported = indirect.supported();
+	const int FRAMES = 20;
+
+	std::cout << "objects, path, CPU ms per frame, draw calls" << std::endl;
+	for (size_t objects = std::max<size_t>(maxObjects / 100, 1); objects <= maxObjects; objects *= 10) {
+		auto arena = std::make_shared<GeometryArena>(VertexFormat::Float, objects * 4, objects * 6, 4);
+		std::vector<Object3D> scene;
+		for (size_t i = 0; i < objects; i++) {
+			// Vary the quads slightly, so that they are genuinely different ranges of the arena.
+			float_t size = 0.5f + (i % 7) * 0.05f;
+			Vertex3D quad[] = {
+				{ size, size, 0, 0, 0, 1, 1, 0 },
+				{ size, -size, 0, 0, 0, 1, 1, 1 },
+				{ -size, -size, 0, 0, 0, 1, 0, 1 },
+				{ -size, size, 0, 0, 0, 1, 0, 0 },
+			};
+			uint32_t indices[] = { 2, 1, 3, 3, 1, 0 };
+			std::vector<Mesh3D> meshes;
+			meshes.emplace_back(arena, arena->append(quad, 4, indices, 6), std::vector<Texture>());
+			glm::vec3 position(static_cast<float_t>(i % 100) - 50, static_cast<float_t>(i / 100 % 100) - 50, 0);
+			scene.emplace_back(std::move(meshes), glm::translate(glm::mat4(1), position));
+		}
+		TransformSystem::global().update();
+
+		RenderQueue queue;
+		for (int path = 0; path < (indirectSupported ? 2 : 1); path++) {
+			indirect.setEnabled(path == 1);
+			double cpuMs = 0;
+			// One untimed frame, so neither path pays for growing its buffers.
+			for (int i = 0; i <= FRAMES; i++) {
+				double frameMs = timeMilliseconds([&]() {
+					queue.begin(frame.view, frame.projection);
+					for (auto& object : scene) {
+						queue.submit(object, program);
+					}
+					queue.flush(window);
+				});
+				glFinish();
+				cpuMs += i > 0 ? frameMs : 0;
+			}
+			std::cout << objects << ", " << (path == 1 ? "multi-draw indirect" : "instanced") << ", "
+				<< cpuMs / FRAMES << ", " << queue.stats().drawCalls << std::endl;
+		}
+		indirect.setEnabled(true);
+	}
+	if (!indirectSupported) {
+		std::cout << "multi-draw indirect is not supported by this context" << std::endl;
+	}
+	indirect.clear();
+	UniformBlocks::global().clear();
+	return 0;
+}
+
+/**
+ * @brief Compares two ways of computing the world matrix of every node in a scene of the given
+ * size: recursing through the Object3D hierarchy multiplying each parent's matrix into its
+ * children's, as rendering used to, against TransformSystem::update()'s single pass over flat
+ * arrays. The scene is a forest of trees, each a root with 10 children of 10 children each.
+ * update() only visits the subtrees of nodes that moved, so it is timed twice: with every root
+ * moved before each pass, and with nothing moved, as for static props.
+ */
+int benchTransforms(size_t nodes) {
+	const size_t FANOUT = 10;
+	const size_t TREE_SIZE = 1 + FANOUT + FANOUT * FANOUT;
+	const int PASSES = 20;
+	std::vector<Object3D> scene;
+	scene.reserve(nodes / TREE_SIZE + 1);
+	auto makeNode = [](size_t i) {
+		Object3D node(std::vector<Mesh3D>{});
+		float_t t = static_cast<float_t>(i);
+		node.setPosition(glm::vec3(std::sin(t), std::cos(t), t * 0.01f));
+		node.setOrientation(glm::vec3(t * 0.1f, t * 0.2f, t * 0.3f));
+		node.setScale(glm::vec3(1 + (i % 3) * 0.1f));
+		return node;
+	};
+	size_t created = 0;
+	while (created < nodes) {
+		Object3D root = makeNode(created++);
+		for (size_t c = 0; c < FANOUT && created < nodes; c++) {
+			Object3D child = makeNode(created++);
+			for (size_t g = 0; g < FANOUT && created < nodes; g++) {
+				child.addChild(makeNode(created++));
+			}
+			root.addChild(std::move(child));
+		}
+		scene.push_back(std::move(root));
+	}
+	auto& system = TransformSystem::global();
+	// The first update also sorts the arrays, which scene construction left out of order.
+	system.update();
+
+	std::vector<glm::mat4> recursiveWorld;
+	recursiveWorld.reserve(nodes);
+	std::function<void(const Object3D&, const glm::mat4&)> propagate = [&](const Object3D& object,
+		const glm::mat4& parentMatrix) {
+		recursiveWorld.push_back(parentMatrix * object.getModelMatrix());
+		for (size_t i = 0; i < object.numberOfChildren(); i++) {
+			propagate(object.getChild(i), recursiveWorld.back());
+		}
+	};
+	double recursiveMs = timeMilliseconds([&]() {
+		for (int pass = 0; pass < PASSES; pass++) {
+			recursiveWorld.clear();
+			for (auto& root : scene) {
+				propagate(root, glm::mat4(1));
+			}
+		}
+	}) / PASSES;
+	double movedMs = timeMilliseconds([&]() {
+		for (int pass = 0; pass < PASSES; pass++) {
+			for (auto& root : scene) {
+				root.move(glm::vec3(0));
+			}
+			system.update();
+		}
+	}) / PASSES;
+	auto movedStats = system.stats();
+	double staticMs = timeMilliseconds([&]() {
+		for (int pass = 0; pass < PASSES; pass++) {
+			system.update();
+		}
+	}) / PASSES;
+	auto staticStats = system.stats();
+
+	// Both must agree on every node's world matrix.
+	float_t maxError = 0;
+	size_t next = 0;
+	std::function<void(const Object3D&)> compare = [&](const Object3D& object) {
+		auto difference = object.getWorldMatrix() - recursiveWorld[next++];
+		for (int column = 0; column < 4; column++) {
+			glm::vec4 error = glm::abs(difference[column]);
+			maxError = std::max({ maxError, error.x, error.y, error.z, error.w });
+		}
+		for (size_t i = 0; i < object.numberOfChildren(); i++) {
+			compare(object.getChild(i));
+		}
+	};
+	for (auto& root : scene) {
+		compare(root);
+	}
+
+	std::cout << "nodes: " << created << ", max difference: " << maxError << std::endl
+		<< "path, ms per pass, ns per node, world matrices updated" << std::endl
+		<< "recursive, " << recursiveMs << ", " << recursiveMs * 1e6 / created << ", " << created << std::endl
+		<< "flattened, roots moved, " << movedMs << ", " << movedMs * 1e6 / created << ", "
+		<< movedStats.worldUpdates << std::endl
+		<< "flattened, static, " << staticMs << ", " << staticMs * 1e6 / created << ", "
+		<< staticStats.worldUpdates << std::endl;
+	return 0;
+}
+
+/**
+ * @brief Loads every model under the directory, copies and moves the objects the way scenes and
+ * the model cache do, then destroys them all, and checks that exactly the GL objects and registry
+ * textures that were alive before are alive afterwards. Returns 1 if anything leaked.
+ */
+int leakCheck(const std::filesystem::path& directory, bool flipTextureCoords) {
+	glContext();
+	auto before = liveGLObjects();
+	size_t texturesBefore = TextureRegistry::global().stats().live;
+	GLObjectCounts loaded;
+	size_t texturesLoaded;
+	{
+		std::vector<Object3D> scene;
+		for (auto& model : findModels(directory)) {
+			try {
+				auto object = assimpLoad(model.string(), flipTextureCoords);
+				// The copy shares the original's meshes and textures rather than creating its own.
+				auto copy = object;
+				scene.push_back(std::move(object));
+				scene.push_back(std::move(copy));
+			}
+			catch (std::runtime_error& e) {
+				std::cout << model.string() << ": " << e.what() << std::endl;
+			}
+		}
+		// A mesh built from its own vertices owns its GL objects too.
+		std::vector<Mesh3D> meshes;
+		meshes.push_back(Mesh3D::square({}));
+		scene.push_back(Object3D(std::move(meshes)));
+
+		loaded = liveGLObjects();
+		texturesLoaded = TextureRegistry::global().stats().live;
+	}
+	auto after = liveGLObjects();
+	size_t texturesAfter = TextureRegistry::global().stats().live;
+
+	auto report = [](const char* when, const GLObjectCounts& counts, size_t registryTextures) {
+		std::cout << when << ": " << counts.textures << " textures, " << counts.buffers << " buffers, "
+			<< counts.vertexArrays << " vertex arrays, " << registryTextures << " registry textures" << std::endl;
+	};
+	report("before", before, texturesBefore);
+	report("loaded", loaded, texturesLoaded);
+	report("destroyed", after, texturesAfter);
+	bool leaked = after.textures != before.textures || after.buffers != before.buffers
+		|| after.vertexArrays != before.vertexArrays || texturesAfter != texturesBefore;
+	std::cout << (leaked ? "LEAKED" : "no leaks") << std::endl;
+	return leaked ? 1 : 0;
+}
+
+/**
+ * @brief Spawns and despawns objects in a Scene the way the game does, and checks that its tree
+ * keeps exactly one leaf per object, and that a despawned object's slot never resolves through
+ * the tree, even once an object the tree does not index reuses it. Returns 1 on a mismatch.
+ */
+int sceneCheck() {
+	glContext();
+	auto square = []() {
+		std::vector<Mesh3D> meshes;
+		meshes.push_back(Mesh3D::square({}));
+		return Object3D(std::move(meshes));
+	};
+	bool failed = false;
+	auto check = [&](bool passed, const char* what) {
+		std::cout << (passed ? "ok: " : "FAILED: ") << what << std::endl;
+		failed = failed || !passed;
+	};
+	{
+		Scene scene;
+		scene.objects.insert(square());
+		scene.objects.insert(square());
+		scene.index();
+		check(scene.tree.size() == 2, "index() adds a leaf per object");
+
+		auto spawned = scene.spawn(square());
+		check(scene.tree.size() == 3 && scene.treeHandle(spawned.index) == spawned,
+			"a spawned object resolves through its leaf");
+
+		check(scene.despawn(spawned), "despawn() erases a live object");
+		check(scene.tree.size() == 2 && scene.treeHandle(spawned.index) == ObjectStore::NULL_HANDLE,
+			"a despawned object's leaf leaves with it");
+		check(!scene.despawn(spawned), "despawn() rejects a stale handle");
+
+		// Inserting straight into the store reuses the freed slot under a new generation.
+		auto unindexed = scene.objects.insert(square());
+		check(unindexed.index == spawned.index && scene.treeHandle(unindexed.index) == ObjectStore::NULL_HANDLE,
+			"a reused slot does not resolve until the tree indexes its object");
+		scene.index();
+		check(scene.tree.size() == 3 && scene.treeHandle(unindexed.index) == unindexed,
+			"index() picks up the object in the reused slot");
+
+		size_t reported = 0;
+		scene.tree.queryFrustum(Frustum(glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, -10.0f, 10.0f)),
+			[&](uint32_t value) {
+				reported += scene.treeHandle(value) != ObjectStore::NULL_HANDLE;
+			});
+		check(reported == scene.objects.size(), "every leaf in view resolves to a live object");
+	}
+	std::cout << (failed ? "MISMATCH" : "scene tree in step") << std::endl;
+	return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> args(argv + 1, argv + argc);
+	bool flipTextureCoords = std::find(args.begin(), args.end(), "--no-flip") == args.end();
+	std::string only;
+	auto onlyArg = std::find(args.begin(), args.end(), "--only");
+	if (onlyArg != args.end() && onlyArg + 1 != args.end()) {
+		only = *(onlyArg + 1);
+	}
+
+	if (args.size() >= 2 && args[0] == "bake") {
+		return bake(args[1], flipTextureCoords);
+	}
+	else if (args.size() >= 2 && args[0] == "bake-all") {
+		int failures = 0;
+		for (auto& model : findModels(args[1])) {
+			failures += bake(model, flipTextureCoords);
+		}
+		return failures == 0 ? 0 : 1;
+	}
+	else if (args.size() >= 2 && args[0] == "bench-load") {
+		return benchLoad(args[1], only, flipTextureCoords);
+	}
+	else if (args.size() >= 2 && args[0] == "compress") {
+		return compress(args[1]);
+	}
+	else if (args.size() >= 2 && args[0] == "compress-all") {
+		int failures = 0;
+		for (auto& image : findImages(args[1])) {
+			failures += compress(image);
+		}
+		return failures == 0 ? 0 : 1;
+	}
+	else if (args.size() >= 2 && args[0] == "bench-textures") {
+		return benchTextures(args[1]);
+	}
+	else if (args.size() >= 2 && args[0] == "analyze-meshes") {
+		return analyzeMeshes(args[1], flipTextureCoords);
+	}
+	else if (args.size() >= 2 && args[0] == "bench-vertices") {
+		return benchVertices(args[1], flipTextureCoords);
+	}
+	else if (args.size() >= 1 && args[0] == "bench-uniforms") {
+		size_t draws = args.size() >= 2 ? std::stoul(args[1]) : 100000;
+		return benchUniforms(draws);
+	}
+	else if (args.size() >= 1 && args[0] == "bench-draws") {
+		size_t objects = args.size() >= 2 ? std::stoul(args[1]) : 10000;
+		return benchDraws(objects);
+	}
+	else if (args.size() >= 1 && args[0] == "bench-transforms") {
+		size_t nodes = args.size() >= 2 ? std::stoul(args[1]) : 100000;
+		return benchTransforms(nodes);
+	}
+	else if (args.size() >= 2 && args[0] == "leak-check") {
+		return leakCheck(args[1], flipTextureCoords);
+	}
+	else if (args.size() >= 1 && args[0] == "scene-check") {
+		return sceneCheck();
+	}
+	else if (args.size() >= 2 && args[0] == "bench-streaming") {
+		size_t bytesPerFrame = args.size() >= 3 ? std::stoul(args[2]) : 2 * 1024 * 1024;
+		return benchStreaming(args[1], bytesPerFrame);
+	}
+
+	std::cout << "usage: AssetTool bake <model> [--no-flip]" << std::endl
+		<< "       AssetTool bake-all <dir> [--no-flip]" << std::endl
+		<< "       AssetTool bench-load <dir> [--only assimp|baked]" << std::endl
+		<< "       AssetTool compress <image>" << std::endl
+		<< "       AssetTool compress-all <dir>" << std::endl
+		<< "       AssetTool bench-textures <dir>" << std::endl
+		<< "       AssetTool bench-streaming <image> [bytes per frame]" << std::endl
+		<< "       AssetTool analyze-meshes <dir> [--no-flip]" << std::endl
+		<< "       AssetTool bench-vertices <dir> [--no-flip]" << std::endl
+		<< "       AssetTool bench-uniforms [draws]" << std::endl
+		<< "       AssetTool bench-draws [objects]" << std::endl
+		<< "       AssetTool bench-transforms [nodes]" << std::endl
+		<< "       AssetTool leak-check <dir> [--no-flip]" << std::endl
+		<< "       AssetTool scene-check" << std::endl;
+	return 1;
+}
@@ -1,16 +1,18 @@
 #pragma once
-#include "Object3D.h"
+#include "ObjectStore.h"
 
 /**
 * @brief Represents an abstract animation of an object, manipulating one or more of its
 * attributes over a duration.
 * This is an abstract class that cannot be instantiated.
+* The object is named by handle and looked up in the store on each tick, so an animation whose
+* object was despawned keeps time without touching it.
 */
 class Animation {
 private:
 	float_t m_duration;
 	float_t m_currentTime;
-	Object3D& m_object;
+	ObjectRef m_object;
 
 	/**
 	 * @brief Called when the animation is activated by an Animator.
@@ -18,12 +20,13 @@ private:
 	virtual void startAnimation() {}
 	/**
 	 * @brief Called when the animation is ticked by an Animator.
+	 * @param object the object being animated.
 	 * @param dt the change in time since the last tick.
 	 */
-	virtual void applyAnimation(float_t dt) = 0;
+	virtual void applyAnimation(Object3D& object, float_t dt) = 0;
 
 public:
-	Animation(Object3D& obj, float_t duration) : m_object(obj), m_duration(duration),
+	Animation(ObjectRef obj, float_t duration) : m_object(std::move(obj)), m_duration(duration),
 		m_currentTime(-1) {
 	}
 
@@ -40,14 +43,17 @@ public:
 	/**
 	* @brief The object the animation is manipulating.
 	*/
-	Object3D& object() const { return m_object; }
+	const ObjectRef& object() const { return m_object; }
 
 	/**
-	* @brief Advances the animation by the given interval, in seconds.
+	* @brief Advances the animation by the given interval, in seconds, applying it to the object
+	* if it is still in the store.
 	*/
-	void tick(float_t dt) {
+	void tick(ObjectStore& objects, float_t dt) {
 		m_currentTime += dt;
-		applyAnimation(dt);
+		if (Object3D* object = m_object.resolve(objects)) {
+			applyAnimation(*object, dt);
+		}
 	}
 
 	/**
@@ -63,8 +63,9 @@ public:
 	void start();
 
 	/**
-	 * @brief Advance the animation sequence by the given time interval, in seconds.
+	 * @brief Advance the animation sequence by the given time interval, in seconds, applying it
+	 * to the objects in the given store.
 	 */
-	void tick(float_t dt);
+	void tick(ObjectStore& objects, float_t dt);
 
 };
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "AssetLoader.h"
+#include "BakedModel.h"
+#include "TextureRegistry.h"
+#include <fstream>
+#include <stdexcept>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	/**
+	 * @brief Builds the Object3D hierarchy for an imported node, taking its already-uploaded
+	 * meshes in the same pre-order that collectMeshes produced them.
+	 */
+	Object3D assembleNode(const ImportedNode& node, std::vector<Mesh3D>::iterator& nextMesh) {
+		std::vector<Mesh3D> meshes(std::make_move_iterator(nextMesh),
+			std::make_move_iterator(nextMesh + node.meshes.size()));
+		nextMesh += node.meshes.size();
+
+		auto object = Object3D(std::move(meshes), node.baseTransform);
+		object.setName(node.name);
+		for (auto& child : node.children) {
+			object.addChild(assembleNode(child, nextMesh));
+		}
+		return object;
+	}
+}
+
+AssetLoader::AssetLoader(size_t workerCount, size_t maxPendingUploads)
+	: m_maxPendingUploads(maxPendingUploads), m_activeImports(0), m_stopping(false) {
+	for (auto format : { CompressedFormat::BC1_RGB, CompressedFormat::BC3_RGBA, CompressedFormat::ETC2_RGB,
+		CompressedFormat::ETC2_RGBA }) {
+		if (TextureRegistry::global().supportsFormat(format)) {
+			m_compressedFormats.push_back(format);
+		}
+	}
+	if (workerCount == 0) {
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < workerCount; i++) {
+		m_workers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+}
+
+AssetLoader::~AssetLoader() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_importAvailable.notify_all();
+	m_uploadSpaceAvailable.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+ModelHandle AssetLoader::loadModel(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+	const LodSettings& lodSettings) {
+	auto model = std::make_shared<PendingModel>(path, flipTextureCoords, vertexFormat, lodSettings);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_importQueue.push_back(model);
+	}
+	m_importAvailable.notify_one();
+	return model;
+}
+
+void AssetLoader::workerLoop() {
+	while (true) {
+		ModelHandle model;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_importAvailable.wait(lock, [this]() { return m_stopping || !m_importQueue.empty(); });
+			if (m_stopping) {
+				return;
+			}
+			model = m_importQueue.front();
+			m_importQueue.pop_front();
+			++m_activeImports;
+		}
+
+		importModel(*model);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		--m_activeImports;
+		if (model->m_state == PendingModel::State::Failed) {
+			continue;
+		}
+		m_uploadSpaceAvailable.wait(lock, [this]() {
+			return m_stopping || m_uploadQueue.size() < m_maxPendingUploads;
+		});
+		if (m_stopping) {
+			return;
+		}
+		model->m_state = PendingModel::State::Uploading;
+		m_uploadQueue.push_back(model);
+	}
+}
+
+void AssetLoader::importModel(PendingModel& model) {
+	try {
+		// Prefer an up-to-date baked copy of the model, as ModelCache::load does. Baked files carry
+		// no levels of detail, so models that need them are always imported.
+		bool baked = model.m_lodSettings.ratios.empty()
+			&& isBakedModelCurrent(model.m_path, assimpImportFlags(model.m_flipTextureCoords));
+		model.m_imported = baked
+			? readBakedModel(bakedModelPath(model.m_path), model.m_vertexFormat)
+			: importAssimpModel(model.m_path, model.m_flipTextureCoords, model.m_vertexFormat, model.m_lodSettings);
+
+		// Read, hash and decode every distinct texture the model refers to, so the context
+		// thread only has to look it up in the TextureRegistry or copy its pixels into VRAM.
+		std::vector<const ImportedMesh*> meshes;
+		collectMeshes(model.m_imported, meshes);
+		for (auto* mesh : meshes) {
+			for (auto& tex : mesh->textures) {
+				if (model.m_images.find(tex.path) == model.m_images.end()) {
+					if (readCompressed(tex.path, model.m_images[tex.path])) {
+						continue;
+					}
+					std::ifstream file(tex.path, std::ios::binary);
+					std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+					auto& decoded = model.m_images[tex.path];
+					decoded.contentHash = TextureRegistry::hashContent(bytes.data(), bytes.size());
+					decoded.contentSize = bytes.size();
+					decoded.image.loadFromMemory(bytes.data(), bytes.size());
+				}
+			}
+		}
+	}
+	catch (std::exception& e) {
+		model.m_error = e.what();
+		model.m_state = PendingModel::State::Failed;
+	}
+}
+
+bool AssetLoader::readCompressed(const std::filesystem::path& imagePath, PendingModel::DecodedImage& decoded) const {
+	if (!isCompressedTextureCurrent(imagePath)) {
+		return false;
+	}
+	std::ifstream file(compressedTexturePath(imagePath), std::ios::binary);
+	std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	try {
+		auto format = parseKtx2(bytes.data(), bytes.size()).format;
+		if (std::find(m_compressedFormats.begin(), m_compressedFormats.end(), format) == m_compressedFormats.end()) {
+			return false;
+		}
+	}
+	catch (std::runtime_error&) {
+		return false;
+	}
+	decoded.contentHash = TextureRegistry::hashContent(bytes.data(), bytes.size());
+	decoded.contentSize = bytes.size();
+	decoded.compressed = std::move(bytes);
+	return true;
+}
+
+bool AssetLoader::uploadStep(PendingModel& model) {
+	// Textures first, one per step, releasing each decoded image as soon as it is in VRAM.
+	if (!model.m_images.empty()) {
+		auto image = model.m_images.begin();
+		auto& decoded = image->second;
+		auto& registry = TextureRegistry::global();
+		model.m_uploadedTextures.insert(std::make_pair(image->first, decoded.compressed.empty()
+			? registry.acquire(image->first, decoded.contentHash, decoded.contentSize, decoded.image, "")
+			: registry.acquire(image->first, decoded.contentHash, decoded.contentSize,
+				parseKtx2(decoded.compressed.data(), decoded.compressed.size()), "")));
+		model.m_images.erase(image);
+		return false;
+	}
+
+	if (model.m_meshOrder.empty() && model.m_uploadedMeshes.empty()) {
+		collectMeshes(model.m_imported, model.m_meshOrder);
+		model.m_uploadedMeshes.reserve(model.m_meshOrder.size());
+		model.m_arenas = createGeometryArenas(model.m_meshOrder);
+	}
+
+	// Then meshes, one per step.
+	if (model.m_uploadedMeshes.size() < model.m_meshOrder.size()) {
+		const ImportedMesh& mesh = *model.m_meshOrder[model.m_uploadedMeshes.size()];
+		std::vector<Texture> textures;
+		for (auto& tex : mesh.textures) {
+			Texture texture = model.m_uploadedTextures.at(tex.path);
+			texture.samplerName = tex.samplerName;
+			textures.push_back(std::move(texture));
+		}
+		model.m_uploadedMeshes.push_back(uploadImportedMesh(mesh, model.m_arenas, std::move(textures)));
+		return false;
+	}
+
+	// Finally stitch the uploaded meshes back into the node hierarchy.
+	auto nextMesh = model.m_uploadedMeshes.begin();
+	model.m_object.emplace(assembleNode(model.m_imported, nextMesh));
+	model.m_imported = ImportedNode();
+	model.m_meshOrder.clear();
+	model.m_uploadedMeshes.clear();
+	model.m_arenas.clear();
+	return true;
+}
+
+void AssetLoader::processUploads(float_t budgetSeconds) {
+	auto start = std::chrono::steady_clock::now();
+	auto budget = std::chrono::duration<float_t>(budgetSeconds);
+
+	while (std::chrono::steady_clock::now() - start < budget) {
+		ModelHandle model;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_uploadQueue.empty()) {
+				return;
+			}
+			model = m_uploadQueue.front();
+		}
+
+		if (uploadStep(*model)) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_uploadQueue.pop_front();
+			}
+			model->m_state = PendingModel::State::Ready;
+			m_uploadSpaceAvailable.notify_one();
+		}
+	}
+}
+
+bool AssetLoader::isIdle() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_importQueue.empty() && m_uploadQueue.empty() && m_activeImports == 0;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include "AssimpImport.h"
+#include "CompressedTexture.h"
+
+/**
+ * @brief A model requested from an AssetLoader. The handle becomes ready once the model has been
+ * imported on a worker thread and uploaded to VRAM on the thread that owns the OpenGL context.
+ */
+class PendingModel {
+	friend class AssetLoader;
+
+public:
+	enum class State {
+		// Waiting for, or running on, a worker thread.
+		Importing,
+		// Imported and decoded; waiting for processUploads() to create its GL objects.
+		Uploading,
+		Ready,
+		Failed
+	};
+
+private:
+	std::string m_path;
+	bool m_flipTextureCoords;
+	VertexFormat m_vertexFormat;
+	LodSettings m_lodSettings;
+	std::atomic<State> m_state;
+	std::string m_error;
+
+	/**
+	 * @brief An image file read and decoded by a worker thread. If the image has a usable .ktx2
+	 * copy, the worker reads that instead and leaves the image empty.
+	 */
+	struct DecodedImage {
+		uint64_t contentHash;
+		size_t contentSize;
+		sf::Image image;
+		std::vector<uint8_t> compressed;
+	};
+
+	// Written by the worker thread before the model enters the upload queue.
+	ImportedNode m_imported;
+	std::unordered_map<std::filesystem::path, DecodedImage> m_images;
+
+	// Upload progress, only touched by the context thread.
+	std::vector<const ImportedMesh*> m_meshOrder;
+	std::vector<Mesh3D> m_uploadedMeshes;
+	// Every mesh of the model is appended to the same buffers, one arena per vertex format.
+	GeometryArenas m_arenas;
+	std::unordered_map<std::filesystem::path, Texture> m_uploadedTextures;
+	std::optional<Object3D> m_object;
+
+public:
+	PendingModel(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+		const LodSettings& lodSettings)
+		: m_path(path), m_flipTextureCoords(flipTextureCoords), m_vertexFormat(vertexFormat),
+		m_lodSettings(lodSettings), m_state(State::Importing) {}
+
+	const std::string& path() const { return m_path; }
+	bool flipTextureCoords() const { return m_flipTextureCoords; }
+	VertexFormat vertexFormat() const { return m_vertexFormat; }
+	const LodSettings& lodSettings() const { return m_lodSettings; }
+	State state() const { return m_state; }
+	bool isReady() const { return m_state == State::Ready; }
+	bool hasFailed() const { return m_state == State::Failed; }
+
+	/**
+	 * @brief Why the import failed, if hasFailed().
+	 */
+	const std::string& error() const { return m_error; }
+
+	/**
+	 * @brief The loaded model. Only valid once isReady().
+	 */
+	Object3D& object() { return *m_object; }
+};
+
+using ModelHandle = std::shared_ptr<PendingModel>;
+
+/**
+ * @brief Imports models on a pool of worker threads. Assimp, or reading the model's baked file if
+ * it is current, and image decoding run in the background; the GL objects for each model are created later by processUploads(), which must
+ * be called from the thread that owns the OpenGL context, e.g. once per frame.
+ */
+class AssetLoader {
+private:
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_importAvailable;
+	std::condition_variable m_uploadSpaceAvailable;
+	std::deque<ModelHandle> m_importQueue;
+	std::deque<ModelHandle> m_uploadQueue;
+	// Workers block when this many decoded models are waiting to be uploaded, which bounds how
+	// much decoded data sits in RAM when uploads fall behind.
+	size_t m_maxPendingUploads;
+	size_t m_activeImports;
+	bool m_stopping;
+	// The compressed texture formats the GL context can sample, queried once so that workers can
+	// choose between a .ktx2 file and its source image without touching OpenGL.
+	std::vector<CompressedFormat> m_compressedFormats;
+
+	void workerLoop();
+	void importModel(PendingModel& model);
+
+	/**
+	 * @brief Reads the .ktx2 copy of an image into decoded, if it is current and in a supported
+	 * format. Returns false if the source image must be decoded instead.
+	 */
+	bool readCompressed(const std::filesystem::path& imagePath, PendingModel::DecodedImage& decoded) const;
+
+	/**
+	 * @brief Performs the next GL step (one texture or one mesh) of the given model.
+	 * Returns true once the model is complete.
+	 */
+	bool uploadStep(PendingModel& model);
+
+public:
+	/**
+	 * @brief Starts the worker pool. With no arguments, one worker per hardware thread.
+	 * Must be constructed on the thread that owns the OpenGL context.
+	 */
+	explicit AssetLoader(size_t workerCount = 0, size_t maxPendingUploads = 4);
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	/**
+	 * @brief Queues a model for import, generating levels of detail with the given settings, and
+	 * returns a handle that becomes ready once it is in VRAM.
+	 */
+	ModelHandle loadModel(const std::string& path, bool flipTextureCoords,
+		VertexFormat vertexFormat = VertexFormat::Float, const LodSettings& lodSettings = LodSettings());
+
+	/**
+	 * @brief Creates GL objects for imported models until the given time budget is spent.
+	 * Must be called on the thread that owns the OpenGL context.
+	 */
+	void processUploads(float_t budgetSeconds);
+
+	/**
+	 * @brief True when no model is waiting to be imported or uploaded.
+	 */
+	bool isIdle() const;
+};
@@ -1,4 +1,6 @@
 #include "AssimpImport.h"
+#include "MeshOptimizer.h"
+#include "TextureRegistry.h"
 #include <iostream>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -10,33 +12,22 @@
 const size_t FLOATS_PER_VERTEX = 3;
 const size_t VERTICES_PER_FACE = 3;
 
-std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& loadedTextures) {
-	std::vector<Texture> textures;
+std::vector<ImportedTexture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName,
+	const std::filesystem::path& modelPath) {
+	std::vector<ImportedTexture> textures;
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 	{
 		aiString name;
 		mat->GetTexture(type, i, &name);
-		std::filesystem::path texPath = modelPath.parent_path() / name.C_Str();
-
-		auto existing = loadedTextures.find(texPath);
-		if (existing != loadedTextures.end()) {
-			textures.push_back(existing->second);
-		}
-		else {
-			sf::Image image;
-			image.loadFromFile(texPath.string());
-			Texture tex = Texture::loadImage(image, typeName);
-			textures.push_back(tex);
-			loadedTextures.insert(std::make_pair(texPath, tex));
-		}
+		textures.push_back({ modelPath.parent_path() / name.C_Str(), typeName });
 	}
 	return textures;
 }
 
-Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& loadedTextures) {
-	std::vector<Vertex3D> vertices;
+ImportedMesh fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath) {
+	ImportedMesh imported;
+	std::vector<Vertex3D>& vertices = imported.vertices;
+	vertices.reserve(mesh->mNumVertices);
 
 	for (size_t i = 0; i < mesh->mNumVertices; i++) {
 		auto* tex = mesh->mTextureCoords[0];
@@ -52,7 +43,7 @@ Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::files
 		}
 	}
 
-	std::vector<uint32_t> faces;
+	std::vector<uint32_t>& faces = imported.faces;
 	faces.reserve(mesh->mNumFaces * VERTICES_PER_FACE);
 	for (size_t i = 0; i < mesh->mNumFaces; i++) {
 		faces.push_back(mesh->mFaces[i].mIndices[0]);
@@ -60,37 +51,91 @@ Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::files
 		faces.push_back(mesh->mFaces[i].mIndices[2]);
 	}
 
-	std::vector<Texture> textures = {};
+	std::vector<ImportedTexture>& textures = imported.textures;
 	if (mesh->mMaterialIndex >= 0)
 	{
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
-			aiTextureType_DIFFUSE, "baseTexture", modelPath, loadedTextures);
+		std::vector<ImportedTexture> diffuseMaps = loadMaterialTextures(material,
+			aiTextureType_DIFFUSE, "baseTexture", modelPath);
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		std::vector<Texture> specularMaps = loadMaterialTextures(material,
-			aiTextureType_SPECULAR, "specMap", modelPath, loadedTextures);
+		std::vector<ImportedTexture> specularMaps = loadMaterialTextures(material,
+			aiTextureType_SPECULAR, "specMap", modelPath);
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		std::vector<Texture> normalMaps = loadMaterialTextures(material,
-			aiTextureType_HEIGHT, "normalMap", modelPath, loadedTextures);
+		std::vector<ImportedTexture> normalMaps = loadMaterialTextures(material,
+			aiTextureType_HEIGHT, "normalMap", modelPath);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 		normalMaps = loadMaterialTextures(material,
-			aiTextureType_NORMALS, "normalMap", modelPath, loadedTextures);
+			aiTextureType_NORMALS, "normalMap", modelPath);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 	}
 
-	auto m = Mesh3D(std::move(vertices), std::move(faces), std::move(textures));
-	return m;
+	return imported;
 }
 
 
-Object3D assimpLoad(const std::string& path, bool flipTextureCoords) {
-	Assimp::Importer importer;
-
-	auto options = aiProcessPreset_TargetRealtime_MaxQuality;
+/**
+ * @brief The Assimp post-processing flags used to import a model.
+ */
+uint32_t assimpImportFlags(bool flipTextureCoords) {
+	uint32_t options = aiProcessPreset_TargetRealtime_MaxQuality;
 	if (flipTextureCoords) {
 		options |= aiProcess_FlipUVs;
 	}
-	const aiScene* scene = importer.ReadFile(path, options);
+	return options;
+}
+
+/**
+ * @brief Reorders the triangles and vertices of every mesh in an imported hierarchy for the
+ * GPU's vertex cache, overdraw and vertex fetch.
+ */
+void optimizeImportedMeshes(ImportedNode& node) {
+	for (auto& mesh : node.meshes) {
+		optimizeMesh(mesh.vertices, mesh.faces);
+	}
+	for (auto& child : node.children) {
+		optimizeImportedMeshes(child);
+	}
+}
+
+/**
+ * @brief Generates the levels of detail of every mesh in an imported hierarchy. Must run after
+ * optimizeImportedMeshes, which renumbers the vertices the levels index.
+ */
+void generateImportedLods(ImportedNode& node, const LodSettings& lodSettings) {
+	for (auto& mesh : node.meshes) {
+		mesh.lods = generateLods(mesh.vertices, mesh.faces, lodSettings);
+	}
+	for (auto& child : node.children) {
+		generateImportedLods(child, lodSettings);
+	}
+}
+
+/**
+ * @brief Selects the vertex format of every mesh in an imported hierarchy.
+ */
+void setVertexFormat(ImportedNode& node, VertexFormat vertexFormat) {
+	for (auto& mesh : node.meshes) {
+		mesh.vertexFormat = vertexFormat;
+	}
+	for (auto& child : node.children) {
+		setVertexFormat(child, vertexFormat);
+	}
+}
+
+Object3D assimpLoad(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+	const LodSettings& lodSettings) {
+	return uploadImportedModel(importAssimpModel(path, flipTextureCoords, vertexFormat, lodSettings));
+}
+
+/**
+ * @brief Runs Assimp on the given file and copies the resulting node hierarchy into CPU memory,
+ * without creating any OpenGL objects.
+ */
+ImportedNode importAssimpModel(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+	const LodSettings& lodSettings) {
+	Assimp::Importer importer;
+
+	const aiScene* scene = importer.ReadFile(path, assimpImportFlags(flipTextureCoords));
 
 	// If the import failed, report it
 	if (nullptr == scene) {
@@ -131,41 +176,125 @@ Object3D assimpLoad(const std::string& path, bool flipTextureCoords) {
 		}
 	}*/
 	//auto ret = Object3D(std::make_shared<Mesh3D>(fromAssimpMesh(scene->mMeshes[0], scene, textures)));
-	std::vector<Mesh3D> meshes;
-	std::unordered_map<std::filesystem::path, Texture> loadedTextures;
-	auto ret = processAssimpNode(scene->mRootNode, scene, std::filesystem::path(path), loadedTextures);
+	auto ret = processAssimpNode(scene->mRootNode, scene, std::filesystem::path(path));
+	optimizeImportedMeshes(ret);
+	generateImportedLods(ret, lodSettings);
+	setVertexFormat(ret, vertexFormat);
 
 	// aiNode -> Object3D. the aiNode's mTransformation -> Object3D.m_baseTransform.
 	// The list of meshes in aiNode -> Model3D.
 	return ret;
 }
 
-Object3D processAssimpNode(aiNode* node, const aiScene* scene,
-	const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& loadedTextures) {
+ImportedNode processAssimpNode(aiNode* node, const aiScene* scene,
+	const std::filesystem::path& modelPath) {
+	ImportedNode imported;
+	imported.name = node->mName.C_Str();
 
 	// Load the aiNode's meshes.
-	std::vector<Mesh3D> meshes;
 	for (auto i = 0; i < node->mNumMeshes; i++) {
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.emplace_back(fromAssimpMesh(mesh, scene, modelPath, loadedTextures));
+		imported.meshes.emplace_back(fromAssimpMesh(mesh, scene, modelPath));
 	}
 
-	std::vector<Texture> textures;
-	for (auto& p : loadedTextures) {
-		textures.push_back(p.second);
-	}
-	glm::mat4 baseTransform;
 	for (auto i = 0; i < 4; i++) {
 		for (auto j = 0; j < 4; j++) {
-			baseTransform[i][j] = node->mTransformation[j][i];
+			imported.baseTransform[i][j] = node->mTransformation[j][i];
 		}
 	}
-	auto parent = Object3D(std::move(meshes), baseTransform);
 
 	for (auto i = 0; i < node->mNumChildren; i++) {
-		Object3D child = processAssimpNode(node->mChildren[i], scene, modelPath, loadedTextures);
-		parent.addChild(std::move(child));
+		imported.children.emplace_back(processAssimpNode(node->mChildren[i], scene, modelPath));
+	}
+
+	return imported;
+}
+
+void collectMeshes(const ImportedNode& node, std::vector<const ImportedMesh*>& meshes) {
+	for (auto& mesh : node.meshes) {
+		meshes.push_back(&mesh);
+	}
+	for (auto& child : node.children) {
+		collectMeshes(child, meshes);
+	}
+}
+
+GeometryArenas createGeometryArenas(const std::vector<const ImportedMesh*>& meshes) {
+	struct Size {
+		size_t vertices = 0;
+		size_t indices = 0;
+		size_t largestMesh = 0;
+	};
+	std::map<VertexFormat, Size> sizes;
+	for (auto* mesh : meshes) {
+		auto& size = sizes[mesh->vertexFormat];
+		size.vertices += mesh->vertices.size();
+		size.indices += mesh->faces.size();
+		for (auto& lod : mesh->lods) {
+			size.indices += lod.size();
+		}
+		size.largestMesh = std::max(size.largestMesh, mesh->vertices.size());
+	}
+
+	GeometryArenas arenas;
+	for (auto& [format, size] : sizes) {
+		arenas[format] = std::make_shared<GeometryArena>(format, size.vertices, size.indices, size.largestMesh);
+	}
+	return arenas;
+}
+
+Mesh3D uploadImportedMesh(const ImportedMesh& mesh, const GeometryArenas& arenas, std::vector<Texture>&& textures) {
+	auto& arena = arenas.at(mesh.vertexFormat);
+	auto range = arena->append(mesh.vertices.data(), mesh.vertices.size(), mesh.faces.data(), mesh.faces.size());
+	// Every level binds the same textures.
+	std::vector<Texture> lodTextures = textures;
+	Mesh3D uploaded(arena, range, std::move(textures));
+	for (auto& lod : mesh.lods) {
+		auto lodRange = arena->appendIndices(range, lod.data(), lod.size());
+		uploaded.addLod(Mesh3D(arena, lodRange, std::vector<Texture>(lodTextures)));
+	}
+	return uploaded;
+}
+
+Object3D uploadImportedModel(const ImportedNode& node) {
+	std::vector<const ImportedMesh*> meshes;
+	collectMeshes(node, meshes);
+	return uploadImportedNode(node, createGeometryArenas(meshes));
+}
+
+std::vector<Object3D> uploadImportedModels(const std::vector<const ImportedNode*>& nodes) {
+	std::vector<const ImportedMesh*> meshes;
+	for (auto* node : nodes) {
+		collectMeshes(*node, meshes);
+	}
+	auto arenas = createGeometryArenas(meshes);
+
+	std::vector<Object3D> objects;
+	for (auto* node : nodes) {
+		objects.push_back(uploadImportedNode(*node, arenas));
+	}
+	return objects;
+}
+
+/**
+ * @brief Creates the meshes for an imported node hierarchy in the given arenas, and acquires its
+ * textures from the TextureRegistry.
+ */
+Object3D uploadImportedNode(const ImportedNode& node, const GeometryArenas& arenas) {
+	std::vector<Mesh3D> meshes;
+	for (auto& mesh : node.meshes) {
+		std::vector<Texture> textures;
+		for (auto& tex : mesh.textures) {
+			textures.push_back(TextureRegistry::global().acquire(tex.path, tex.samplerName));
+		}
+		meshes.push_back(uploadImportedMesh(mesh, arenas, std::move(textures)));
+	}
+
+	auto parent = Object3D(std::move(meshes), node.baseTransform);
+	parent.setName(node.name);
+
+	for (auto& child : node.children) {
+		parent.addChild(uploadImportedNode(child, arenas));
 	}
 
 	return parent;
@@ -1,15 +1,94 @@
 #pragma once
+#include "GeometryArena.h"
 #include "Mesh3D.h"
+#include "MeshOptimizer.h"
 #include "Object3D.h"
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <assimp/scene.h>
 
-Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& loadedTextures);
-Object3D assimpLoad(const std::string& path, bool flipTextureCoords);
-Object3D processAssimpNode(aiNode* node, const aiScene* scene,
-	const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& textures);
-std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName,
-	const std::filesystem::path& modelPath,
-	std::unordered_map<std::filesystem::path, Texture>& loadedTextures);
\ No newline at end of file
+/**
+ * @brief A reference from an imported mesh to a texture file, and the sampler it binds to.
+ */
+struct ImportedTexture {
+	std::filesystem::path path;
+	std::string samplerName;
+};
+
+/**
+ * @brief The CPU-side contents of an aiMesh, in the layout Mesh3D uploads to the GPU.
+ */
+struct ImportedMesh {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	std::vector<ImportedTexture> textures;
+	// The layout to upload the vertices in.
+	VertexFormat vertexFormat = VertexFormat::Float;
+	// Index buffers of simplified versions of the mesh over the same vertices, from the most to
+	// the least detailed. Empty unless levels of detail were generated.
+	std::vector<std::vector<uint32_t>> lods;
+};
+
+/**
+ * @brief The CPU-side contents of an aiNode and its children. Nothing in an ImportedNode
+ * touches OpenGL, so it can be produced without a context (e.g. by the offline baker).
+ */
+struct ImportedNode {
+	std::string name;
+	glm::mat4 baseTransform;
+	std::vector<ImportedMesh> meshes;
+	std::vector<ImportedNode> children;
+};
+
+ImportedMesh fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath);
+Object3D assimpLoad(const std::string& path, bool flipTextureCoords,
+	VertexFormat vertexFormat = VertexFormat::Float, const LodSettings& lodSettings = LodSettings());
+uint32_t assimpImportFlags(bool flipTextureCoords);
+ImportedNode importAssimpModel(const std::string& path, bool flipTextureCoords,
+	VertexFormat vertexFormat = VertexFormat::Float, const LodSettings& lodSettings = LodSettings());
+void optimizeImportedMeshes(ImportedNode& node);
+void generateImportedLods(ImportedNode& node, const LodSettings& lodSettings);
+void setVertexFormat(ImportedNode& node, VertexFormat vertexFormat);
+ImportedNode processAssimpNode(aiNode* node, const aiScene* scene,
+	const std::filesystem::path& modelPath);
+std::vector<ImportedTexture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName,
+	const std::filesystem::path& modelPath);
+
+/**
+ * @brief The arenas one upload appends its meshes to, one per vertex format.
+ */
+using GeometryArenas = std::map<VertexFormat, std::shared_ptr<GeometryArena>>;
+
+/**
+ * @brief Appends every mesh of the hierarchy to a list, in pre-order.
+ */
+void collectMeshes(const ImportedNode& node, std::vector<const ImportedMesh*>& meshes);
+
+/**
+ * @brief Creates one GeometryArena for each vertex format the given meshes use, large enough for
+ * all of the meshes in that format.
+ */
+GeometryArenas createGeometryArenas(const std::vector<const ImportedMesh*>& meshes);
+
+/**
+ * @brief Appends an imported mesh, and its levels of detail, to the arena for its vertex format.
+ */
+Mesh3D uploadImportedMesh(const ImportedMesh& mesh, const GeometryArenas& arenas, std::vector<Texture>&& textures);
+
+/**
+ * @brief Uploads an imported model with all of its meshes merged into shared buffers.
+ */
+Object3D uploadImportedModel(const ImportedNode& node);
+
+/**
+ * @brief Uploads several imported models (e.g. everything in a scene) into one set of shared
+ * buffers, so that all of their meshes draw from the same vertex array.
+ */
+std::vector<Object3D> uploadImportedModels(const std::vector<const ImportedNode*>& nodes);
+
+/**
+ * @brief Uploads one node of an imported model, appending its meshes to the given arenas, which
+ * must have been created for a list of meshes that includes them.
+ */
+Object3D uploadImportedNode(const ImportedNode& node, const GeometryArenas& arenas);
@@ -0,0 +1,363 @@
+#include "BakedModel.h"
+#include "GeometryArena.h"
+#include "MappedFile.h"
+#include "TextureRegistry.h"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	const char BAKED_MAGIC[4] = { 'B', 'M', 'D', 'L' };
+	// Increase whenever the layout of any record below, or of Vertex3D, changes.
+	// Version 2: meshes are stored in the order produced by optimizeMesh.
+	const uint32_t BAKED_VERSION = 2;
+	// Each section of the file starts on this boundary, so the vertex blob can be handed
+	// to glBufferData without an unaligned copy.
+	const uint64_t SECTION_ALIGNMENT = 16;
+
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t importFlags;
+		uint32_t nodeCount;
+		uint32_t meshCount;
+		uint32_t textureCount;
+		uint64_t nodesOffset;
+		uint64_t meshesOffset;
+		uint64_t texturesOffset;
+		uint64_t stringsOffset;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+	};
+
+	// Nodes are stored in pre-order: each node is followed by its childCount subtrees.
+	struct NodeRecord {
+		float baseTransform[16];
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t firstMesh;
+		uint32_t meshCount;
+		uint32_t childCount;
+		uint32_t padding;
+	};
+
+	struct MeshRecord {
+		uint64_t firstVertex;
+		uint64_t firstIndex;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t firstTexture;
+		uint32_t textureCount;
+	};
+
+	// Texture paths are stored relative to the directory of the baked file.
+	struct TextureRecord {
+		uint32_t pathOffset;
+		uint32_t pathLength;
+		uint32_t samplerOffset;
+		uint32_t samplerLength;
+	};
+
+	static_assert(sizeof(FileHeader) == 72, "FileHeader layout changed; bump BAKED_VERSION");
+	static_assert(sizeof(NodeRecord) == 88, "NodeRecord layout changed; bump BAKED_VERSION");
+	static_assert(sizeof(MeshRecord) == 32, "MeshRecord layout changed; bump BAKED_VERSION");
+	static_assert(sizeof(TextureRecord) == 16, "TextureRecord layout changed; bump BAKED_VERSION");
+
+	/**
+	 * @brief The flattened contents of a baked file, accumulated while walking an ImportedNode tree.
+	 */
+	struct BakeTables {
+		std::vector<NodeRecord> nodes;
+		std::vector<MeshRecord> meshes;
+		std::vector<TextureRecord> textures;
+		std::string strings;
+		std::vector<Vertex3D> vertices;
+		std::vector<uint32_t> indices;
+		std::filesystem::path baseDirectory;
+
+		uint32_t addString(const std::string& str) {
+			auto offset = static_cast<uint32_t>(strings.size());
+			strings += str;
+			return offset;
+		}
+	};
+
+	void flattenNode(const ImportedNode& node, BakeTables& tables) {
+		NodeRecord record{};
+		std::memcpy(record.baseTransform, &node.baseTransform[0][0], sizeof(record.baseTransform));
+		record.nameOffset = tables.addString(node.name);
+		record.nameLength = static_cast<uint32_t>(node.name.size());
+		record.firstMesh = static_cast<uint32_t>(tables.meshes.size());
+		record.meshCount = static_cast<uint32_t>(node.meshes.size());
+		record.childCount = static_cast<uint32_t>(node.children.size());
+		tables.nodes.push_back(record);
+
+		for (auto& mesh : node.meshes) {
+			MeshRecord meshRecord{};
+			meshRecord.firstVertex = tables.vertices.size();
+			meshRecord.firstIndex = tables.indices.size();
+			meshRecord.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+			meshRecord.indexCount = static_cast<uint32_t>(mesh.faces.size());
+			meshRecord.firstTexture = static_cast<uint32_t>(tables.textures.size());
+			meshRecord.textureCount = static_cast<uint32_t>(mesh.textures.size());
+			tables.meshes.push_back(meshRecord);
+
+			tables.vertices.insert(tables.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			tables.indices.insert(tables.indices.end(), mesh.faces.begin(), mesh.faces.end());
+			for (auto& tex : mesh.textures) {
+				std::string relative = tex.path.lexically_relative(tables.baseDirectory).generic_string();
+				TextureRecord texRecord{};
+				texRecord.pathOffset = tables.addString(relative);
+				texRecord.pathLength = static_cast<uint32_t>(relative.size());
+				texRecord.samplerOffset = tables.addString(tex.samplerName);
+				texRecord.samplerLength = static_cast<uint32_t>(tex.samplerName.size());
+				tables.textures.push_back(texRecord);
+			}
+		}
+
+		for (auto& child : node.children) {
+			flattenNode(child, tables);
+		}
+	}
+
+	uint64_t alignUp(uint64_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+	}
+
+	/**
+	 * @brief Bounds-checked access to the sections of a mapped baked file.
+	 */
+	struct BakedView {
+		const uint8_t* data;
+		size_t size;
+		const FileHeader* header;
+		std::filesystem::path baseDirectory;
+		VertexFormat vertexFormat;
+		// Every mesh in the file is appended to this one set of buffers.
+		std::shared_ptr<GeometryArena> arena;
+
+		template <typename T>
+		const T* section(uint64_t offset, uint64_t count) const {
+			if (offset > size || count * sizeof(T) > size - offset) {
+				throw std::runtime_error("Baked model file is truncated");
+			}
+			return reinterpret_cast<const T*>(data + offset);
+		}
+
+		std::string string(uint32_t offset, uint32_t length) const {
+			const char* strings = section<char>(header->stringsOffset + offset, length);
+			return std::string(strings, length);
+		}
+	};
+
+	Object3D buildNode(const BakedView& view, uint32_t& nodeIndex) {
+		const auto& header = *view.header;
+		const NodeRecord& record = view.section<NodeRecord>(header.nodesOffset, header.nodeCount)[nodeIndex++];
+		const MeshRecord* meshes = view.section<MeshRecord>(header.meshesOffset, header.meshCount);
+		const TextureRecord* textures = view.section<TextureRecord>(header.texturesOffset, header.textureCount);
+
+		if (record.firstMesh + static_cast<uint64_t>(record.meshCount) > header.meshCount) {
+			throw std::runtime_error("Baked model node refers to a missing mesh");
+		}
+
+		std::vector<Mesh3D> nodeMeshes;
+		nodeMeshes.reserve(record.meshCount);
+		for (uint32_t i = record.firstMesh; i < record.firstMesh + record.meshCount; i++) {
+			const MeshRecord& mesh = meshes[i];
+			if (mesh.firstTexture + static_cast<uint64_t>(mesh.textureCount) > header.textureCount) {
+				throw std::runtime_error("Baked model mesh refers to a missing texture");
+			}
+
+			std::vector<Texture> meshTextures;
+			for (uint32_t t = mesh.firstTexture; t < mesh.firstTexture + mesh.textureCount; t++) {
+				auto path = view.baseDirectory / view.string(textures[t].pathOffset, textures[t].pathLength);
+				auto sampler = view.string(textures[t].samplerOffset, textures[t].samplerLength);
+				meshTextures.push_back(TextureRegistry::global().acquire(path, sampler));
+			}
+
+			// Vertices and indices go from the mapped file to glBufferSubData with no copy in between
+			// (packed meshes quantize the vertices, and small meshes narrow their indices, first).
+			const Vertex3D* vertices = view.section<Vertex3D>(
+				header.verticesOffset + mesh.firstVertex * sizeof(Vertex3D), mesh.vertexCount);
+			const uint32_t* indices = view.section<uint32_t>(
+				header.indicesOffset + mesh.firstIndex * sizeof(uint32_t), mesh.indexCount);
+			auto range = view.arena->append(vertices, mesh.vertexCount, indices, mesh.indexCount);
+			nodeMeshes.emplace_back(view.arena, range, std::move(meshTextures));
+		}
+
+		glm::mat4 baseTransform;
+		std::memcpy(&baseTransform[0][0], record.baseTransform, sizeof(record.baseTransform));
+		auto object = Object3D(std::move(nodeMeshes), baseTransform);
+		object.setName(view.string(record.nameOffset, record.nameLength));
+
+		for (uint32_t i = 0; i < record.childCount; i++) {
+			if (nodeIndex >= header.nodeCount) {
+				throw std::runtime_error("Baked model hierarchy is truncated");
+			}
+			object.addChild(buildNode(view, nodeIndex));
+		}
+		return object;
+	}
+
+	/**
+	 * @brief Reads a node and its subtree into CPU memory, the way buildNode uploads them.
+	 */
+	ImportedNode readNode(const BakedView& view, uint32_t& nodeIndex) {
+		const auto& header = *view.header;
+		const NodeRecord& record = view.section<NodeRecord>(header.nodesOffset, header.nodeCount)[nodeIndex++];
+		const MeshRecord* meshes = view.section<MeshRecord>(header.meshesOffset, header.meshCount);
+		const TextureRecord* textures = view.section<TextureRecord>(header.texturesOffset, header.textureCount);
+
+		if (record.firstMesh + static_cast<uint64_t>(record.meshCount) > header.meshCount) {
+			throw std::runtime_error("Baked model node refers to a missing mesh");
+		}
+
+		ImportedNode node;
+		node.name = view.string(record.nameOffset, record.nameLength);
+		std::memcpy(&node.baseTransform[0][0], record.baseTransform, sizeof(record.baseTransform));
+		node.meshes.resize(record.meshCount);
+		for (uint32_t i = 0; i < record.meshCount; i++) {
+			const MeshRecord& mesh = meshes[record.firstMesh + i];
+			if (mesh.firstTexture + static_cast<uint64_t>(mesh.textureCount) > header.textureCount) {
+				throw std::runtime_error("Baked model mesh refers to a missing texture");
+			}
+
+			ImportedMesh& imported = node.meshes[i];
+			for (uint32_t t = mesh.firstTexture; t < mesh.firstTexture + mesh.textureCount; t++) {
+				imported.textures.push_back(ImportedTexture{
+					view.baseDirectory / view.string(textures[t].pathOffset, textures[t].pathLength),
+					view.string(textures[t].samplerOffset, textures[t].samplerLength) });
+			}
+			const Vertex3D* vertices = view.section<Vertex3D>(
+				header.verticesOffset + mesh.firstVertex * sizeof(Vertex3D), mesh.vertexCount);
+			const uint32_t* indices = view.section<uint32_t>(
+				header.indicesOffset + mesh.firstIndex * sizeof(uint32_t), mesh.indexCount);
+			imported.vertices.assign(vertices, vertices + mesh.vertexCount);
+			imported.faces.assign(indices, indices + mesh.indexCount);
+			imported.vertexFormat = view.vertexFormat;
+		}
+
+		for (uint32_t i = 0; i < record.childCount; i++) {
+			if (nodeIndex >= header.nodeCount) {
+				throw std::runtime_error("Baked model hierarchy is truncated");
+			}
+			node.children.push_back(readNode(view, nodeIndex));
+		}
+		return node;
+	}
+
+	/**
+	 * @brief A view of a mapped baked file, after checking that it is one this version can read.
+	 */
+	BakedView openView(const MappedFile& file, const std::filesystem::path& bakedPath, VertexFormat vertexFormat) {
+		BakedView view{ file.data(), file.size(), nullptr, bakedPath.parent_path(), vertexFormat, nullptr };
+		view.header = view.section<FileHeader>(0, 1);
+		if (std::memcmp(view.header->magic, BAKED_MAGIC, sizeof(BAKED_MAGIC)) != 0) {
+			throw std::runtime_error(bakedPath.string() + " is not a baked model");
+		}
+		if (view.header->version != BAKED_VERSION) {
+			throw std::runtime_error(bakedPath.string() + " was baked by an incompatible version");
+		}
+		if (view.header->nodeCount == 0) {
+			throw std::runtime_error(bakedPath.string() + " has no root node");
+		}
+		return view;
+	}
+
+	bool readHeader(const std::filesystem::path& bakedPath, FileHeader& header) {
+		std::ifstream file(bakedPath, std::ios::binary);
+		return file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			&& std::memcmp(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC)) == 0
+			&& header.version == BAKED_VERSION;
+	}
+}
+
+std::filesystem::path bakedModelPath(const std::filesystem::path& modelPath) {
+	auto baked = modelPath;
+	baked += ".baked";
+	return baked;
+}
+
+bool isBakedModelCurrent(const std::filesystem::path& modelPath, uint32_t importFlags) {
+	std::error_code error;
+	auto bakedPath = bakedModelPath(modelPath);
+	auto bakedTime = std::filesystem::last_write_time(bakedPath, error);
+	if (error) {
+		return false;
+	}
+	auto modelTime = std::filesystem::last_write_time(modelPath, error);
+	if (error || modelTime > bakedTime) {
+		return false;
+	}
+
+	FileHeader header;
+	return readHeader(bakedPath, header) && header.importFlags == importFlags;
+}
+
+void writeBakedModel(const ImportedNode& root, uint32_t importFlags, const std::filesystem::path& bakedPath) {
+	BakeTables tables;
+	tables.baseDirectory = bakedPath.parent_path();
+	flattenNode(root, tables);
+
+	FileHeader header{};
+	std::memcpy(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC));
+	header.version = BAKED_VERSION;
+	header.importFlags = importFlags;
+	header.nodeCount = static_cast<uint32_t>(tables.nodes.size());
+	header.meshCount = static_cast<uint32_t>(tables.meshes.size());
+	header.textureCount = static_cast<uint32_t>(tables.textures.size());
+	header.nodesOffset = alignUp(sizeof(FileHeader));
+	header.meshesOffset = alignUp(header.nodesOffset + tables.nodes.size() * sizeof(NodeRecord));
+	header.texturesOffset = alignUp(header.meshesOffset + tables.meshes.size() * sizeof(MeshRecord));
+	header.stringsOffset = alignUp(header.texturesOffset + tables.textures.size() * sizeof(TextureRecord));
+	header.verticesOffset = alignUp(header.stringsOffset + tables.strings.size());
+	header.indicesOffset = alignUp(header.verticesOffset + tables.vertices.size() * sizeof(Vertex3D));
+
+	std::ofstream file(bakedPath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to create " + bakedPath.string());
+	}
+
+	auto writeSection = [&file](uint64_t offset, const void* data, size_t bytes) {
+		static const char zeros[SECTION_ALIGNMENT] = {};
+		auto position = static_cast<uint64_t>(file.tellp());
+		file.write(zeros, offset - position);
+		file.write(static_cast<const char*>(data), bytes);
+	};
+	writeSection(0, &header, sizeof(header));
+	writeSection(header.nodesOffset, tables.nodes.data(), tables.nodes.size() * sizeof(NodeRecord));
+	writeSection(header.meshesOffset, tables.meshes.data(), tables.meshes.size() * sizeof(MeshRecord));
+	writeSection(header.texturesOffset, tables.textures.data(), tables.textures.size() * sizeof(TextureRecord));
+	writeSection(header.stringsOffset, tables.strings.data(), tables.strings.size());
+	writeSection(header.verticesOffset, tables.vertices.data(), tables.vertices.size() * sizeof(Vertex3D));
+	writeSection(header.indicesOffset, tables.indices.data(), tables.indices.size() * sizeof(uint32_t));
+
+	if (!file) {
+		throw std::runtime_error("Failed to write " + bakedPath.string());
+	}
+}
+
+Object3D loadBakedModel(const std::filesystem::path& bakedPath, VertexFormat vertexFormat) {
+	MappedFile file(bakedPath);
+	BakedView view = openView(file, bakedPath, vertexFormat);
+
+	const MeshRecord* meshes = view.section<MeshRecord>(view.header->meshesOffset, view.header->meshCount);
+	size_t vertexCount = 0, indexCount = 0, largestMesh = 0;
+	for (uint32_t i = 0; i < view.header->meshCount; i++) {
+		vertexCount += meshes[i].vertexCount;
+		indexCount += meshes[i].indexCount;
+		largestMesh = std::max<size_t>(largestMesh, meshes[i].vertexCount);
+	}
+	view.arena = std::make_shared<GeometryArena>(vertexFormat, vertexCount, indexCount, largestMesh);
+
+	uint32_t nodeIndex = 0;
+	return buildNode(view, nodeIndex);
+}
+
+ImportedNode readBakedModel(const std::filesystem::path& bakedPath, VertexFormat vertexFormat) {
+	MappedFile file(bakedPath);
+	BakedView view = openView(file, bakedPath, vertexFormat);
+	uint32_t nodeIndex = 0;
+	return readNode(view, nodeIndex);
+}
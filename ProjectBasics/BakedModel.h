@@ -0,0 +1,42 @@
+#pragma once
+#include <filesystem>
+#include "AssimpImport.h"
+
+/**
+ * A baked model is a single binary file holding everything assimpLoad would produce for one
+ * model file: the node hierarchy with base transforms, vertices already in the Vertex3D layout,
+ * 32-bit face indices, and the texture files each mesh binds. Loading one maps the file and
+ * uploads the vertex and index blobs straight from the mapping, without running Assimp or
+ * copying geometry into intermediate vectors.
+ *
+ * Baked files are written next to the model they came from, by the AssetTool "bake" command.
+ */
+
+/**
+ * @brief The path of the baked file for the model at the given path.
+ */
+std::filesystem::path bakedModelPath(const std::filesystem::path& modelPath);
+
+/**
+ * @brief True if the model at the given path has a baked file that was written by this version
+ * of the format, with the given Assimp flags, after the model file was last modified.
+ */
+bool isBakedModelCurrent(const std::filesystem::path& modelPath, uint32_t importFlags);
+
+/**
+ * @brief Writes an imported model hierarchy to a baked file.
+ */
+void writeBakedModel(const ImportedNode& root, uint32_t importFlags, const std::filesystem::path& bakedPath);
+
+/**
+ * @brief Loads a baked file into VRAM, in the given vertex format. Throws std::runtime_error if
+ * the file is not a valid baked model.
+ */
+Object3D loadBakedModel(const std::filesystem::path& bakedPath, VertexFormat vertexFormat = VertexFormat::Float);
+
+/**
+ * @brief Reads a baked file into CPU memory, as importAssimpModel would have imported the model,
+ * without touching OpenGL (e.g. on an AssetLoader worker thread). Throws std::runtime_error if
+ * the file is not a valid baked model.
+ */
+ImportedNode readBakedModel(const std::filesystem::path& bakedPath, VertexFormat vertexFormat = VertexFormat::Float);
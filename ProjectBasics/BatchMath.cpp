@@ -0,0 +1,335 @@
+#include "BatchMath.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BATCH_MATH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic in any function; GCC and Clang only inside functions marked with
+// the instruction sets they use, so that the rest of the program keeps the baseline ones.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BATCH_TARGET(isa)
+#else
+#define BATCH_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+	void propagateScalar(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, size_t begin,
+		size_t end, uint32_t noParent) {
+		for (size_t i = begin; i < end; i++) {
+			uint32_t parent = parents[i];
+			worlds[i] = parent == noParent ? locals[i] : worlds[parent] * locals[i];
+		}
+	}
+
+	void multiplyScalar(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = left * right[i];
+		}
+	}
+
+	void normalMatricesScalar(const glm::mat4* models, glm::mat4* out, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = glm::mat4(glm::transpose(glm::inverse(glm::mat3(models[i]))));
+		}
+	}
+
+#ifdef BATCH_MATH_X86
+	// Normal matrices are the columns cross(m1, m2), cross(m2, m0) and cross(m0, m1) of a model
+	// matrix's upper 3x3, over its determinant dot(m0, cross(m1, m2)). Every kernel computes them
+	// that way, with in-lane shuffles, so wider registers simply hold more matrices.
+
+	BATCH_TARGET("sse4.1") inline __m128 loadColumn(const glm::mat4& m, int column) {
+		return _mm_loadu_ps(&m[column][0]);
+	}
+
+	BATCH_TARGET("sse4.1") inline __m128 cross(__m128 a, __m128 b) {
+		__m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	BATCH_TARGET("sse4.1") void normalMatricesSSE41(const glm::mat4* models, glm::mat4* out, size_t count) {
+		__m128 lastColumn = _mm_set_ps(1, 0, 0, 0);
+		for (size_t i = 0; i < count; i++) {
+			__m128 m0 = loadColumn(models[i], 0);
+			__m128 m1 = loadColumn(models[i], 1);
+			__m128 m2 = loadColumn(models[i], 2);
+			__m128 c0 = cross(m1, m2);
+			__m128 c1 = cross(m2, m0);
+			__m128 c2 = cross(m0, m1);
+			// The dot product of x, y and z, in every lane.
+			__m128 determinant = _mm_dp_ps(m0, c0, 0x7F);
+			// The crosses have 0 in w, which stays 0.
+			_mm_storeu_ps(&out[i][0][0], _mm_div_ps(c0, determinant));
+			_mm_storeu_ps(&out[i][1][0], _mm_div_ps(c1, determinant));
+			_mm_storeu_ps(&out[i][2][0], _mm_div_ps(c2, determinant));
+			_mm_storeu_ps(&out[i][3][0], lastColumn);
+		}
+	}
+
+	BATCH_TARGET("avx2,fma") inline __m256 broadcastColumn(const glm::mat4& m, int column) {
+		__m128 value = _mm_loadu_ps(&m[column][0]);
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(value), value, 1);
+	}
+
+	BATCH_TARGET("avx2,fma") inline void multiplyMatrixAVX2(const __m256 left[4], const glm::mat4& right,
+		glm::mat4& out) {
+		// Two columns of the result per register: each lane of left holds the same column, and each
+		// half of the right operand's columns supplies its own coefficients.
+		for (int column = 0; column < 4; column += 2) {
+			__m256 columns = _mm256_loadu_ps(&right[column][0]);
+			__m256 result = _mm256_mul_ps(left[0], _mm256_permute_ps(columns, 0x00));
+			result = _mm256_fmadd_ps(left[1], _mm256_permute_ps(columns, 0x55), result);
+			result = _mm256_fmadd_ps(left[2], _mm256_permute_ps(columns, 0xAA), result);
+			result = _mm256_fmadd_ps(left[3], _mm256_permute_ps(columns, 0xFF), result);
+			_mm256_storeu_ps(&out[column][0], result);
+		}
+	}
+
+	BATCH_TARGET("avx2,fma") inline __m256 cross(__m256 a, __m256 b) {
+		__m256 aYzx = _mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m256 bYzx = _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m256 c = _mm256_fmsub_ps(a, bYzx, _mm256_mul_ps(aYzx, b));
+		return _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	BATCH_TARGET("avx2,fma") void propagateAVX2(const uint32_t* parents, const glm::mat4* locals,
+		glm::mat4* worlds, size_t begin, size_t end, uint32_t noParent) {
+		for (size_t i = begin; i < end; i++) {
+			uint32_t parent = parents[i];
+			if (parent == noParent) {
+				worlds[i] = locals[i];
+				continue;
+			}
+			__m256 left[4];
+			for (int column = 0; column < 4; column++) {
+				left[column] = broadcastColumn(worlds[parent], column);
+			}
+			multiplyMatrixAVX2(left, locals[i], worlds[i]);
+		}
+	}
+
+	BATCH_TARGET("avx2,fma") void multiplyAVX2(const glm::mat4& leftMatrix, const glm::mat4* right, glm::mat4* out,
+		size_t count) {
+		__m256 left[4];
+		for (int column = 0; column < 4; column++) {
+			left[column] = broadcastColumn(leftMatrix, column);
+		}
+		for (size_t i = 0; i < count; i++) {
+			multiplyMatrixAVX2(left, right[i], out[i]);
+		}
+	}
+
+	BATCH_TARGET("avx2,fma") void normalMatricesAVX2(const glm::mat4* models, glm::mat4* out, size_t count) {
+		__m128 lastColumn = _mm_set_ps(1, 0, 0, 0);
+		size_t i = 0;
+		// Two matrices per register, one in each half.
+		for (; i + 2 <= count; i += 2) {
+			__m256 m[3];
+			for (int column = 0; column < 3; column++) {
+				m[column] = _mm256_insertf128_ps(_mm256_castps128_ps256(loadColumn(models[i], column)),
+					loadColumn(models[i + 1], column), 1);
+			}
+			__m256 c[3] = { cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]) };
+			__m256 determinant = _mm256_dp_ps(m[0], c[0], 0x7F);
+			for (int column = 0; column < 3; column++) {
+				__m256 normal = _mm256_div_ps(c[column], determinant);
+				_mm_storeu_ps(&out[i][column][0], _mm256_castps256_ps128(normal));
+				_mm_storeu_ps(&out[i + 1][column][0], _mm256_extractf128_ps(normal, 1));
+			}
+			_mm_storeu_ps(&out[i][3][0], lastColumn);
+			_mm_storeu_ps(&out[i + 1][3][0], lastColumn);
+		}
+		normalMatricesSSE41(models + i, out + i, count - i);
+	}
+
+	// GCC 12's AVX-512 intrinsics fill the lanes they ignore from _mm512_undefined_ps(), which -Wall
+	// reports as uninitialized once they are inlined here. Nothing reads those lanes.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+	BATCH_TARGET("avx512f") inline __m512 broadcastColumn512(const glm::mat4& m, int column) {
+		return _mm512_broadcast_f32x4(_mm_loadu_ps(&m[column][0]));
+	}
+
+	BATCH_TARGET("avx512f") inline void multiplyMatrixAVX512(const __m512 left[4], const glm::mat4& right,
+		glm::mat4& out) {
+		// The whole result in one register, each 128-bit lane a column.
+		__m512 columns = _mm512_loadu_ps(&right[0][0]);
+		__m512 result = _mm512_mul_ps(left[0], _mm512_permute_ps(columns, 0x00));
+		result = _mm512_fmadd_ps(left[1], _mm512_permute_ps(columns, 0x55), result);
+		result = _mm512_fmadd_ps(left[2], _mm512_permute_ps(columns, 0xAA), result);
+		result = _mm512_fmadd_ps(left[3], _mm512_permute_ps(columns, 0xFF), result);
+		_mm512_storeu_ps(&out[0][0], result);
+	}
+
+	BATCH_TARGET("avx512f") inline __m512 cross(__m512 a, __m512 b) {
+		__m512 aYzx = _mm512_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m512 bYzx = _mm512_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m512 c = _mm512_fmsub_ps(a, bYzx, _mm512_mul_ps(aYzx, b));
+		return _mm512_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	BATCH_TARGET("avx512f") void propagateAVX512(const uint32_t* parents, const glm::mat4* locals,
+		glm::mat4* worlds, size_t begin, size_t end, uint32_t noParent) {
+		for (size_t i = begin; i < end; i++) {
+			uint32_t parent = parents[i];
+			if (parent == noParent) {
+				worlds[i] = locals[i];
+				continue;
+			}
+			__m512 left[4];
+			for (int column = 0; column < 4; column++) {
+				left[column] = broadcastColumn512(worlds[parent], column);
+			}
+			multiplyMatrixAVX512(left, locals[i], worlds[i]);
+		}
+	}
+
+	BATCH_TARGET("avx512f") void multiplyAVX512(const glm::mat4& leftMatrix, const glm::mat4* right,
+		glm::mat4* out, size_t count) {
+		__m512 left[4];
+		for (int column = 0; column < 4; column++) {
+			left[column] = broadcastColumn512(leftMatrix, column);
+		}
+		for (size_t i = 0; i < count; i++) {
+			multiplyMatrixAVX512(left, right[i], out[i]);
+		}
+	}
+
+	BATCH_TARGET("avx512f") void normalMatricesAVX512(const glm::mat4* models, glm::mat4* out, size_t count) {
+		__m128 lastColumn = _mm_set_ps(1, 0, 0, 0);
+		size_t i = 0;
+		// Four matrices per register, one in each 128-bit lane.
+		for (; i + 4 <= count; i += 4) {
+			__m512 m[3];
+			for (int column = 0; column < 3; column++) {
+				__m512 v = _mm512_insertf32x4(_mm512_setzero_ps(), loadColumn(models[i], column), 0);
+				v = _mm512_insertf32x4(v, loadColumn(models[i + 1], column), 1);
+				v = _mm512_insertf32x4(v, loadColumn(models[i + 2], column), 2);
+				m[column] = _mm512_insertf32x4(v, loadColumn(models[i + 3], column), 3);
+			}
+			__m512 c[3] = { cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]) };
+			// There is no 512-bit dot product: sum the products' x, y and z into each of them.
+			__m512 products = _mm512_mul_ps(m[0], c[0]);
+			__m512 determinant = _mm512_add_ps(products, _mm512_add_ps(
+				_mm512_shuffle_ps(products, products, _MM_SHUFFLE(3, 0, 2, 1)),
+				_mm512_shuffle_ps(products, products, _MM_SHUFFLE(3, 1, 0, 2))));
+			for (int column = 0; column < 3; column++) {
+				__m512 normal = _mm512_div_ps(c[column], determinant);
+				_mm_storeu_ps(&out[i][column][0], _mm512_extractf32x4_ps(normal, 0));
+				_mm_storeu_ps(&out[i + 1][column][0], _mm512_extractf32x4_ps(normal, 1));
+				_mm_storeu_ps(&out[i + 2][column][0], _mm512_extractf32x4_ps(normal, 2));
+				_mm_storeu_ps(&out[i + 3][column][0], _mm512_extractf32x4_ps(normal, 3));
+			}
+			for (size_t j = i; j < i + 4; j++) {
+				_mm_storeu_ps(&out[j][3][0], lastColumn);
+			}
+		}
+		normalMatricesSSE41(models + i, out + i, count - i);
+	}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+	/**
+	 * @brief The widest path the CPU and operating system support.
+	 */
+	BatchMath::Path detectPath() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		bool sse41 = (info[2] & (1 << 19)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		// The OS must save the YMM registers, and for AVX-512 the ZMM and mask registers, on a
+		// context switch.
+		uint64_t enabledState = osxsave ? _xgetbv(0) : 0;
+		bool avxState = (enabledState & 0x6) == 0x6;
+		bool avx512State = (enabledState & 0xE6) == 0xE6;
+		bool avx2 = false;
+		bool avx512f = false;
+		if (maxLeaf >= 7) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+			avx512f = (info[1] & (1 << 16)) != 0;
+		}
+		if (avx512f && avx512State) {
+			return BatchMath::Path::AVX512;
+		}
+		if (avx && avx2 && fma && avxState) {
+			return BatchMath::Path::AVX2;
+		}
+		return sse41 ? BatchMath::Path::SSE41 : BatchMath::Path::Scalar;
+#else
+		// These also check that the OS saves the wider registers.
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			return BatchMath::Path::AVX512;
+		}
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return BatchMath::Path::AVX2;
+		}
+		return __builtin_cpu_supports("sse4.1") ? BatchMath::Path::SSE41 : BatchMath::Path::Scalar;
+#endif
+	}
+#else
+	BatchMath::Path detectPath() {
+		return BatchMath::Path::Scalar;
+	}
+#endif
+}
+
+BatchMath::BatchMath() : m_bestPath(detectPath()), m_path(m_bestPath), m_kernels(kernels(m_bestPath)) {}
+
+BatchMath& BatchMath::global() {
+	static BatchMath batchMath;
+	return batchMath;
+}
+
+BatchMath::Kernels BatchMath::kernels(Path path) {
+	switch (path) {
+#ifdef BATCH_MATH_X86
+	case Path::SSE41:
+		// Four-wide matrix products are no faster by hand than the compiler's own vectorization of
+		// the scalar ones.
+		return Kernels{ propagateScalar, multiplyScalar, normalMatricesSSE41 };
+	case Path::AVX2:
+		return Kernels{ propagateAVX2, multiplyAVX2, normalMatricesAVX2 };
+	case Path::AVX512:
+		return Kernels{ propagateAVX512, multiplyAVX512, normalMatricesAVX512 };
+#endif
+	default:
+		return Kernels{ propagateScalar, multiplyScalar, normalMatricesScalar };
+	}
+}
+
+const char* BatchMath::name(Path path) {
+	switch (path) {
+	case Path::SSE41:
+		return "SSE4.1";
+	case Path::AVX2:
+		return "AVX2";
+	case Path::AVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+void BatchMath::setPath(Path path) {
+	m_path = supports(path) ? path : m_bestPath;
+	m_kernels = kernels(m_path);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Matrix kernels over arrays of transforms: world matrices from parents' world matrices and
+ * local matrices, model-view-projection matrices, and normal matrices. Each has a scalar version,
+ * the reference the others are validated against, and SSE4.1, AVX2 and AVX-512 paths, the best of
+ * which the CPU supports is chosen at runtime.
+ *
+ * The SSE4.1 path has its own normal matrix kernel but keeps the scalar matrix products, which
+ * compilers already vectorize to the same four-wide instructions. The AVX2 kernels multiply
+ * two columns at once, and compute normal matrices for two transforms at once; the AVX-512
+ * kernels, a whole matrix, and four normal matrices. Propagation goes one matrix at a time on
+ * every path, since a child's parent may be the matrix just before it.
+ */
+class BatchMath {
+public:
+	enum class Path {
+		Scalar,
+		SSE41,
+		AVX2,
+		AVX512,
+	};
+
+	struct Kernels {
+		void (*propagate)(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, size_t begin,
+			size_t end, uint32_t noParent);
+		void (*multiply)(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count);
+		void (*normalMatrices)(const glm::mat4* models, glm::mat4* out, size_t count);
+	};
+
+private:
+	Path m_bestPath;
+	Path m_path;
+	Kernels m_kernels;
+
+	static Kernels kernels(Path path);
+
+public:
+	BatchMath();
+
+	/**
+	 * @brief The kernels shared by the whole process, on the best path the CPU supports.
+	 */
+	static BatchMath& global();
+
+	static const char* name(Path path);
+	bool supports(Path path) const { return path <= m_bestPath; }
+	Path path() const { return m_path; }
+	/**
+	 * @brief Switches to another path, e.g. to compare them; one the CPU lacks falls back to the
+	 * best it has.
+	 */
+	void setPath(Path path);
+
+	/**
+	 * @brief worlds[i] = worlds[parents[i]] * locals[i] for each i in [begin, end), or locals[i]
+	 * for entries whose parent is noParent. Parents must come before their children.
+	 */
+	void propagate(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, size_t begin, size_t end,
+		uint32_t noParent) const {
+		m_kernels.propagate(parents, locals, worlds, begin, end, noParent);
+	}
+
+	/**
+	 * @brief out[i] = left * right[i], e.g. model-view-projection matrices from a view-projection
+	 * matrix and model matrices. out may be right.
+	 */
+	void multiply(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) const {
+		m_kernels.multiply(left, right, out, count);
+	}
+
+	/**
+	 * @brief The inverse transpose of the upper 3x3 of each model matrix, in the upper 3x3 of a
+	 * mat4 with (0, 0, 0, 1) for the last row and column. Shaders use only the 3x3, which for the
+	 * affine matrices of a scene graph matches glm::transpose(glm::inverse(model)).
+	 */
+	void normalMatrices(const glm::mat4* models, glm::mat4* out, size_t count) const {
+		m_kernels.normalMatrices(models, out, count);
+	}
+};
@@ -19,7 +19,7 @@ private:
 	/**
 	 * @brief Advance the animation by the given time interval.
 	 */
-	void applyAnimation(float_t dt) override {
+	void applyAnimation(Object3D& object, float_t dt) override {
 		// calculate t 
 		float_t t = currentTime() / duration();
 
@@ -36,7 +36,7 @@ private:
 		// where 0 <= t <= 1 
 		glm::vec3 bezPosition = (1 - t) * ((1 - t) * p0 + t * p1) + t * ((1 - t) * p1 + t * p2);
 
-		object().setPosition(bezPosition);
+		object.setPosition(bezPosition);
 		//object().move(m_perSecond * dt);
 	}
 
@@ -44,6 +44,6 @@ public:
 	/**
 	 * @brief Constructs a animation of a constant translation
 	 */
-	BezierTranslationAnimation(Object3D& object, float_t duration, const glm::vec3& controlPointA, const glm::vec3& controlPointB, const glm::vec3& controlPointC) :
-		Animation(object, duration), controlPointA(controlPointA), controlPointB(controlPointB), controlPointC(controlPointC) {}
+	BezierTranslationAnimation(ObjectRef object, float_t duration, const glm::vec3& controlPointA, const glm::vec3& controlPointB, const glm::vec3& controlPointC) :
+		Animation(std::move(object), duration), controlPointA(controlPointA), controlPointB(controlPointB), controlPointC(controlPointC) {}
 };
@@ -0,0 +1,260 @@
+#include "BoundingVolumeTree.h"
+#include <algorithm>
+#include <stdexcept>
+
+BoundingVolumeTree::BoundingVolumeTree(float_t margin)
+	: m_root(NULL_PROXY), m_freeList(NULL_PROXY), m_leafCount(0), m_margin(margin) {}
+
+float_t BoundingVolumeTree::surfaceArea(const BoundingBox& box) {
+	glm::vec3 size = box.max - box.min;
+	return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+BoundingBox BoundingVolumeTree::merge(const BoundingBox& a, const BoundingBox& b) {
+	return BoundingBox(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+bool BoundingVolumeTree::overlaps(const BoundingBox& a, const BoundingBox& b) {
+	return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
+
+std::optional<float_t> BoundingVolumeTree::rayEntry(const BoundingBox& box, const glm::vec3& origin,
+	const glm::vec3& inverseDirection, float_t maxDistance) {
+	// The slab test: intersect the ray's intervals inside each pair of parallel faces.
+	glm::vec3 t1 = (box.min - origin) * inverseDirection;
+	glm::vec3 t2 = (box.max - origin) * inverseDirection;
+	glm::vec3 near = glm::min(t1, t2);
+	glm::vec3 far = glm::max(t1, t2);
+	float_t entry = std::max({ near.x, near.y, near.z, 0.0f });
+	float_t exit = std::min({ far.x, far.y, far.z, maxDistance });
+	if (entry > exit) {
+		return std::nullopt;
+	}
+	return entry;
+}
+
+BoundingVolumeTree::Proxy BoundingVolumeTree::allocateNode() {
+	if (m_freeList == NULL_PROXY) {
+		m_nodes.push_back(Node{});
+		m_nodes.back().height = -1;
+		m_nodes.back().parent = NULL_PROXY;
+		m_freeList = static_cast<Proxy>(m_nodes.size() - 1);
+	}
+	Proxy index = m_freeList;
+	auto& node = m_nodes[index];
+	m_freeList = node.parent;
+	node.parent = NULL_PROXY;
+	node.child1 = NULL_PROXY;
+	node.child2 = NULL_PROXY;
+	node.height = 0;
+	node.value = 0;
+	return index;
+}
+
+void BoundingVolumeTree::freeNode(Proxy node) {
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+BoundingVolumeTree::Proxy BoundingVolumeTree::insert(const BoundingBox& bounds, uint32_t value) {
+	if (bounds.isEmpty()) {
+		throw std::runtime_error("Cannot insert empty bounds into a bounding volume tree");
+	}
+	Proxy leaf = allocateNode();
+	auto& node = m_nodes[leaf];
+	node.bounds = bounds;
+	node.box = BoundingBox(bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin));
+	node.value = value;
+	insertLeaf(leaf);
+	++m_leafCount;
+	return leaf;
+}
+
+void BoundingVolumeTree::remove(Proxy proxy) {
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--m_leafCount;
+}
+
+bool BoundingVolumeTree::update(Proxy proxy, const BoundingBox& bounds) {
+	auto& node = m_nodes[proxy];
+	node.bounds = bounds;
+	if (glm::all(glm::lessThanEqual(node.box.min, bounds.min)) && glm::all(glm::lessThanEqual(bounds.max, node.box.max))) {
+		return false;
+	}
+	removeLeaf(proxy);
+	m_nodes[proxy].box = BoundingBox(bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin));
+	insertLeaf(proxy);
+	return true;
+}
+
+void BoundingVolumeTree::clear() {
+	m_nodes.clear();
+	m_root = NULL_PROXY;
+	m_freeList = NULL_PROXY;
+	m_leafCount = 0;
+}
+
+std::optional<BoundingVolumeTree::RayHit> BoundingVolumeTree::raycast(const glm::vec3& origin,
+	const glm::vec3& direction, float_t maxDistance) const {
+	return raycast(origin, direction, maxDistance, [](uint32_t) { return true; });
+}
+
+std::optional<BoundingVolumeTree::NearestHit> BoundingVolumeTree::nearest(const glm::vec3& point,
+	float_t maxDistance) const {
+	return nearest(point, maxDistance, [](uint32_t) { return true; });
+}
+
+void BoundingVolumeTree::insertLeaf(Proxy leaf) {
+	if (m_root == NULL_PROXY) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_PROXY;
+		return;
+	}
+
+	// Descend to the sibling whose pairing with the leaf adds the least surface area to the
+	// tree, counting the growth of every ancestor on the way.
+	BoundingBox leafBox = m_nodes[leaf].box;
+	Proxy index = m_root;
+	while (!m_nodes[index].isLeaf()) {
+		auto& node = m_nodes[index];
+		float_t area = surfaceArea(node.box);
+		float_t combinedArea = surfaceArea(merge(node.box, leafBox));
+		// The cost of making a new parent for this node and the leaf, and the cost every level
+		// below pays for growing this node.
+		float_t cost = 2 * combinedArea;
+		float_t inheritanceCost = 2 * (combinedArea - area);
+
+		auto descendCost = [&](Proxy child) {
+			auto& childNode = m_nodes[child];
+			float_t merged = surfaceArea(merge(leafBox, childNode.box));
+			return (childNode.isLeaf() ? merged : merged - surfaceArea(childNode.box)) + inheritanceCost;
+		};
+		float_t cost1 = descendCost(node.child1);
+		float_t cost2 = descendCost(node.child2);
+		if (cost < cost1 && cost < cost2) {
+			break;
+		}
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	Proxy sibling = index;
+	Proxy oldParent = m_nodes[sibling].parent;
+	Proxy newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].box = merge(leafBox, m_nodes[sibling].box);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].child1 = sibling;
+	m_nodes[newParent].child2 = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+	if (oldParent == NULL_PROXY) {
+		m_root = newParent;
+	}
+	else if (m_nodes[oldParent].child1 == sibling) {
+		m_nodes[oldParent].child1 = newParent;
+	}
+	else {
+		m_nodes[oldParent].child2 = newParent;
+	}
+
+	refitAncestors(m_nodes[leaf].parent);
+}
+
+void BoundingVolumeTree::removeLeaf(Proxy leaf) {
+	if (leaf == m_root) {
+		m_root = NULL_PROXY;
+		return;
+	}
+
+	// The leaf's parent goes away, and its sibling takes the parent's place.
+	Proxy parent = m_nodes[leaf].parent;
+	Proxy grandParent = m_nodes[parent].parent;
+	Proxy sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+	m_nodes[sibling].parent = grandParent;
+	freeNode(parent);
+	if (grandParent == NULL_PROXY) {
+		m_root = sibling;
+		return;
+	}
+	if (m_nodes[grandParent].child1 == parent) {
+		m_nodes[grandParent].child1 = sibling;
+	}
+	else {
+		m_nodes[grandParent].child2 = sibling;
+	}
+	refitAncestors(grandParent);
+}
+
+void BoundingVolumeTree::refitAncestors(Proxy index) {
+	while (index != NULL_PROXY) {
+		index = balance(index);
+		auto& node = m_nodes[index];
+		auto& child1 = m_nodes[node.child1];
+		auto& child2 = m_nodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.box = merge(child1.box, child2.box);
+		index = node.parent;
+	}
+}
+
+BoundingVolumeTree::Proxy BoundingVolumeTree::balance(Proxy iA) {
+	auto& a = m_nodes[iA];
+	if (a.isLeaf() || a.height < 2) {
+		return iA;
+	}
+	Proxy iB = a.child1;
+	Proxy iC = a.child2;
+	auto& b = m_nodes[iB];
+	auto& c = m_nodes[iC];
+	int32_t difference = c.height - b.height;
+
+	// Rotates the taller child (up) into A's place. A keeps its other child (stay) and takes the
+	// shorter of up's children; up keeps the taller one.
+	auto rotate = [&](Proxy iUp, Node& up, Node& stay, bool upWasChild2) {
+		Proxy iF = up.child1;
+		Proxy iG = up.child2;
+		auto& f = m_nodes[iF];
+		auto& g = m_nodes[iG];
+
+		up.child1 = iA;
+		up.parent = a.parent;
+		a.parent = iUp;
+		if (up.parent == NULL_PROXY) {
+			m_root = iUp;
+		}
+		else if (m_nodes[up.parent].child1 == iA) {
+			m_nodes[up.parent].child1 = iUp;
+		}
+		else {
+			m_nodes[up.parent].child2 = iUp;
+		}
+
+		Proxy iTaller = f.height > g.height ? iF : iG;
+		Proxy iShorter = iTaller == iF ? iG : iF;
+		auto& taller = m_nodes[iTaller];
+		auto& shorter = m_nodes[iShorter];
+		up.child2 = iTaller;
+		if (upWasChild2) {
+			a.child2 = iShorter;
+		}
+		else {
+			a.child1 = iShorter;
+		}
+		shorter.parent = iA;
+		a.box = merge(stay.box, shorter.box);
+		up.box = merge(a.box, taller.box);
+		a.height = 1 + std::max(stay.height, shorter.height);
+		up.height = 1 + std::max(a.height, taller.height);
+		return iUp;
+	};
+
+	if (difference > 1) {
+		return rotate(iC, c, b, true);
+	}
+	if (difference < -1) {
+		return rotate(iB, b, c, false);
+	}
+	return iA;
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+/**
+ * @brief A dynamic bounding volume hierarchy over the bounding boxes of scene objects, for
+ * spatial queries in logarithmic rather than linear time: overlap with a box, visibility in a
+ * frustum, the first hit along a ray, and the nearest object to a point.
+ *
+ * Each object is a leaf identified by a proxy id and carrying a caller-chosen value, e.g. an
+ * index into the scene. Leaves are inserted where they least increase the tree's surface area,
+ * and the tree is rebalanced with rotations as it changes, so it stays shallow under incremental
+ * inserts and removals.
+ *
+ * Leaves are stored with a "fat" box, enlarged by a margin, and update() only reinserts a leaf
+ * once its object leaves the fat box. An object moving a little each frame, like a launched bird,
+ * thus usually costs a containment test rather than a reinsertion. Queries still test the exact
+ * bounds at the leaves.
+ */
+class BoundingVolumeTree {
+public:
+	using Proxy = int32_t;
+	static const Proxy NULL_PROXY = -1;
+
+	struct RayHit {
+		uint32_t value;
+		// Along the ray, in units of its direction.
+		float_t distance;
+	};
+
+	struct NearestHit {
+		uint32_t value;
+		// From the point to the object's bounds; 0 if the point is inside them.
+		float_t distance;
+	};
+
+private:
+	struct Node {
+		// For leaves, the fat box; for internal nodes, the union of the children's boxes.
+		BoundingBox box;
+		// For leaves, the exact bounds of the object.
+		BoundingBox bounds;
+		// The parent, or the next free node while the node is on the free list.
+		Proxy parent;
+		Proxy child1;
+		Proxy child2;
+		// 0 for leaves, -1 for free nodes.
+		int32_t height;
+		uint32_t value;
+
+		bool isLeaf() const { return child1 == NULL_PROXY; }
+	};
+
+	std::vector<Node> m_nodes;
+	Proxy m_root;
+	Proxy m_freeList;
+	size_t m_leafCount;
+	float_t m_margin;
+
+	Proxy allocateNode();
+	void freeNode(Proxy node);
+	void insertLeaf(Proxy leaf);
+	void removeLeaf(Proxy leaf);
+	// Rotates the subtree at the node if its children's heights differ by more than one, and
+	// returns the subtree's new root.
+	Proxy balance(Proxy node);
+	void refitAncestors(Proxy node);
+
+	static float_t surfaceArea(const BoundingBox& box);
+	static BoundingBox merge(const BoundingBox& a, const BoundingBox& b);
+	static bool overlaps(const BoundingBox& a, const BoundingBox& b);
+	/**
+	 * @brief The distance along the ray at which it enters the box, if it does so before
+	 * maxDistance.
+	 */
+	static std::optional<float_t> rayEntry(const BoundingBox& box, const glm::vec3& origin,
+		const glm::vec3& inverseDirection, float_t maxDistance);
+
+public:
+	/**
+	 * @brief margin is how far, in world units, the fat box of each leaf extends past its bounds.
+	 */
+	explicit BoundingVolumeTree(float_t margin = 0.1f);
+
+	/**
+	 * @brief Adds an object with the given bounds, returning the proxy to update or remove it by.
+	 */
+	Proxy insert(const BoundingBox& bounds, uint32_t value);
+	void remove(Proxy proxy);
+	/**
+	 * @brief Gives the object new bounds. Returns true if it had left its fat box and was
+	 * reinserted.
+	 */
+	bool update(Proxy proxy, const BoundingBox& bounds);
+	void clear();
+
+	uint32_t value(Proxy proxy) const { return m_nodes[proxy].value; }
+	const BoundingBox& bounds(Proxy proxy) const { return m_nodes[proxy].bounds; }
+	size_t size() const { return m_leafCount; }
+	// The number of levels below the root; 0 for an empty tree or a single leaf.
+	int32_t height() const { return m_root == NULL_PROXY ? 0 : m_nodes[m_root].height; }
+
+	/**
+	 * @brief Calls callback(value) for every object whose bounds overlap the box, until it
+	 * returns false.
+	 */
+	template <typename Callback>
+	void queryOverlap(const BoundingBox& box, Callback&& callback) const;
+
+	/**
+	 * @brief Calls callback(value) for every object whose bounds may be in view of the frustum.
+	 * Subtrees entirely inside the frustum are reported without testing their leaves.
+	 */
+	template <typename Callback>
+	void queryFrustum(const Frustum& frustum, Callback&& callback) const;
+
+	/**
+	 * @brief The nearest object whose bounds the ray enters within maxDistance. Pass a filter,
+	 * filter(value) returning false for objects to ignore, to skip e.g. the object casting the ray.
+	 */
+	template <typename Filter>
+	std::optional<RayHit> raycast(const glm::vec3& origin, const glm::vec3& direction, float_t maxDistance,
+		Filter&& filter) const;
+	std::optional<RayHit> raycast(const glm::vec3& origin, const glm::vec3& direction, float_t maxDistance) const;
+
+	/**
+	 * @brief The object whose bounds are nearest to the point, within maxDistance, among those the
+	 * filter accepts.
+	 */
+	template <typename Filter>
+	std::optional<NearestHit> nearest(const glm::vec3& point, float_t maxDistance, Filter&& filter) const;
+	std::optional<NearestHit> nearest(const glm::vec3& point, float_t maxDistance) const;
+};
+
+template <typename Callback>
+void BoundingVolumeTree::queryOverlap(const BoundingBox& box, Callback&& callback) const {
+	if (m_root == NULL_PROXY) {
+		return;
+	}
+	std::vector<Proxy> stack = { m_root };
+	while (!stack.empty()) {
+		auto& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!overlaps(node.box, box)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			if (overlaps(node.bounds, box) && !callback(node.value)) {
+				return;
+			}
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+template <typename Callback>
+void BoundingVolumeTree::queryFrustum(const Frustum& frustum, Callback&& callback) const {
+	if (m_root == NULL_PROXY) {
+		return;
+	}
+	// Each entry carries whether an ancestor was already found entirely inside the frustum.
+	std::vector<std::pair<Proxy, bool>> stack = { { m_root, false } };
+	while (!stack.empty()) {
+		auto [index, inside] = stack.back();
+		stack.pop_back();
+		auto& node = m_nodes[index];
+		if (!inside) {
+			auto containment = frustum.classify(node.isLeaf() ? node.bounds : node.box);
+			if (containment == Containment::Outside) {
+				continue;
+			}
+			inside = containment == Containment::Inside;
+		}
+		if (node.isLeaf()) {
+			callback(node.value);
+		}
+		else {
+			stack.emplace_back(node.child1, inside);
+			stack.emplace_back(node.child2, inside);
+		}
+	}
+}
+
+template <typename Filter>
+std::optional<BoundingVolumeTree::RayHit> BoundingVolumeTree::raycast(const glm::vec3& origin,
+	const glm::vec3& direction, float_t maxDistance, Filter&& filter) const {
+	std::optional<RayHit> hit;
+	if (m_root == NULL_PROXY) {
+		return hit;
+	}
+	// Division by a zero component gives an infinity, which the slab test handles.
+	glm::vec3 inverseDirection = 1.0f / direction;
+	std::vector<Proxy> stack = { m_root };
+	while (!stack.empty()) {
+		auto& node = m_nodes[stack.back()];
+		stack.pop_back();
+		// Nothing farther than the nearest hit so far can improve on it.
+		if (!rayEntry(node.box, origin, inverseDirection, maxDistance)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			auto entry = rayEntry(node.bounds, origin, inverseDirection, maxDistance);
+			if (entry && filter(node.value)) {
+				hit = RayHit{ node.value, *entry };
+				maxDistance = *entry;
+			}
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+	return hit;
+}
+
+template <typename Filter>
+std::optional<BoundingVolumeTree::NearestHit> BoundingVolumeTree::nearest(const glm::vec3& point,
+	float_t maxDistance, Filter&& filter) const {
+	std::optional<NearestHit> hit;
+	if (m_root == NULL_PROXY) {
+		return hit;
+	}
+	auto distanceTo = [&point](const BoundingBox& box) {
+		return glm::length(glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0)));
+	};
+	std::vector<Proxy> stack = { m_root };
+	while (!stack.empty()) {
+		auto& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (distanceTo(node.box) > maxDistance) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			float_t distance = distanceTo(node.bounds);
+			if (distance <= maxDistance && filter(node.value)) {
+				hit = NearestHit{ node.value, distance };
+				maxDistance = distance;
+			}
+		}
+		else {
+			// Visit the nearer child first, so that it tightens maxDistance for the other.
+			bool firstNearer = distanceTo(m_nodes[node.child1].box) <= distanceTo(m_nodes[node.child2].box);
+			stack.push_back(firstNearer ? node.child2 : node.child1);
+			stack.push_back(firstNearer ? node.child1 : node.child2);
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,102 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <limits>
+
+BoundingBox::BoundingBox()
+	: min(std::numeric_limits<float_t>::max()), max(std::numeric_limits<float_t>::lowest()) {}
+
+BoundingBox::BoundingBox(const glm::vec3& min, const glm::vec3& max)
+	: min(min), max(max) {}
+
+void BoundingBox::expand(const glm::vec3& point) {
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+void BoundingBox::expand(const BoundingBox& other) {
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& matrix) const {
+	if (isEmpty()) {
+		return *this;
+	}
+	// Transform the center, and find the new extent from the absolute values of the matrix
+	// (Arvo), instead of transforming all eight corners.
+	glm::vec3 newCenter(matrix * glm::vec4(center(), 1));
+	glm::vec3 oldExtent = extent();
+	glm::vec3 newExtent(0);
+	for (int column = 0; column < 3; column++) {
+		newExtent += glm::abs(glm::vec3(matrix[column])) * oldExtent[column];
+	}
+	return BoundingBox(newCenter - newExtent, newCenter + newExtent);
+}
+
+BoundingSphere BoundingSphere::around(const BoundingBox& box) {
+	if (box.isEmpty()) {
+		return BoundingSphere{ glm::vec3(0), -1 };
+	}
+	return BoundingSphere{ box.center(), glm::length(box.extent()) };
+}
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4& matrix) const {
+	if (radius < 0) {
+		return *this;
+	}
+	float_t scale = std::max({ glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])),
+		glm::length(glm::vec3(matrix[2])) });
+	return BoundingSphere{ glm::vec3(matrix * glm::vec4(center, 1)), radius * scale };
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	// Each plane is the fourth row of the matrix plus or minus one of the others.
+	glm::mat4 rows = glm::transpose(viewProjection);
+	m_planes[0] = rows[3] + rows[0];
+	m_planes[1] = rows[3] - rows[0];
+	m_planes[2] = rows[3] + rows[1];
+	m_planes[3] = rows[3] - rows[1];
+	m_planes[4] = rows[3] + rows[2];
+	m_planes[5] = rows[3] - rows[2];
+	for (auto& plane : m_planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+	if (sphere.radius < 0) {
+		return false;
+	}
+	for (auto& plane : m_planes) {
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::intersects(const BoundingBox& box) const {
+	return classify(box) != Containment::Outside;
+}
+
+Containment Frustum::classify(const BoundingBox& box) const {
+	if (box.isEmpty()) {
+		return Containment::Outside;
+	}
+	glm::vec3 center = box.center();
+	glm::vec3 extent = box.extent();
+	auto containment = Containment::Inside;
+	for (auto& plane : m_planes) {
+		glm::vec3 normal(plane);
+		// The distance of the box's center from the plane, and the box's radius along the normal.
+		float_t distance = glm::dot(normal, center) + plane.w;
+		float_t radius = glm::dot(extent, glm::abs(normal));
+		if (distance < -radius) {
+			return Containment::Outside;
+		}
+		if (distance < radius) {
+			containment = Containment::Intersecting;
+		}
+	}
+	return containment;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <glm/glm.hpp>
+
+/**
+ * @brief An axis-aligned bounding box. A default-constructed box is empty: it contains nothing,
+ * and expanding it by a point gives the box of just that point.
+ */
+struct BoundingBox {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	BoundingBox();
+	BoundingBox(const glm::vec3& min, const glm::vec3& max);
+
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	// Half the size of the box along each axis.
+	glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+	void expand(const glm::vec3& point);
+	void expand(const BoundingBox& other);
+
+	/**
+	 * @brief The axis-aligned box around this box after transforming it by the matrix. Empty
+	 * boxes stay empty.
+	 */
+	BoundingBox transformed(const glm::mat4& matrix) const;
+};
+
+/**
+ * @brief A bounding sphere; a negative radius means empty.
+ */
+struct BoundingSphere {
+	glm::vec3 center;
+	float_t radius;
+
+	/**
+	 * @brief The sphere circumscribing the box.
+	 */
+	static BoundingSphere around(const BoundingBox& box);
+
+	/**
+	 * @brief A sphere containing this one after transforming it by the matrix, which may scale
+	 * unevenly.
+	 */
+	BoundingSphere transformed(const glm::mat4& matrix) const;
+};
+
+/**
+ * @brief How a volume lies relative to a Frustum.
+ */
+enum class Containment {
+	Outside,
+	Intersecting,
+	Inside
+};
+
+/**
+ * @brief The six planes bounding what a view-projection matrix can see, for culling bounds that
+ * are entirely outside of it. Tests are conservative: a volume that straddles a corner of the
+ * frustum may be reported as visible.
+ */
+class Frustum {
+private:
+	// Left, right, bottom, top, near, far. Each plane is (normal, distance), normal pointing
+	// inward, so a point p is inside the plane when dot(normal, p) + distance >= 0.
+	std::array<glm::vec4, 6> m_planes;
+
+public:
+	/**
+	 * @brief Extracts the planes from a projection * view matrix (Gribb and Hartmann); the
+	 * resulting frustum is in world space.
+	 */
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	bool intersects(const BoundingSphere& sphere) const;
+	bool intersects(const BoundingBox& box) const;
+	/**
+	 * @brief Like intersects, but also tells apart boxes entirely inside the frustum, whose
+	 * contents need no further tests.
+	 */
+	Containment classify(const BoundingBox& box) const;
+};
@@ -0,0 +1,415 @@
+#include "CompressedTexture.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	// Every level starts on this boundary, which satisfies KTX2's lcm(block size, 4) rule for
+	// all the formats above.
+	const uint64_t LEVEL_ALIGNMENT = 16;
+
+	struct Ktx2Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX2 specification");
+	static_assert(sizeof(Ktx2LevelIndex) == 24, "Ktx2LevelIndex must match the KTX2 specification");
+
+	// Khronos Data Format Descriptor values for the formats we write.
+	const uint32_t KHR_DF_MODEL_BC1A = 128;
+	const uint32_t KHR_DF_MODEL_BC3 = 130;
+	const uint32_t KHR_DF_CHANNEL_COLOR = 0;
+	const uint32_t KHR_DF_CHANNEL_BC3_ALPHA = 15;
+	const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+	const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+
+	uint32_t blockCount(uint32_t pixels) {
+		return (pixels + 3) / 4;
+	}
+
+	/**
+	 * @brief Copies the 4x4 block at block coordinates (bx, by), clamping at the image edges.
+	 */
+	void fetchBlock(const MipLevel& level, uint32_t bx, uint32_t by, uint8_t block[64]) {
+		for (uint32_t y = 0; y < 4; y++) {
+			uint32_t sy = std::min(by * 4 + y, level.height - 1);
+			for (uint32_t x = 0; x < 4; x++) {
+				uint32_t sx = std::min(bx * 4 + x, level.width - 1);
+				std::memcpy(block + (y * 4 + x) * 4, &level.rgba[(sy * level.width + sx) * 4], 4);
+			}
+		}
+	}
+
+	uint16_t toRgb565(const float color[3]) {
+		auto quantize = [](float value, int maxValue) {
+			return static_cast<uint16_t>(std::clamp(static_cast<int>(value / 255.0f * maxValue + 0.5f), 0, maxValue));
+		};
+		return static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5)
+			| quantize(color[2], 31));
+	}
+
+	void fromRgb565(uint16_t packed, int color[3]) {
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/**
+	 * @brief Encodes the RGB channels of a block as a BC1 color block: the endpoints are the
+	 * extremes of the block's colors along their principal axis, and each texel takes the nearest
+	 * of the four palette colors.
+	 */
+	void encodeColorBlock(const uint8_t block[64], uint8_t out[8]) {
+		float mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				mean[c] += block[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			float r = block[i * 4] - mean[0], g = block[i * 4 + 1] - mean[1], b = block[i * 4 + 2] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		// A few rounds of power iteration are enough to find the dominant axis of 16 colors.
+		float axis[3] = { 1, 1, 1 };
+		for (int iteration = 0; iteration < 4; iteration++) {
+			float next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+			};
+			float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+			if (length < 1e-6f) {
+				break;
+			}
+			for (int c = 0; c < 3; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minProjection = 1e30f, maxProjection = -1e30f;
+		for (int i = 0; i < 16; i++) {
+			float projection = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1]
+				+ (block[i * 4 + 2] - mean[2]) * axis[2];
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+		float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float endpoint0[3], endpoint1[3];
+		for (int c = 0; c < 3; c++) {
+			endpoint0[c] = mean[c] + axis[c] * maxProjection / std::max(axisLengthSquared, 1e-6f);
+			endpoint1[c] = mean[c] + axis[c] * minProjection / std::max(axisLengthSquared, 1e-6f);
+		}
+
+		uint16_t color0 = toRgb565(endpoint0), color1 = toRgb565(endpoint1);
+		// color0 > color1 selects the four-color mode; equal endpoints mean a flat block.
+		if (color0 < color1) {
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			int palette[4][3];
+			fromRgb565(color0, palette[0]);
+			fromRgb565(color1, palette[1]);
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (int i = 0; i < 16; i++) {
+				int best = 0, bestError = 1 << 30;
+				for (int p = 0; p < 4; p++) {
+					int dr = block[i * 4] - palette[p][0], dg = block[i * 4 + 1] - palette[p][1],
+						db = block[i * 4 + 2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+					if (error < bestError) {
+						best = p;
+						bestError = error;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		out[0] = color0 & 0xFF;
+		out[1] = color0 >> 8;
+		out[2] = color1 & 0xFF;
+		out[3] = color1 >> 8;
+		for (int b = 0; b < 4; b++) {
+			out[4 + b] = (indices >> (b * 8)) & 0xFF;
+		}
+	}
+
+	/**
+	 * @brief Encodes the alpha channel of a block as a BC3 alpha block, using the eight-value
+	 * mode between the block's minimum and maximum alpha.
+	 */
+	void encodeAlphaBlock(const uint8_t block[64], uint8_t out[8]) {
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++) {
+			alpha0 = std::max<int>(alpha0, block[i * 4 + 3]);
+			alpha1 = std::min<int>(alpha1, block[i * 4 + 3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1) {
+			int palette[8] = { alpha0, alpha1 };
+			for (int p = 1; p < 7; p++) {
+				palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+			}
+			for (int i = 0; i < 16; i++) {
+				int best = 0, bestError = 256;
+				for (int p = 0; p < 8; p++) {
+					int error = std::abs(block[i * 4 + 3] - palette[p]);
+					if (error < bestError) {
+						best = p;
+						bestError = error;
+					}
+				}
+				indices |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+
+		out[0] = static_cast<uint8_t>(alpha0);
+		out[1] = static_cast<uint8_t>(alpha1);
+		for (int b = 0; b < 6; b++) {
+			out[2 + b] = (indices >> (b * 8)) & 0xFF;
+		}
+	}
+
+	/**
+	 * @brief The Khronos Data Format Descriptor for a format we write, including its leading
+	 * dfdTotalSize word.
+	 */
+	std::vector<uint32_t> dataFormatDescriptor(CompressedFormat format) {
+		struct Sample {
+			uint32_t bitOffset;
+			uint32_t channel;
+		};
+		uint32_t model;
+		std::vector<Sample> samples;
+		if (format == CompressedFormat::BC1_RGB) {
+			model = KHR_DF_MODEL_BC1A;
+			samples = { { 0, KHR_DF_CHANNEL_COLOR } };
+		}
+		else if (format == CompressedFormat::BC3_RGBA) {
+			model = KHR_DF_MODEL_BC3;
+			samples = { { 0, KHR_DF_CHANNEL_BC3_ALPHA }, { 64, KHR_DF_CHANNEL_COLOR } };
+		}
+		else {
+			throw std::runtime_error("Writing this format to KTX2 is not supported");
+		}
+
+		uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		std::vector<uint32_t> words = {
+			4 + blockSize,
+			0,
+			2 | (blockSize << 16),
+			model | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16),
+			3 | (3 << 8),
+			static_cast<uint32_t>(compressedBlockBytes(format)),
+			0,
+		};
+		for (auto& sample : samples) {
+			words.push_back(sample.bitOffset | (63 << 16) | (sample.channel << 24));
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(0xFFFFFFFF);
+		}
+		return words;
+	}
+
+	uint64_t alignUp(uint64_t offset) {
+		return (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+	}
+}
+
+std::vector<MipLevel> buildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height) {
+	std::vector<MipLevel> levels;
+	levels.push_back({ width, height, std::vector<uint8_t>(rgba, rgba + size_t(width) * height * 4) });
+
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		const MipLevel& source = levels.back();
+		MipLevel next{ std::max(1u, source.width / 2), std::max(1u, source.height / 2), {} };
+		next.rgba.resize(size_t(next.width) * next.height * 4);
+
+		for (uint32_t y = 0; y < next.height; y++) {
+			uint32_t y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+			for (uint32_t x = 0; x < next.width; x++) {
+				uint32_t x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+				for (uint32_t c = 0; c < 4; c++) {
+					uint32_t sum = source.rgba[(y0 * source.width + x0) * 4 + c] + source.rgba[(y0 * source.width + x1) * 4 + c]
+						+ source.rgba[(y1 * source.width + x0) * 4 + c] + source.rgba[(y1 * source.width + x1) * 4 + c];
+					next.rgba[(y * next.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		levels.push_back(std::move(next));
+	}
+	return levels;
+}
+
+bool hasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height) {
+	for (size_t i = 0; i < size_t(width) * height; i++) {
+		if (rgba[i * 4 + 3] != 255) {
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t compressedBlockBytes(CompressedFormat format) {
+	return format == CompressedFormat::BC1_RGB || format == CompressedFormat::ETC2_RGB ? 8 : 16;
+}
+
+std::vector<uint8_t> compressLevel(const MipLevel& level, CompressedFormat format) {
+	if (format != CompressedFormat::BC1_RGB && format != CompressedFormat::BC3_RGBA) {
+		throw std::runtime_error("Only BC1 and BC3 can be encoded");
+	}
+
+	size_t blockBytes = compressedBlockBytes(format);
+	std::vector<uint8_t> compressed(size_t(blockCount(level.width)) * blockCount(level.height) * blockBytes);
+	uint8_t* out = compressed.data();
+	uint8_t block[64];
+	for (uint32_t by = 0; by < blockCount(level.height); by++) {
+		for (uint32_t bx = 0; bx < blockCount(level.width); bx++) {
+			fetchBlock(level, bx, by, block);
+			if (format == CompressedFormat::BC3_RGBA) {
+				encodeAlphaBlock(block, out);
+				out += 8;
+			}
+			encodeColorBlock(block, out);
+			out += 8;
+		}
+	}
+	return compressed;
+}
+
+void writeKtx2(const std::filesystem::path& path, CompressedFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& levels) {
+	auto dfd = dataFormatDescriptor(format);
+
+	Ktx2Header header{};
+	std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = static_cast<uint32_t>(format);
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex));
+	header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	// KTX2 stores the smallest level first, so a reader streaming the file gets usable data early.
+	std::vector<Ktx2LevelIndex> index(levels.size());
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (size_t i = levels.size(); i-- > 0;) {
+		offset = alignUp(offset);
+		index[i] = { offset, levels[i].size(), levels[i].size() };
+		offset += levels[i].size();
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to create " + path.string());
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2LevelIndex));
+	file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+	for (size_t i = levels.size(); i-- > 0;) {
+		static const char zeros[LEVEL_ALIGNMENT] = {};
+		file.write(zeros, index[i].byteOffset - static_cast<uint64_t>(file.tellp()));
+		file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write " + path.string());
+	}
+}
+
+CompressedImage parseKtx2(const uint8_t* data, size_t size) {
+	if (size < sizeof(Ktx2Header) || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		throw std::runtime_error("Not a KTX2 file");
+	}
+	Ktx2Header header;
+	std::memcpy(&header, data, sizeof(header));
+
+	CompressedImage image;
+	switch (header.vkFormat) {
+	case static_cast<uint32_t>(CompressedFormat::BC1_RGB):
+	case static_cast<uint32_t>(CompressedFormat::BC3_RGBA):
+	case static_cast<uint32_t>(CompressedFormat::ETC2_RGB):
+	case static_cast<uint32_t>(CompressedFormat::ETC2_RGBA):
+		image.format = static_cast<CompressedFormat>(header.vkFormat);
+		break;
+	default:
+		throw std::runtime_error("Unsupported KTX2 format " + std::to_string(header.vkFormat));
+	}
+	if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1
+		|| header.faceCount != 1 || header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+		throw std::runtime_error("Only single 2D textures with a stored mip chain are supported");
+	}
+	if (sizeof(Ktx2Header) + uint64_t(header.levelCount) * sizeof(Ktx2LevelIndex) > size) {
+		throw std::runtime_error("KTX2 level index is truncated");
+	}
+
+	size_t blockBytes = compressedBlockBytes(image.format);
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		Ktx2LevelIndex level;
+		std::memcpy(&level, data + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(level));
+		uint32_t width = std::max(1u, header.pixelWidth >> i), height = std::max(1u, header.pixelHeight >> i);
+		uint64_t expected = uint64_t(blockCount(width)) * blockCount(height) * blockBytes;
+		if (level.byteOffset > size || level.byteLength > size - level.byteOffset || level.byteLength < expected) {
+			throw std::runtime_error("KTX2 level " + std::to_string(i) + " is truncated");
+		}
+		image.levels.push_back({ width, height, data + level.byteOffset, static_cast<size_t>(expected) });
+	}
+	return image;
+}
+
+std::filesystem::path compressedTexturePath(const std::filesystem::path& imagePath) {
+	auto compressed = imagePath;
+	compressed += ".ktx2";
+	return compressed;
+}
+
+bool isCompressedTextureCurrent(const std::filesystem::path& imagePath) {
+	std::error_code error;
+	auto compressedTime = std::filesystem::last_write_time(compressedTexturePath(imagePath), error);
+	if (error) {
+		return false;
+	}
+	auto imageTime = std::filesystem::last_write_time(imagePath, error);
+	return !error && imageTime <= compressedTime;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * Offline texture compression, and the KTX2 container the results are stored in. Nothing here
+ * touches OpenGL: the AssetTool "compress" command uses it to write .ktx2 files next to source
+ * images, and the TextureRegistry uses it to parse them before uploading.
+ */
+
+/**
+ * @brief The block-compressed formats a .ktx2 file may hold. Values are the VkFormat codes
+ * KTX2 uses to identify them.
+ */
+enum class CompressedFormat : uint32_t {
+	BC1_RGB = 131,
+	BC3_RGBA = 137,
+	ETC2_RGB = 147,
+	ETC2_RGBA = 151,
+};
+
+/**
+ * @brief One level of an uncompressed RGBA8 mip chain.
+ */
+struct MipLevel {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> rgba;
+};
+
+/**
+ * @brief One level of a block-compressed mip chain, pointing into memory owned elsewhere.
+ */
+struct CompressedLevel {
+	uint32_t width;
+	uint32_t height;
+	const uint8_t* data;
+	size_t size;
+};
+
+/**
+ * @brief The contents of a parsed .ktx2 file. Levels are ordered from largest (level 0) to smallest.
+ */
+struct CompressedImage {
+	CompressedFormat format;
+	std::vector<CompressedLevel> levels;
+};
+
+/**
+ * @brief Builds a full mip chain down to 1x1 from an RGBA8 image, with a 2x2 box filter.
+ */
+std::vector<MipLevel> buildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+/**
+ * @brief True if any pixel of the RGBA8 image is not fully opaque.
+ */
+bool hasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+/**
+ * @brief Compresses one RGBA8 level with the given format. Only the BC formats can be encoded;
+ * ETC2 files produced by other tools can still be loaded.
+ */
+std::vector<uint8_t> compressLevel(const MipLevel& level, CompressedFormat format);
+
+/**
+ * @brief The size in bytes of one 4x4 block of the given format.
+ */
+size_t compressedBlockBytes(CompressedFormat format);
+
+/**
+ * @brief Writes a compressed mip chain (largest level first) as a KTX2 file.
+ */
+void writeKtx2(const std::filesystem::path& path, CompressedFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& levels);
+
+/**
+ * @brief Parses a KTX2 file held in memory. The returned levels point into that memory. Throws
+ * std::runtime_error if the file is malformed or holds a format this project cannot upload.
+ */
+CompressedImage parseKtx2(const uint8_t* data, size_t size);
+
+/**
+ * @brief The path of the compressed copy of the image at the given path.
+ */
+std::filesystem::path compressedTexturePath(const std::filesystem::path& imagePath);
+
+/**
+ * @brief True if the image at the given path has a compressed copy newer than the image itself.
+ */
+bool isCompressedTextureCurrent(const std::filesystem::path& imagePath);
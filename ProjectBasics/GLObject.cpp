@@ -0,0 +1,58 @@
+#include "GLObject.h"
+#include "GLStateCache.h"
+#include <glad/glad.h>
+
+namespace {
+	GLObjectCounts liveCounts = {};
+
+	size_t& liveCount(GLObjectKind kind) {
+		switch (kind) {
+		case GLObjectKind::Texture:
+			return liveCounts.textures;
+		case GLObjectKind::Buffer:
+			return liveCounts.buffers;
+		default:
+			return liveCounts.vertexArrays;
+		}
+	}
+}
+
+uint32_t generateGLObject(GLObjectKind kind) {
+	uint32_t id = 0;
+	switch (kind) {
+	case GLObjectKind::Texture:
+		glGenTextures(1, &id);
+		break;
+	case GLObjectKind::Buffer:
+		glGenBuffers(1, &id);
+		break;
+	case GLObjectKind::VertexArray:
+		glGenVertexArrays(1, &id);
+		break;
+	}
+	++liveCount(kind);
+	return id;
+}
+
+void deleteGLObject(GLObjectKind kind, uint32_t id) {
+	auto& state = GLStateCache::global();
+	switch (kind) {
+	case GLObjectKind::Texture:
+		state.forgetTexture(id);
+		glDeleteTextures(1, &id);
+		break;
+	case GLObjectKind::Buffer:
+		state.forgetBuffer(id);
+		glDeleteBuffers(1, &id);
+		break;
+	case GLObjectKind::VertexArray:
+		state.forgetVertexArray(id);
+		glDeleteVertexArrays(1, &id);
+		break;
+	}
+	--liveCount(kind);
+}
+
+GLObjectCounts liveGLObjects() {
+	return liveCounts;
+}
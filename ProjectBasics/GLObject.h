@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief The kinds of OpenGL object a GLObject can own.
+ */
+enum class GLObjectKind {
+	Texture,
+	Buffer,
+	VertexArray,
+};
+
+/**
+ * @brief How many GL objects of each kind are currently owned by GLObjects, for finding leaks.
+ */
+struct GLObjectCounts {
+	size_t textures;
+	size_t buffers;
+	size_t vertexArrays;
+
+	size_t total() const { return textures + buffers + vertexArrays; }
+};
+
+/**
+ * @brief Generates one GL object of the given kind and counts it as live.
+ */
+uint32_t generateGLObject(GLObjectKind kind);
+/**
+ * @brief Deletes a GL object generated by generateGLObject, first telling GLStateCache::global()
+ * that it is no longer bound.
+ */
+void deleteGLObject(GLObjectKind kind, uint32_t id);
+GLObjectCounts liveGLObjects();
+
+/**
+ * @brief Owns one OpenGL object, and deletes it when destroyed. Ownership moves but is never
+ * copied; objects that several owners share, like a GeometryArena's buffers or a registry
+ * texture, are shared by holding their owner through a shared_ptr.
+ *
+ * Like GLStateCache, it is used only from the thread that owns the OpenGL context.
+ */
+template <GLObjectKind Kind>
+class GLObject {
+private:
+	uint32_t m_id;
+
+public:
+	/**
+	 * @brief Owns nothing.
+	 */
+	GLObject() : m_id(0) {}
+	~GLObject() { reset(); }
+
+	GLObject(const GLObject&) = delete;
+	GLObject& operator=(const GLObject&) = delete;
+
+	GLObject(GLObject&& other) noexcept : m_id(std::exchange(other.m_id, 0)) {}
+	GLObject& operator=(GLObject&& other) noexcept {
+		if (this != &other) {
+			reset();
+			m_id = std::exchange(other.m_id, 0);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Generates a new GL object to own.
+	 */
+	static GLObject generate() {
+		GLObject object;
+		object.m_id = generateGLObject(Kind);
+		return object;
+	}
+
+	uint32_t id() const { return m_id; }
+	explicit operator bool() const { return m_id != 0; }
+
+	/**
+	 * @brief Deletes the object, if there is one.
+	 */
+	void reset() {
+		if (m_id != 0) {
+			deleteGLObject(Kind, m_id);
+			m_id = 0;
+		}
+	}
+};
+
+using GLTexture = GLObject<GLObjectKind::Texture>;
+using GLBuffer = GLObject<GLObjectKind::Buffer>;
+using GLVertexArray = GLObject<GLObjectKind::VertexArray>;
@@ -0,0 +1,177 @@
+#include "GLStateCache.h"
+#include <iterator>
+#include <glad/glad.h>
+
+GLStateCache::GLStateCache()
+	: m_stats() {
+	invalidate();
+}
+
+GLStateCache& GLStateCache::global() {
+	static GLStateCache cache;
+	return cache;
+}
+
+bool GLStateCache::change(uint32_t& cached, uint32_t value) {
+	if (cached == value) {
+		++m_stats.skipped;
+		return false;
+	}
+	++m_stats.issued;
+	cached = value;
+	return true;
+}
+
+void GLStateCache::useProgram(uint32_t program) {
+	if (change(m_program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void GLStateCache::bindVertexArray(uint32_t vertexArray) {
+	if (change(m_vertexArray, vertexArray)) {
+		glBindVertexArray(vertexArray);
+		m_elementBuffer = UNKNOWN;
+	}
+}
+
+void GLStateCache::bindBuffer(uint32_t target, uint32_t buffer) {
+	if (target == GL_ELEMENT_ARRAY_BUFFER) {
+		if (change(m_elementBuffer, buffer)) {
+			glBindBuffer(target, buffer);
+		}
+		return;
+	}
+	auto cached = m_buffers.try_emplace(target, UNKNOWN).first;
+	if (change(cached->second, buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLStateCache::bindBufferBase(uint32_t target, uint32_t index, uint32_t buffer) {
+	bindBufferRange(target, index, buffer, 0, 0);
+}
+
+void GLStateCache::bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, size_t offset, size_t size) {
+	uint64_t key = uint64_t(target) << 32 | index;
+	auto cached = m_indexedBuffers.find(key);
+	if (cached != m_indexedBuffers.end() && cached->second.buffer == buffer && cached->second.offset == offset
+		&& cached->second.size == size) {
+		++m_stats.skipped;
+		return;
+	}
+	++m_stats.issued;
+	m_indexedBuffers[key] = IndexedBinding{ buffer, offset, size };
+	if (size == 0) {
+		glBindBufferBase(target, index, buffer);
+	}
+	else {
+		glBindBufferRange(target, index, buffer, offset, size);
+	}
+	m_buffers[target] = buffer;
+}
+
+void GLStateCache::bindTexture(uint32_t unit, uint32_t texture) {
+	if (change(m_activeUnit, unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	if (change(m_textures.at(unit), texture)) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+}
+
+void GLStateCache::setEnabled(uint32_t capability, bool enabled) {
+	auto cached = m_capabilities.find(capability);
+	if (cached != m_capabilities.end() && cached->second == enabled) {
+		++m_stats.skipped;
+		return;
+	}
+	++m_stats.issued;
+	m_capabilities[capability] = enabled;
+	if (enabled) {
+		glEnable(capability);
+	}
+	else {
+		glDisable(capability);
+	}
+}
+
+void GLStateCache::depthMask(bool enabled) {
+	if (change(m_depthMask, enabled ? GL_TRUE : GL_FALSE)) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::blendFunc(uint32_t source, uint32_t destination) {
+	if (m_blendSource == source && m_blendDestination == destination) {
+		++m_stats.skipped;
+		return;
+	}
+	++m_stats.issued;
+	m_blendSource = source;
+	m_blendDestination = destination;
+	glBlendFunc(source, destination);
+}
+
+void GLStateCache::unbindAll() {
+	useProgram(0);
+	bindVertexArray(0);
+	for (auto& [target, buffer] : m_buffers) {
+		if (buffer != 0) {
+			++m_stats.issued;
+			buffer = 0;
+			glBindBuffer(target, 0);
+		}
+	}
+	for (uint32_t unit = TEXTURE_UNITS; unit-- > 0;) {
+		if (m_textures[unit] != 0) {
+			bindTexture(unit, 0);
+		}
+	}
+	if (m_activeUnit != 0) {
+		bindTexture(0, 0);
+	}
+}
+
+void GLStateCache::invalidate() {
+	m_program = UNKNOWN;
+	m_vertexArray = UNKNOWN;
+	m_elementBuffer = UNKNOWN;
+	m_activeUnit = UNKNOWN;
+	m_textures.fill(UNKNOWN);
+	m_buffers.clear();
+	m_indexedBuffers.clear();
+	m_capabilities.clear();
+	m_depthMask = UNKNOWN;
+	m_blendSource = UNKNOWN;
+	m_blendDestination = UNKNOWN;
+}
+
+void GLStateCache::forgetTexture(uint32_t texture) {
+	for (auto& bound : m_textures) {
+		if (bound == texture) {
+			bound = 0;
+		}
+	}
+}
+
+void GLStateCache::forgetBuffer(uint32_t buffer) {
+	for (auto& [target, bound] : m_buffers) {
+		if (bound == buffer) {
+			bound = 0;
+		}
+	}
+	for (auto it = m_indexedBuffers.begin(); it != m_indexedBuffers.end();) {
+		it = it->second.buffer == buffer ? m_indexedBuffers.erase(it) : std::next(it);
+	}
+	if (m_elementBuffer == buffer) {
+		m_elementBuffer = 0;
+	}
+}
+
+void GLStateCache::forgetVertexArray(uint32_t vertexArray) {
+	if (m_vertexArray == vertexArray) {
+		m_vertexArray = 0;
+		m_elementBuffer = UNKNOWN;
+	}
+}
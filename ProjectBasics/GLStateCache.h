@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @brief Remembers the OpenGL binding and enable state it has set, and skips calls that would
+ * not change it. All of ProjectBasics binds programs, vertex arrays, buffers and textures, and
+ * toggles capabilities, through GLStateCache::global(), so the cache always matches the context.
+ *
+ * Code that changes state behind the cache's back (SFML drawing, for one) must call invalidate()
+ * afterwards; the next call for each piece of state then goes to GL unconditionally.
+ */
+class GLStateCache {
+public:
+	struct Stats {
+		// Calls passed on to GL.
+		size_t issued;
+		// Calls skipped because the state was already set.
+		size_t skipped;
+	};
+
+	// Texture units the cache tracks; bindTexture() accepts no others.
+	static const uint32_t TEXTURE_UNITS = 16;
+
+private:
+	// Marks state the cache does not know, which never matches a requested value.
+	static const uint32_t UNKNOWN = UINT32_MAX;
+
+	uint32_t m_program;
+	uint32_t m_vertexArray;
+	// GL_ELEMENT_ARRAY_BUFFER is part of the vertex array's state, so it is forgotten whenever
+	// the vertex array changes.
+	uint32_t m_elementBuffer;
+	uint32_t m_activeUnit;
+	std::array<uint32_t, TEXTURE_UNITS> m_textures;
+	std::unordered_map<uint32_t, uint32_t> m_buffers;
+	struct IndexedBinding {
+		uint32_t buffer;
+		// Both 0 for bindBufferBase, which binds the whole buffer.
+		size_t offset;
+		size_t size;
+	};
+	// Indexed bindings (GL_UNIFORM_BUFFER and the like), keyed by target << 32 | index.
+	std::unordered_map<uint64_t, IndexedBinding> m_indexedBuffers;
+	std::unordered_map<uint32_t, bool> m_capabilities;
+	uint32_t m_depthMask;
+	uint32_t m_blendSource;
+	uint32_t m_blendDestination;
+	Stats m_stats;
+
+	/**
+	 * @brief Counts a call, and returns true if it must be issued because the cached value differs.
+	 * Updates the cached value.
+	 */
+	bool change(uint32_t& cached, uint32_t value);
+
+public:
+	GLStateCache();
+
+	GLStateCache(const GLStateCache&) = delete;
+	GLStateCache& operator=(const GLStateCache&) = delete;
+
+	/**
+	 * @brief The cache for the process's OpenGL context. Like the rest of the renderer, it must
+	 * only be used on the context's thread.
+	 */
+	static GLStateCache& global();
+
+	void useProgram(uint32_t program);
+	void bindVertexArray(uint32_t vertexArray);
+	void bindBuffer(uint32_t target, uint32_t buffer);
+	/**
+	 * @brief Bind a buffer, or a range of it, to an indexed binding point of the target. Like GL,
+	 * these also bind the buffer to the target's generic binding point.
+	 */
+	void bindBufferBase(uint32_t target, uint32_t index, uint32_t buffer);
+	void bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, size_t offset, size_t size);
+	/**
+	 * @brief Binds a GL_TEXTURE_2D texture to the given unit, making it the active unit.
+	 */
+	void bindTexture(uint32_t unit, uint32_t texture);
+	void setEnabled(uint32_t capability, bool enabled);
+	void depthMask(bool enabled);
+	void blendFunc(uint32_t source, uint32_t destination);
+
+	/**
+	 * @brief Binds program, vertex array, buffers and textures back to 0, e.g. before letting
+	 * SFML draw, which expects no vertex array bound.
+	 */
+	void unbindAll();
+
+	/**
+	 * @brief Forgets all cached state, after something other than the cache changed it.
+	 */
+	void invalidate();
+
+	/**
+	 * @brief Deleting a bound object rebinds 0 in its place; these mirror that in the cache.
+	 * Call them when deleting the object.
+	 */
+	void forgetTexture(uint32_t texture);
+	void forgetBuffer(uint32_t buffer);
+	void forgetVertexArray(uint32_t vertexArray);
+
+	Stats stats() const { return m_stats; }
+	void resetStats() { m_stats = Stats(); }
+};
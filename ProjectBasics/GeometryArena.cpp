@@ -0,0 +1,86 @@
+#include "GeometryArena.h"
+#include "GLStateCache.h"
+#include "VertexPacking.h"
+#include <stdexcept>
+
+GeometryArena::GeometryArena(VertexFormat vertexFormat, size_t vertexCapacity, size_t indexCapacity,
+	size_t largestMeshVertices)
+	: m_vbo(GLBuffer::generate()), m_ebo(GLBuffer::generate()), m_vao(GLVertexArray::generate()),
+	m_vertexFormat(vertexFormat), m_indexType(largestMeshVertices < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+	m_vertexCapacity(vertexCapacity), m_indexCapacity(indexCapacity), m_vertexCount(0), m_indexCount(0) {
+	auto& state = GLStateCache::global();
+	state.bindVertexArray(m_vao.id());
+
+	size_t vertexSize = vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex3D) : sizeof(Vertex3D);
+	state.bindBuffer(GL_ARRAY_BUFFER, m_vbo.id());
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * vertexSize, nullptr, GL_STATIC_DRAW);
+	Mesh3D::setVertexLayout(vertexFormat);
+
+	state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo.id());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * indexSize(), nullptr, GL_STATIC_DRAW);
+
+	state.bindVertexArray(0);
+}
+
+GeometryRange GeometryArena::append(const Vertex3D* vertices, size_t vertexCount, const uint32_t* indices,
+	size_t indexCount) {
+	if (m_vertexCount + vertexCount > m_vertexCapacity || m_indexCount + indexCount > m_indexCapacity) {
+		throw std::runtime_error("Geometry arena is too small for the appended mesh");
+	}
+	if (m_indexType == GL_UNSIGNED_SHORT && vertexCount >= 65536) {
+		throw std::runtime_error("Mesh has too many vertices for the arena's 16-bit indices");
+	}
+
+	GeometryRange range{ static_cast<int32_t>(m_vertexCount), vertexCount, m_indexCount, indexCount,
+		glm::vec3(0), glm::vec3(1), vertexBounds(vertices, vertexCount) };
+
+	// The element buffer binding is part of the VAO state, so bind the VAO to update it.
+	auto& state = GLStateCache::global();
+	state.bindVertexArray(m_vao.id());
+	state.bindBuffer(GL_ARRAY_BUFFER, m_vbo.id());
+	if (m_vertexFormat == VertexFormat::Packed) {
+		std::vector<PackedVertex3D> packed;
+		auto bounds = packVertices(vertices, vertexCount, packed);
+		range.positionOffset = bounds.offset;
+		range.positionScale = bounds.scale;
+		glBufferSubData(GL_ARRAY_BUFFER, m_vertexCount * sizeof(PackedVertex3D),
+			packed.size() * sizeof(PackedVertex3D), packed.data());
+	}
+	else {
+		glBufferSubData(GL_ARRAY_BUFFER, m_vertexCount * sizeof(Vertex3D), vertexCount * sizeof(Vertex3D), vertices);
+	}
+
+	uploadIndices(indices, indexCount);
+	state.bindVertexArray(0);
+
+	m_vertexCount += vertexCount;
+	return range;
+}
+
+GeometryRange GeometryArena::appendIndices(const GeometryRange& vertices, const uint32_t* indices, size_t indexCount) {
+	if (m_indexCount + indexCount > m_indexCapacity) {
+		throw std::runtime_error("Geometry arena is too small for the appended indices");
+	}
+	GeometryRange range = vertices;
+	range.firstIndex = m_indexCount;
+	range.indexCount = indexCount;
+
+	auto& state = GLStateCache::global();
+	state.bindVertexArray(m_vao.id());
+	uploadIndices(indices, indexCount);
+	state.bindVertexArray(0);
+	return range;
+}
+
+void GeometryArena::uploadIndices(const uint32_t* indices, size_t indexCount) {
+	if (m_indexType == GL_UNSIGNED_SHORT) {
+		std::vector<uint16_t> shortIndices(indices, indices + indexCount);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_indexCount * sizeof(uint16_t), indexCount * sizeof(uint16_t),
+			shortIndices.data());
+	}
+	else {
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t),
+			indices);
+	}
+	m_indexCount += indexCount;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Mesh3D.h"
+#include "GLObject.h"
+
+/**
+ * @brief Where one mesh lives inside a GeometryArena.
+ */
+struct GeometryRange {
+	// Added to every index of the mesh by glDrawElementsBaseVertex.
+	int32_t baseVertex;
+	size_t vertexCount;
+	size_t firstIndex;
+	size_t indexCount;
+	// For packed arenas, maps the mesh's unorm16 positions back into model space.
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+	// Model-space bounds of the mesh's vertices.
+	BoundingBox bounds;
+};
+
+/**
+ * @brief One vertex buffer, one index buffer and one vertex array shared by many meshes, each of
+ * which is a GeometryRange drawn with glDrawElementsBaseVertex. Merging the meshes of a model
+ * this way replaces a VAO, VBO and EBO per mesh with one of each per model.
+ *
+ * The arena deletes its GL objects when destroyed; Mesh3D objects drawn from it hold it through
+ * a shared_ptr. A Mesh3D constructed from its own vertices gets an arena of its own.
+ */
+class GeometryArena {
+private:
+	GLBuffer m_vbo;
+	GLBuffer m_ebo;
+	GLVertexArray m_vao;
+	VertexFormat m_vertexFormat;
+	// GL_UNSIGNED_SHORT if every mesh in the arena has fewer than 65536 vertices. Indices are
+	// relative to each mesh's base vertex, so the arena as a whole may hold more.
+	uint32_t m_indexType;
+	size_t m_vertexCapacity;
+	size_t m_indexCapacity;
+	size_t m_vertexCount;
+	size_t m_indexCount;
+
+	/**
+	 * @brief Copies indices into the next free part of the index buffer, narrowing them if the
+	 * arena uses 16-bit indices. The arena's vertex array must be bound.
+	 */
+	void uploadIndices(const uint32_t* indices, size_t indexCount);
+
+public:
+	/**
+	 * @brief Allocates buffers for the given number of vertices and indices. largestMeshVertices
+	 * is the vertex count of the largest mesh that will be appended, which decides the index type.
+	 */
+	GeometryArena(VertexFormat vertexFormat, size_t vertexCapacity, size_t indexCapacity,
+		size_t largestMeshVertices);
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	/**
+	 * @brief Copies one mesh into the next free part of the buffers and returns where it went.
+	 * Throws std::runtime_error if the arena is too small for it.
+	 */
+	GeometryRange append(const Vertex3D* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	/**
+	 * @brief Copies another index buffer for the vertices of an appended range, e.g. a level of
+	 * detail, and returns the range that draws it. Throws std::runtime_error if the arena is too
+	 * small for it.
+	 */
+	GeometryRange appendIndices(const GeometryRange& vertices, const uint32_t* indices, size_t indexCount);
+
+	uint32_t vao() const { return m_vao.id(); }
+	uint32_t indexType() const { return m_indexType; }
+	size_t indexSize() const { return m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+	VertexFormat vertexFormat() const { return m_vertexFormat; }
+	size_t vertexCount() const { return m_vertexCount; }
+	size_t indexCount() const { return m_indexCount; }
+};
@@ -0,0 +1,87 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+	: m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr) {
+	m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(m_file, &size);
+	m_size = static_cast<size_t>(size.QuadPart);
+	if (m_size == 0) {
+		return;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr) {
+		CloseHandle(m_file);
+		throw std::runtime_error("Failed to map " + path.string());
+	}
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr) {
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("Failed to map " + path.string());
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+	: m_data(nullptr), m_size(0), m_fd(-1) {
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd < 0) {
+		throw std::runtime_error("Failed to open " + path.string());
+	}
+
+	struct stat info;
+	fstat(m_fd, &info);
+	m_size = static_cast<size_t>(info.st_size);
+	if (m_size == 0) {
+		return;
+	}
+
+	void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if (mapped == MAP_FAILED) {
+		close(m_fd);
+		throw std::runtime_error("Failed to map " + path.string());
+	}
+	// The whole file is streamed to the GPU front to back.
+	madvise(mapped, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const uint8_t*>(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+}
+#endif
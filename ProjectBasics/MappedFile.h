@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief A read-only view of an entire file mapped into the process's address space. Pages are
+ * read from disk on first access, so nothing is copied until the data is actually used.
+ */
+class MappedFile {
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+
+public:
+	/**
+	 * @brief Maps the file at the given path. Throws std::runtime_error if it cannot be opened.
+	 */
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+};
@@ -1,5 +1,11 @@
 #include <iostream>
+#include <cstddef>
+#include <algorithm>
 #include "Mesh3D.h"
+#include "GeometryArena.h"
+#include "GLStateCache.h"
+#include "MultiDrawIndirect.h"
+#include "VertexPacking.h"
 #include <glad/glad.h>
 #include <GL/GL.h>
 
@@ -9,28 +15,69 @@ using sf::Vector2u;
 using glm::mat4;
 using glm::vec4;
 
+BoundingBox vertexBounds(const Vertex3D* vertices, size_t vertexCount) {
+	BoundingBox bounds;
+	for (size_t i = 0; i < vertexCount; i++) {
+		bounds.expand(glm::vec3(vertices[i].x, vertices[i].y, vertices[i].z));
+	}
+	return bounds;
+}
+
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 	Texture texture) 
-	: Mesh3D(std::move(vertices), std::move(faces), std::vector<Texture>{texture}) {
+	: Mesh3D(std::move(vertices), std::move(faces), std::vector<Texture>{ std::move(texture) }) {
 }
 
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces, std::vector<Texture>&& textures)
- : m_vertexCount(vertices.size()), m_faceCount(faces.size()), m_textures(textures) {
+	: Mesh3D(vertices.data(), vertices.size(), faces.data(), faces.size(), std::move(textures)) {
+}
+
+namespace {
+	/**
+	 * @brief Uploads one mesh into an arena sized for exactly it.
+	 */
+	std::pair<std::shared_ptr<const GeometryArena>, GeometryRange> uploadAlone(const Vertex3D* vertices,
+		size_t vertexCount, const uint32_t* faces, size_t faceCount, VertexFormat vertexFormat) {
+		auto arena = std::make_shared<GeometryArena>(vertexFormat, vertexCount, faceCount, vertexCount);
+		GeometryRange range = arena->append(vertices, vertexCount, faces, faceCount);
+		return { std::move(arena), range };
+	}
+}
+
+Mesh3D::Mesh3D(const Vertex3D* vertices, size_t vertexCount, const uint32_t* faces, size_t faceCount,
+	std::vector<Texture>&& textures, VertexFormat vertexFormat)
+	: Mesh3D(uploadAlone(vertices, vertexCount, faces, faceCount, vertexFormat), std::move(textures)) {
+}
 
-	// Generate a vertex array object on the GPU.
-	glGenVertexArrays(1, &m_vao);
-	// "Bind" the newly-generated vao, which makes future functions operate on that specific object.
-	glBindVertexArray(m_vao);
+Mesh3D::Mesh3D(std::pair<std::shared_ptr<const GeometryArena>, GeometryRange>&& geometry,
+	std::vector<Texture>&& textures)
+	: Mesh3D(std::move(geometry.first), geometry.second, std::move(textures)) {
+}
+
+Mesh3D::Mesh3D(std::shared_ptr<const GeometryArena> arena, const GeometryRange& range,
+	std::vector<Texture>&& textures)
+	: m_vao(arena->vao()), m_textures(std::move(textures)), m_vertexCount(range.vertexCount),
+	m_faceCount(range.indexCount), m_indexType(arena->indexType()), m_indexOffset(range.firstIndex * arena->indexSize()),
+	m_baseVertex(range.baseVertex), m_vertexFormat(arena->vertexFormat()), m_positionOffset(range.positionOffset),
+	m_positionScale(range.positionScale), m_bounds(range.bounds), m_boundingSphere(BoundingSphere::around(m_bounds)),
+	m_translucent(false), m_arena(std::move(arena)) {
+}
 
-	// Generate a vertex buffer object on the GPU.
-	uint32_t vbo;
-	glGenBuffers(1, &vbo);
+void Mesh3D::setVertexLayout(VertexFormat vertexFormat) {
+	if (vertexFormat == VertexFormat::Packed) {
+		// Attribute 0 is position: 3 normalized unsigned shorts, scaled into the mesh bounds by the shader.
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, true, sizeof(PackedVertex3D), 0);
+		glEnableVertexAttribArray(0);
 
-	// "Bind" the newly-generated vbo, which makes future functions operate on that specific object.
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	// This vbo is now associated with m_vao.
-	// Copy the contents of the vertices list to the buffer that lives on the GPU.
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex3D), &vertices[0], GL_STATIC_DRAW);
+		// Attribute 1 is the octahedral normal: 2 normalized shorts, decoded by the shader.
+		glVertexAttribPointer(1, 2, GL_SHORT, true, sizeof(PackedVertex3D), (void*)8);
+		glEnableVertexAttribArray(1);
+
+		// Attribute 2 is texture coordinates: 2 half floats.
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, false, sizeof(PackedVertex3D), (void*)12);
+		glEnableVertexAttribArray(2);
+		return;
+	}
 
 	// Inform OpenGL how to interpret the buffer. Each vertex now has TWO attributes; a position and a color.
 	// Atrribute 0 is position: 3 contiguous floats (x/y/z)...
@@ -44,36 +91,140 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 	// Attribute 2 is texture coordinates (u, v): 2 contiguous floats, starting 24 bytes after the beginning of the vertex.
 	glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vertex3D), (void*)24);
 	glEnableVertexAttribArray(2);
+}
 
-	// Generate a second buffer, to store the indices of each triangle in the mesh.
-	uint32_t ebo;
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint32_t), &faces[0], GL_STATIC_DRAW);
+void Mesh3D::setInstanceLayout(uint32_t instanceBuffer, size_t firstInstance) {
+	// GL 3.3 has no base instance for draw calls, so the attributes themselves start at the first
+	// instance. A matrix attribute takes one location per column: the model matrix 3 to 6, the
+	// model-view-projection matrix 7 to 10, and the normal matrix's 3x3 part 11 to 13. The packed
+	// position bounds follow at 14 and 15.
+	GLStateCache::global().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	size_t offset = firstInstance * sizeof(MeshInstance);
+	struct InstanceAttribute {
+		size_t offset;
+		int32_t columns;
+		int32_t rows;
+	};
+	const InstanceAttribute attributes[] = {
+		{ offsetof(MeshInstance, object) + offsetof(ObjectConstants, model), 4, 4 },
+		{ offsetof(MeshInstance, object) + offsetof(ObjectConstants, modelViewProjection), 4, 4 },
+		{ offsetof(MeshInstance, object) + offsetof(ObjectConstants, normalMatrix), 3, 3 },
+		{ offsetof(MeshInstance, positionOffset), 1, 3 },
+		{ offsetof(MeshInstance, positionScale), 1, 3 },
+	};
+	uint32_t location = 3;
+	for (const auto& attribute : attributes) {
+		for (int32_t column = 0; column < attribute.columns; column++, location++) {
+			glVertexAttribPointer(location, attribute.rows, GL_FLOAT, false, sizeof(MeshInstance),
+				reinterpret_cast<void*>(offset + attribute.offset + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+			glEnableVertexAttribArray(location);
+		}
+	}
+}
+
+size_t Mesh3D::firstIndex() const {
+	return m_indexOffset / (m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+bool Mesh3D::drawsSameAs(const Mesh3D& other) const {
+	return bindsSameAs(other) && m_indexOffset == other.m_indexOffset && m_baseVertex == other.m_baseVertex
+		&& m_faceCount == other.m_faceCount;
+}
 
-	// Unbind the vertex array, so no one else can accidentally mess with it.
-	glBindVertexArray(0);
+bool Mesh3D::bindsSameAs(const Mesh3D& other) const {
+	if (m_vao != other.m_vao || m_indexType != other.m_indexType || m_vertexFormat != other.m_vertexFormat
+		|| m_textures.size() != other.m_textures.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < m_textures.size(); i++) {
+		if (m_textures[i].textureId != other.m_textures[i].textureId
+			|| m_textures[i].samplerName != other.m_textures[i].samplerName) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void Mesh3D::addTexture(Texture texture)
 {
-	m_textures.push_back(texture);
+	for (auto& lod : m_lods) {
+		lod.addTexture(texture);
+	}
+	m_textures.push_back(std::move(texture));
+	// The sampler handles no longer cover every texture.
+	m_uniformHandles.programId = 0;
 }
 
-void Mesh3D::render(sf::RenderWindow& window, ShaderProgram& program) const {
-	// Activate the mesh's vertex array.
-	glBindVertexArray(m_vao);
+void Mesh3D::setTranslucent(bool translucent) {
+	m_translucent = translucent;
+	for (auto& lod : m_lods) {
+		lod.setTranslucent(translucent);
+	}
+}
+
+void Mesh3D::addLod(Mesh3D&& lod) {
+	m_lods.push_back(std::move(lod));
+}
+
+const Mesh3D& Mesh3D::lod(size_t level) const {
+	if (level == 0 || m_lods.empty()) {
+		return *this;
+	}
+	return m_lods[std::min(level, m_lods.size()) - 1];
+}
+
+void Mesh3D::bind(ShaderProgram& program) const {
+	// Activate the mesh's vertex array. Bindings are left in place after drawing, so that the
+	// state cache can skip rebinding them for the next mesh that shares them.
+	auto& state = GLStateCache::global();
+	state.bindVertexArray(m_vao);
+
+	auto& handles = m_uniformHandles;
+	if (handles.programId != program.id()) {
+		handles.programId = program.id();
+		handles.packedVertices = program.uniform("packedVertices");
+		handles.positionOffset = program.uniform("positionOffset");
+		handles.positionScale = program.uniform("positionScale");
+		handles.samplers.clear();
+		for (auto& texture : m_textures) {
+			handles.samplers.push_back(program.uniform(texture.samplerName));
+		}
+	}
+	program.setUniform(handles.packedVertices, m_vertexFormat == VertexFormat::Packed);
+	if (m_vertexFormat == VertexFormat::Packed) {
+		program.setUniform(handles.positionOffset, m_positionOffset);
+		program.setUniform(handles.positionScale, m_positionScale);
+	}
 	for (auto i = 0; i < m_textures.size(); i++) {
-		program.setUniform(m_textures[i].samplerName, i);
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textures[i].textureId);
+		program.setUniform(handles.samplers[i], i);
+		state.bindTexture(i, m_textures[i].textureId);
 	}
+}
+
+void Mesh3D::render(sf::RenderWindow& window, ShaderProgram& program) const {
+	bind(program);
 
 	// Draw the vertex array, using its "element buffer" to identify the faces.
-	glDrawElements(GL_TRIANGLES, m_faceCount, GL_UNSIGNED_INT, nullptr);
-	// Deactivate the mesh's vertex array and texture.
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glDrawElementsBaseVertex(GL_TRIANGLES, m_faceCount, m_indexType, reinterpret_cast<void*>(m_indexOffset),
+		m_baseVertex);
+}
+
+void Mesh3D::renderInstanced(sf::RenderWindow& window, ShaderProgram& program, uint32_t instanceBuffer,
+	size_t firstInstance, size_t instanceCount) const {
+	bind(program);
+	setInstanceLayout(instanceBuffer, firstInstance);
+
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_faceCount, m_indexType, reinterpret_cast<void*>(m_indexOffset),
+		static_cast<int32_t>(instanceCount), m_baseVertex);
+}
+
+void Mesh3D::renderIndirect(sf::RenderWindow& window, ShaderProgram& program, uint32_t instanceBuffer,
+	MultiDrawIndirect& indirect, size_t firstCommand, size_t commandCount) const {
+	bind(program);
+	// Indirect draws honor each command's base instance, so the attributes start at instance 0.
+	setInstanceLayout(instanceBuffer, 0);
+	indirect.draw(m_indexType, firstCommand, commandCount);
 }
 
 Mesh3D Mesh3D::square(const std::vector<Texture> &textures) {
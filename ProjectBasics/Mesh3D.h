@@ -2,8 +2,16 @@
 #include <SFML/Graphics.hpp>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include <memory>
+#include <utility>
 #include "ShaderProgram.h"
 #include "Texture.h"
+#include "UniformBlocks.h"
+#include "Bounds.h"
+
+class GeometryArena;
+struct GeometryRange;
+class MultiDrawIndirect;
 
 struct Vertex3D {
 	float_t x;
@@ -22,9 +30,43 @@ struct Vertex3D {
 		x(px), y(py), z(pz), nx(normX), ny(normY), nz(normZ), u(texU), v(texV) {}
 };
 
+// Baked model files store vertices byte-for-byte in this layout.
+static_assert(sizeof(Vertex3D) == 8 * sizeof(float_t), "Vertex3D must be tightly packed");
+
+/**
+ * @brief The bounding box of the vertices' positions.
+ */
+BoundingBox vertexBounds(const Vertex3D* vertices, size_t vertexCount);
+
+/**
+ * @brief How a mesh stores its vertices in VRAM.
+ */
+enum class VertexFormat : uint32_t {
+	// Vertex3D as-is: 32 bytes of floats.
+	Float,
+	// PackedVertex3D: 16 bytes of unorm16 positions relative to the mesh bounds, octahedral snorm16
+	// normals, and half-float texture coordinates. See VertexPacking.h.
+	Packed
+};
+
+/**
+ * @brief What an instanced draw reads for each instance: the object's transforms, and the mesh's
+ * packed-position bounds, so that packed meshes with different bounds can share one indirect draw.
+ */
+struct MeshInstance {
+	ObjectConstants object;
+	// Only xyz are used.
+	glm::vec4 positionOffset;
+	glm::vec4 positionScale;
+};
+
 /**
  * @brief Represents a mesh whose vertices have positions, normal vectors, and texture coordinates;
  * as well as a list of Textures to bind when rendering the mesh.
+ *
+ * The vertex array and buffers belong to a GeometryArena, which the mesh holds through a
+ * shared_ptr: copies of a mesh, like those in copies of a cached model, share its GL objects, and
+ * the last one destroyed deletes them. Moving a mesh moves that ownership without touching GL.
  */
 class Mesh3D {
 private:
@@ -32,6 +74,50 @@ private:
 	std::vector<Texture> m_textures;
 	size_t m_vertexCount;
 	size_t m_faceCount;
+	// GL_UNSIGNED_SHORT when every vertex can be addressed with 16 bits, otherwise GL_UNSIGNED_INT.
+	uint32_t m_indexType;
+	// Where the mesh's indices and vertices start in the buffers of m_vao. Both are zero unless
+	// the mesh shares its arena with other meshes.
+	size_t m_indexOffset;
+	int32_t m_baseVertex;
+	VertexFormat m_vertexFormat;
+	// For packed meshes, maps unorm16 positions back into model space.
+	glm::vec3 m_positionOffset;
+	glm::vec3 m_positionScale;
+	// Model-space bounds of the vertices, for culling.
+	BoundingBox m_bounds;
+	BoundingSphere m_boundingSphere;
+	// Translucent meshes are drawn after opaque ones, back to front, with blending.
+	bool m_translucent;
+	// Keeps the arena's vertex array and buffers alive while this mesh draws from them.
+	std::shared_ptr<const GeometryArena> m_arena;
+	// Simplified versions of the mesh, from the most to the least detailed, drawing other index
+	// ranges of the same vertices.
+	std::vector<Mesh3D> m_lods;
+
+	/**
+	 * @brief Handles of the uniforms bind() sets, resolved for the program it last drew with, so
+	 * drawing looks up no names.
+	 */
+	struct UniformHandles {
+		uint32_t programId = 0;
+		UniformHandle packedVertices;
+		UniformHandle positionOffset;
+		UniformHandle positionScale;
+		std::vector<UniformHandle> samplers;
+	};
+	mutable UniformHandles m_uniformHandles;
+
+	/**
+	 * @brief Binds the mesh's vertex array and textures and sets its per-mesh uniforms.
+	 */
+	void bind(ShaderProgram& program) const;
+
+	/**
+	 * @brief Constructs a Mesh3D that draws the one range of an arena of its own.
+	 */
+	Mesh3D(std::pair<std::shared_ptr<const GeometryArena>, GeometryRange>&& geometry,
+		std::vector<Texture>&& textures);
 
 public:
 	Mesh3D() = delete;
@@ -46,6 +132,73 @@ public:
 	Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 		std::vector<Texture>&& textures);
 
+	/**
+	 * @brief Constructs a Mesh3D by uploading vertices and faces directly from memory owned by
+	 * the caller, e.g. a memory-mapped baked model file, into an arena of its own. A Packed mesh
+	 * quantizes the vertices before uploading them, and a mesh with fewer than 65536 vertices
+	 * uploads 16-bit indices.
+	 */
+	Mesh3D(const Vertex3D* vertices, size_t vertexCount, const uint32_t* faces, size_t faceCount,
+		std::vector<Texture>&& textures, VertexFormat vertexFormat = VertexFormat::Float);
+
+	/**
+	 * @brief Constructs a Mesh3D that draws one range of a GeometryArena.
+	 */
+	Mesh3D(std::shared_ptr<const GeometryArena> arena, const GeometryRange& range, std::vector<Texture>&& textures);
+
+	/**
+	 * @brief Describes the attributes of the given vertex format to the currently bound vertex
+	 * array, reading from the currently bound GL_ARRAY_BUFFER.
+	 */
+	static void setVertexLayout(VertexFormat vertexFormat);
+
+	/**
+	 * @brief Describes per-instance data to the currently bound vertex array, as attributes 3 to
+	 * 15 (one matrix column each, then the packed-position bounds), reading from the given buffer
+	 * of MeshInstance starting at the given instance.
+	 */
+	static void setInstanceLayout(uint32_t instanceBuffer, size_t firstInstance);
+
+	uint32_t vao() const { return m_vao; }
+	VertexFormat vertexFormat() const { return m_vertexFormat; }
+	size_t indexOffset() const { return m_indexOffset; }
+	uint32_t indexType() const { return m_indexType; }
+	// The offset of the mesh's first index, in indices rather than bytes.
+	size_t firstIndex() const;
+	size_t indexCount() const { return m_faceCount; }
+	int32_t baseVertex() const { return m_baseVertex; }
+	const std::vector<Texture>& textures() const { return m_textures; }
+	const glm::vec3& positionOffset() const { return m_positionOffset; }
+	const glm::vec3& positionScale() const { return m_positionScale; }
+	const BoundingBox& bounds() const { return m_bounds; }
+	const BoundingSphere& boundingSphere() const { return m_boundingSphere; }
+	bool isTranslucent() const { return m_translucent; }
+	void setTranslucent(bool translucent);
+
+	/**
+	 * @brief Adds a simplified version of the mesh as its next, coarser level of detail.
+	 */
+	void addLod(Mesh3D&& lod);
+	// The number of levels of detail, counting the full mesh as level 0.
+	size_t lodCount() const { return m_lods.size() + 1; }
+	/**
+	 * @brief The mesh to draw at the given level of detail: the full mesh for level 0, and the
+	 * coarsest level for any level past it.
+	 */
+	const Mesh3D& lod(size_t level) const;
+
+	/**
+	 * @brief True if the two meshes draw the same triangles from the same buffers with the same
+	 * textures, so that they can be drawn together as instances.
+	 */
+	bool drawsSameAs(const Mesh3D& other) const;
+
+	/**
+	 * @brief True if the two meshes draw from the same buffers, in the same vertex format, with
+	 * the same textures, so that one indirect draw can cover both.
+	 */
+	bool bindsSameAs(const Mesh3D& other) const;
+
 	void addTexture(Texture texture);
 
 	/**
@@ -67,5 +220,22 @@ public:
 	 * @brief Renders the mesh to the given context.
 	 */
 	void render(sf::RenderWindow& window, ShaderProgram& program) const;
+
+	/**
+	 * @brief Renders instanceCount copies of the mesh with a single draw call, each transformed by
+	 * one of the ObjectConstants in instanceBuffer, starting at firstInstance. The program must read
+	 * its transforms from the instance attributes described by setInstanceLayout.
+	 */
+	void renderInstanced(sf::RenderWindow& window, ShaderProgram& program, uint32_t instanceBuffer,
+		size_t firstInstance, size_t instanceCount) const;
+
+	/**
+	 * @brief Binds the mesh and draws commandCount commands already uploaded to the indirect
+	 * buffer, starting at firstCommand, with one multi-draw call. Every command must draw a mesh
+	 * that bindsSameAs this one, and take its instances from instanceBuffer through its base
+	 * instance.
+	 */
+	void renderIndirect(sf::RenderWindow& window, ShaderProgram& program, uint32_t instanceBuffer,
+		MultiDrawIndirect& indirect, size_t firstCommand, size_t commandCount) const;
 	
 };
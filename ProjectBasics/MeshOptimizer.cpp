@@ -0,0 +1,551 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+	// Tuning values from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	const size_t FORSYTH_CACHE_SIZE = 32;
+	const float_t FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	const float_t FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float_t FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	const float_t FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	/**
+	 * @brief How much adding a triangle that uses this vertex would help: more if the vertex is
+	 * near the front of the cache, and more if few triangles still need it.
+	 */
+	float_t forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f;
+		}
+		float_t score = 0;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				// The vertices of the last triangle get a fixed score, so the optimizer does not
+				// favor any particular winding.
+				score = FORSYTH_LAST_TRIANGLE_SCORE;
+			}
+			else {
+				float_t scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+			}
+		}
+		return score + FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float_t>(remainingTriangles),
+			-FORSYTH_VALENCE_BOOST_POWER);
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize) {
+	if (indices.empty() || vertexCount == 0) {
+		return VertexCacheStats{ 0, 0 };
+	}
+	// A vertex is in a FIFO cache if fewer than cacheSize misses happened since it was loaded.
+	std::vector<size_t> loadedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+			loadedAt[index] = ++misses;
+		}
+	}
+	return VertexCacheStats{
+		static_cast<float_t>(misses) / (indices.size() / 3),
+		static_cast<float_t>(misses) / vertexCount
+	};
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// For each vertex, the triangles that use it and have not been emitted yet, stored as one
+	// list per vertex inside a single array.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices) {
+		remaining[index]++;
+	}
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	std::vector<uint32_t> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			vertexTriangles[firstTriangle[v] + filled[v]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float_t> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	}
+	std::vector<float_t> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+			+ vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	std::vector<uint32_t> cache, nextCache;
+	size_t nextUnemitted = 0;
+	int64_t best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+	while (output.size() < indices.size()) {
+		if (best < 0) {
+			// Nothing in the cache has work left; continue with any triangle not yet emitted.
+			while (emitted[nextUnemitted]) {
+				nextUnemitted++;
+			}
+			best = static_cast<int64_t>(nextUnemitted);
+		}
+
+		emitted[best] = true;
+		const uint32_t* triangle = &indices[best * 3];
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = triangle[k];
+			output.push_back(v);
+			// Remove the triangle from the vertex's list of remaining triangles.
+			auto begin = vertexTriangles.begin() + firstTriangle[v];
+			auto end = begin + remaining[v];
+			std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best)), end - 1);
+			remaining[v]--;
+		}
+
+		// The triangle's vertices move to the front of the LRU cache.
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t v : cache) {
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+				nextCache.push_back(v);
+			}
+		}
+		std::swap(cache, nextCache);
+
+		// Rescore every vertex that is, or just was, in the cache, and the triangles that use them.
+		for (size_t i = 0; i < cache.size(); i++) {
+			uint32_t v = cache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+			vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+		}
+		best = -1;
+		float_t bestScore = -1;
+		for (uint32_t v : cache) {
+			for (uint32_t i = firstTriangle[v]; i < firstTriangle[v] + remaining[v]; i++) {
+				uint32_t t = vertexTriangles[i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+					+ vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+		if (cache.size() > FORSYTH_CACHE_SIZE) {
+			cache.resize(FORSYTH_CACHE_SIZE);
+		}
+	}
+
+	indices = std::move(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices, float_t threshold) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+	const size_t CACHE_SIZE = 16;
+
+	// Split the triangles into clusters wherever a triangle misses the cache on all three
+	// vertices: reordering whole clusters then costs little cache efficiency.
+	std::vector<size_t> clusterStarts;
+	std::vector<size_t> loadedAt(vertices.size(), 0);
+	size_t misses = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		size_t triangleMisses = 0;
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			if (loadedAt[v] == 0 || misses - loadedAt[v] >= CACHE_SIZE) {
+				loadedAt[v] = ++misses;
+				triangleMisses++;
+			}
+		}
+		if (t == 0 || triangleMisses == 3) {
+			clusterStarts.push_back(t);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2) {
+		return;
+	}
+
+	auto position = [&vertices](uint32_t v) { return glm::vec3(vertices[v].x, vertices[v].y, vertices[v].z); };
+
+	// Each cluster's area-weighted centroid and normal.
+	glm::vec3 meshCentroid(0);
+	float_t meshArea = 0;
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0)), clusterNormals(clusterCount, glm::vec3(0));
+	for (size_t c = 0; c < clusterCount; c++) {
+		float_t clusterArea = 0;
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), d = position(indices[t * 3 + 2]);
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float_t area = glm::length(normal);
+			clusterCentroids[c] += (a + b + d) / 3.0f * area;
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		clusterCentroids[c] = clusterArea > 0 ? clusterCentroids[c] / clusterArea : position(indices[clusterStarts[c] * 3]);
+	}
+	if (meshArea > 0) {
+		meshCentroid /= meshArea;
+	}
+
+	// Clusters that face away from the middle of the mesh are the ones most likely to occlude the rest.
+	std::vector<float_t> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		float_t length = glm::length(clusterNormals[c]);
+		sortKeys[c] = length > 0 ? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / length) : 0;
+	}
+	std::vector<size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (size_t c : order) {
+		sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+	if (analyzeVertexCache(sorted, vertices.size(), CACHE_SIZE).acmr
+		<= analyzeVertexCache(indices, vertices.size(), CACHE_SIZE).acmr * threshold) {
+		indices = std::move(sorted);
+	}
+}
+
+void optimizeVertexFetch(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices) {
+	const uint32_t UNUSED = UINT32_MAX;
+	std::vector<uint32_t> remap(vertices.size(), UNUSED);
+	std::vector<Vertex3D> reordered;
+	reordered.reserve(vertices.size());
+	for (uint32_t& index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(reordered);
+}
+
+void optimizeMesh(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices) {
+	optimizeVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices);
+}
+
+namespace {
+	// A level of detail must have at most this fraction of the previous level's indices.
+	const float_t LOD_MIN_REDUCTION = 0.9f;
+	// A collapse may turn no surviving triangle's normal by more than this angle's cosine (60
+	// degrees), which keeps triangles from flipping over the course of many collapses.
+	const double MAX_NORMAL_TURN_COSINE = 0.5;
+
+	/**
+	 * @brief The sum of squared distances to a set of planes, as a symmetric 4x4 matrix: the
+	 * upper triangle of A, the vector b and the constant c of p.A.p + 2 b.p + c.
+	 */
+	struct Quadric {
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+
+		void addPlane(const glm::dvec3& normal, double distance) {
+			a00 += normal.x * normal.x;
+			a01 += normal.x * normal.y;
+			a02 += normal.x * normal.z;
+			a11 += normal.y * normal.y;
+			a12 += normal.y * normal.z;
+			a22 += normal.z * normal.z;
+			b0 += normal.x * distance;
+			b1 += normal.y * distance;
+			b2 += normal.z * distance;
+			c += distance * distance;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00;
+			a01 += other.a01;
+			a02 += other.a02;
+			a11 += other.a11;
+			a12 += other.a12;
+			a22 += other.a22;
+			b0 += other.b0;
+			b1 += other.b1;
+			b2 += other.b2;
+			c += other.c;
+		}
+
+		double error(const glm::dvec3& p) const {
+			double quadratic = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+				+ 2 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z);
+			return std::max(quadratic + 2 * (b0 * p.x + b1 * p.y + b2 * p.z) + c, 0.0);
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	/**
+	 * @brief Identifies a vertex position by its exact bits, so that seam vertices, which share a
+	 * position but not their other attributes, are found.
+	 */
+	struct PositionKey {
+		float_t x, y, z;
+
+		bool operator==(const PositionKey& other) const {
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	struct PositionKeyHash {
+		size_t operator()(const PositionKey& key) const {
+			std::hash<float_t> hash;
+			return hash(key.x) ^ (hash(key.y) * 31) ^ (hash(key.z) * 961);
+		}
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float_t maxError, float_t attributeWeight, float_t* resultError) {
+	std::vector<uint32_t> result = indices;
+	double largestError = 0;
+	size_t vertexCount = vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0) {
+		if (resultError) {
+			*resultError = 0;
+		}
+		return result;
+	}
+
+	// Errors are measured in a space where the mesh's bounds have radius 1.
+	BoundingBox bounds = vertexBounds(vertices.data(), vertexCount);
+	glm::dvec3 center(bounds.center());
+	double radius = glm::length(glm::dvec3(bounds.extent()));
+	double inverseRadius = radius > 0 ? 1 / radius : 1;
+	std::vector<glm::dvec3> positions(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		positions[v] = (glm::dvec3(vertices[v].x, vertices[v].y, vertices[v].z) - center) * inverseRadius;
+	}
+
+	// Every vertex is represented by the first vertex at its position; quadrics belong to these.
+	std::vector<uint32_t> positionOf(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAt;
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			auto [found, inserted] = firstAt.emplace(PositionKey{ vertices[v].x, vertices[v].y, vertices[v].z }, v);
+			positionOf[v] = found->second;
+			if (!inserted) {
+				locked[v] = true;
+				locked[found->second] = true;
+			}
+		}
+	}
+
+	// Edges used by other than two triangles are open borders or non-manifold; keep them in place.
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	for (size_t t = 0; t < result.size(); t += 3) {
+		for (size_t k = 0; k < 3; k++) {
+			edgeUses[edgeKey(positionOf[result[t + k]], positionOf[result[t + (k + 1) % 3]])]++;
+		}
+	}
+	for (size_t t = 0; t < result.size(); t += 3) {
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t a = positionOf[result[t + k]];
+			uint32_t b = positionOf[result[t + (k + 1) % 3]];
+			if (edgeUses[edgeKey(a, b)] != 2) {
+				locked[a] = true;
+				locked[b] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < result.size(); t += 3) {
+		const glm::dvec3& p0 = positions[result[t]];
+		glm::dvec3 normal = glm::cross(positions[result[t + 1]] - p0, positions[result[t + 2]] - p0);
+		double length = glm::length(normal);
+		if (length == 0) {
+			continue;
+		}
+		normal /= length;
+		double distance = -glm::dot(normal, p0);
+		for (size_t k = 0; k < 3; k++) {
+			quadrics[positionOf[result[t + k]]].addPlane(normal, distance);
+		}
+	}
+
+	auto attributeDistance2 = [&vertices](uint32_t a, uint32_t b) {
+		auto& va = vertices[a];
+		auto& vb = vertices[b];
+		glm::dvec3 normal(va.nx - vb.nx, va.ny - vb.ny, va.nz - vb.nz);
+		glm::dvec2 texture(va.u - vb.u, va.v - vb.v);
+		return glm::dot(normal, normal) + glm::dot(texture, texture);
+	};
+
+	double maxCost = double(maxError) * maxError;
+	double attributeScale = double(attributeWeight) * attributeWeight;
+	std::vector<uint32_t> remap(vertexCount);
+	std::iota(remap.begin(), remap.end(), 0);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> triangleCounts(vertexCount), firstTriangle(vertexCount + 1), vertexTriangles;
+	std::vector<Collapse> collapses;
+
+	// Each pass collapses the cheapest edges whose neighborhoods do not overlap, then rebuilds the
+	// triangle list, until the target is reached or nothing more can be collapsed.
+	while (result.size() > targetIndexCount) {
+		std::fill(triangleCounts.begin(), triangleCounts.end(), 0);
+		for (uint32_t index : result) {
+			triangleCounts[index]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			firstTriangle[v + 1] = firstTriangle[v] + triangleCounts[v];
+		}
+		vertexTriangles.resize(result.size());
+		std::fill(triangleCounts.begin(), triangleCounts.end(), 0);
+		for (size_t t = 0; t < result.size() / 3; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t v = result[t * 3 + k];
+				vertexTriangles[firstTriangle[v] + triangleCounts[v]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t a = result[t + k];
+				uint32_t b = result[t + (k + 1) % 3];
+				for (auto [from, to] : { std::make_pair(a, b), std::make_pair(b, a) }) {
+					if (locked[from] || from == to) {
+						continue;
+					}
+					Quadric combined = quadrics[positionOf[from]];
+					combined.add(quadrics[positionOf[to]]);
+					double cost = combined.error(positions[to]) + attributeScale * attributeDistance2(from, to);
+					if (cost <= maxCost) {
+						collapses.push_back(Collapse{ from, to, cost });
+					}
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// A collapse removes the two triangles on its edge.
+		size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t trianglesRemoved = 0;
+		std::fill(touched.begin(), touched.end(), false);
+		for (auto& collapse : collapses) {
+			if (trianglesRemoved >= trianglesToRemove) {
+				break;
+			}
+			uint32_t from = collapse.from;
+			uint32_t to = collapse.to;
+			if (touched[positionOf[from]] || touched[positionOf[to]]) {
+				continue;
+			}
+
+			// Moving the vertex must not flip, flatten or sharply turn any triangle that survives the
+			// collapse.
+			bool valid = true;
+			size_t removed = 0;
+			for (uint32_t i = firstTriangle[from]; valid && i < firstTriangle[from + 1]; i++) {
+				const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+					removed++;
+					continue;
+				}
+				glm::dvec3 before[3], after[3];
+				for (size_t k = 0; k < 3; k++) {
+					before[k] = positions[triangle[k]];
+					after[k] = triangle[k] == from ? positions[to] : before[k];
+				}
+				glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				valid = glm::dot(normalBefore, normalAfter)
+					> MAX_NORMAL_TURN_COSINE * glm::length(normalBefore) * glm::length(normalAfter);
+			}
+			if (!valid) {
+				continue;
+			}
+
+			// Every vertex around the collapse is left alone for the rest of the pass, so that the
+			// flip test above stays true.
+			for (uint32_t i = firstTriangle[from]; i < firstTriangle[from + 1]; i++) {
+				const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+				for (size_t k = 0; k < 3; k++) {
+					touched[positionOf[triangle[k]]] = true;
+				}
+			}
+			remap[from] = to;
+			quadrics[positionOf[to]].add(quadrics[positionOf[from]]);
+			largestError = std::max(largestError, collapse.cost);
+			trianglesRemoved += removed;
+		}
+		if (trianglesRemoved == 0) {
+			break;
+		}
+
+		size_t kept = 0;
+		for (size_t t = 0; t < result.size(); t += 3) {
+			uint32_t a = remap[result[t]];
+			uint32_t b = remap[result[t + 1]];
+			uint32_t c = remap[result[t + 2]];
+			if (a != b && b != c && c != a) {
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+		std::iota(remap.begin(), remap.end(), 0);
+	}
+
+	if (resultError) {
+		*resultError = static_cast<float_t>(std::sqrt(largestError));
+	}
+	return result;
+}
+
+std::vector<std::vector<uint32_t>> generateLods(const std::vector<Vertex3D>& vertices,
+	const std::vector<uint32_t>& indices, const LodSettings& settings) {
+	std::vector<std::vector<uint32_t>> levels;
+	size_t previousCount = indices.size();
+	for (float_t ratio : settings.ratios) {
+		size_t target = static_cast<size_t>(indices.size() / 3 * ratio) * 3;
+		auto level = simplifyMesh(vertices, indices, target, settings.maxError, settings.attributeWeight);
+		if (level.empty() || level.size() > previousCount * LOD_MIN_REDUCTION) {
+			break;
+		}
+		optimizeVertexCache(level, vertices.size());
+		previousCount = level.size();
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Mesh3D.h"
+
+/**
+ * Import-time reordering of triangle lists for the GPU. Nothing here touches OpenGL, so it runs
+ * wherever meshes are imported: on AssetLoader workers and in the offline baker.
+ */
+
+/**
+ * @brief How well an index buffer uses a simulated post-transform vertex cache.
+ */
+struct VertexCacheStats {
+	// Average cache miss ratio: vertex shader invocations per triangle. 0.5 is ideal, 3 is worst.
+	float_t acmr;
+	// Average transform to vertex ratio: vertex shader invocations per vertex. 1 is ideal.
+	float_t atvr;
+};
+
+/**
+ * @brief Simulates a FIFO post-transform cache of the given size over an indexed triangle list.
+ */
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+	size_t cacheSize = 16);
+
+/**
+ * @brief Reorders triangles so that consecutive triangles share vertices, using Tom Forsyth's
+ * linear-speed vertex cache optimization.
+ */
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+/**
+ * @brief Reorders clusters of a cache-optimized index buffer so that outward-facing clusters
+ * are drawn first, which lets early depth testing reject more of the triangles behind them.
+ * Clusters start wherever the cache is already cold, and the new order is kept only if it
+ * raises ACMR by no more than the given factor.
+ */
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex3D>& vertices,
+	float_t threshold = 1.05f);
+
+/**
+ * @brief Renumbers vertices in the order the index buffer first uses them, so vertex fetch
+ * walks memory linearly. Vertices no triangle refers to are dropped.
+ */
+void optimizeVertexFetch(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices);
+
+/**
+ * @brief Runs the vertex cache, overdraw and vertex fetch optimizations, in that order.
+ */
+void optimizeMesh(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices);
+
+/**
+ * @brief How to generate a chain of levels of detail for a mesh.
+ */
+struct LodSettings {
+	// The index count of each level relative to the full mesh, most detailed first. Empty means
+	// no levels are generated.
+	std::vector<float_t> ratios;
+	// The largest error a level may have, relative to the radius of the mesh's bounds. A level
+	// keeps more triangles than its ratio asks for rather than exceed it.
+	float_t maxError = 0.05f;
+	// What a unit of change in a removed vertex's normal or texture coordinates costs, in units of
+	// relative position error.
+	float_t attributeWeight = 0.05f;
+
+	/**
+	 * @brief Three levels, each with about half the triangles of the one before.
+	 */
+	static LodSettings standard() { return LodSettings{ { 0.5f, 0.25f, 0.125f } }; }
+
+	bool operator==(const LodSettings& other) const {
+		return ratios == other.ratios && maxError == other.maxError && attributeWeight == other.attributeWeight;
+	}
+};
+
+/**
+ * @brief Reduces a triangle list to at most targetIndexCount indices by quadric error edge
+ * collapse (Garland and Heckbert), cheapest collapses first. Each collapse moves a vertex onto a
+ * neighbor, so the result indexes the same vertices as the input. The cost of a collapse is the
+ * quadric error of the new position plus the change in normal and texture coordinates, weighted
+ * by attributeWeight. Vertices on open borders and on seams (where several vertices share a
+ * position) never move, and no collapse may flip a triangle or exceed maxError, so the result may
+ * keep more indices than asked for. The largest error of any collapse made is stored in
+ * resultError, if given.
+ */
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float_t maxError, float_t attributeWeight, float_t* resultError = nullptr);
+
+/**
+ * @brief Builds a chain of levels of detail: one index buffer over the same vertices for each ratio
+ * of the settings, each simplified from the full mesh and optimized for the vertex cache. The
+ * chain ends early at a level that would not be meaningfully smaller than the one before.
+ */
+std::vector<std::vector<uint32_t>> generateLods(const std::vector<Vertex3D>& vertices,
+	const std::vector<uint32_t>& indices, const LodSettings& settings);
@@ -0,0 +1,49 @@
+#include "ModelCache.h"
+#include "AssimpImport.h"
+#include "BakedModel.h"
+#include <filesystem>
+
+ModelCache::ModelCache() : m_requestCount(0) {
+	// The cached prototypes release their transforms when the cache is destroyed, so the
+	// TransformSystem must be constructed first, to be destroyed after it.
+	TransformSystem::global();
+}
+
+ModelCache& ModelCache::global() {
+	static ModelCache cache;
+	return cache;
+}
+
+Object3D ModelCache::load(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+	const LodSettings& lodSettings) {
+	++m_requestCount;
+
+	// Two spellings of the same file (e.g. "./models/x.gltf" and "models/x.gltf") must share
+	// one import, so the key uses the canonical form of the path.
+	Key key{ std::filesystem::weakly_canonical(path).string(), assimpImportFlags(flipTextureCoords), vertexFormat,
+		lodSettings };
+	auto existing = m_prototypes.find(key);
+	if (existing == m_prototypes.end()) {
+		// Prefer an up-to-date baked copy of the model, which skips Assimp entirely. Baked files
+		// carry no levels of detail, so models that need them are always imported.
+		auto prototype = lodSettings.ratios.empty() && isBakedModelCurrent(path, key.importFlags)
+			? loadBakedModel(bakedModelPath(path), vertexFormat)
+			: assimpLoad(path, flipTextureCoords, vertexFormat, lodSettings);
+		existing = m_prototypes.emplace(std::move(key), std::move(prototype)).first;
+	}
+
+	// Copying the prototype copies only the node hierarchy; its Mesh3D objects refer to the
+	// same vertex arrays and textures in VRAM.
+	return existing->second;
+}
+
+void ModelCache::add(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+	const LodSettings& lodSettings, Object3D&& prototype) {
+	Key key{ std::filesystem::weakly_canonical(path).string(), assimpImportFlags(flipTextureCoords), vertexFormat,
+		lodSettings };
+	m_prototypes.insert_or_assign(std::move(key), std::move(prototype));
+}
+
+void ModelCache::clear() {
+	m_prototypes.clear();
+}
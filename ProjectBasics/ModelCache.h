@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include "MeshOptimizer.h"
+#include "Object3D.h"
+#include "TransformSystem.h"
+
+/**
+ * @brief A process-wide cache of imported models. The first request for a model runs the full
+ * Assimp import (or loads its baked file, if one is up to date); every later request for the same file and import flags returns a new Object3D
+ * hierarchy whose meshes share the vertex arrays and textures of that first import.
+ */
+class ModelCache {
+private:
+	/**
+	 * @brief Identifies one import: the canonical path of the model file, the Assimp
+	 * post-processing flags it was imported with, the vertex format it was uploaded in, and the
+	 * levels of detail generated for it.
+	 */
+	struct Key {
+		std::string canonicalPath;
+		uint32_t importFlags;
+		VertexFormat vertexFormat;
+		LodSettings lodSettings;
+
+		bool operator==(const Key& other) const {
+			return importFlags == other.importFlags && vertexFormat == other.vertexFormat
+				&& lodSettings == other.lodSettings && canonicalPath == other.canonicalPath;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			return std::hash<std::string>()(key.canonicalPath) ^ (std::hash<uint32_t>()(key.importFlags) << 1)
+				^ (std::hash<uint32_t>()(static_cast<uint32_t>(key.vertexFormat)) << 2)
+				^ (std::hash<size_t>()(key.lodSettings.ratios.size()) << 3);
+		}
+	};
+
+	// The first import of each model, from which all instances are copied.
+	std::unordered_map<Key, Object3D, KeyHash> m_prototypes;
+
+	// How many times load() was called, to compare against the number of unique imports.
+	size_t m_requestCount;
+
+public:
+	ModelCache();
+
+	/**
+	 * @brief The cache shared by the whole process.
+	 */
+	static ModelCache& global();
+
+	/**
+	 * @brief Returns a new instance of the model at the given path, importing it only if no
+	 * earlier call loaded the same file with the same flags, vertex format and LOD settings.
+	 */
+	Object3D load(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat = VertexFormat::Float,
+		const LodSettings& lodSettings = LodSettings());
+
+	/**
+	 * @brief Adds a model that was imported elsewhere (e.g. by an AssetLoader), so that later
+	 * calls to load() for the same file, flags, vertex format and LOD settings return instances of it.
+	 */
+	void add(const std::string& path, bool flipTextureCoords, VertexFormat vertexFormat,
+		const LodSettings& lodSettings, Object3D&& prototype);
+
+	/**
+	 * @brief How many distinct models have been imported.
+	 */
+	size_t uniqueModels() const { return m_prototypes.size(); }
+
+	/**
+	 * @brief How many model instances have been requested.
+	 */
+	size_t requestCount() const { return m_requestCount; }
+
+	/**
+	 * @brief Forgets every cached import. Instances already handed out are unaffected.
+	 */
+	void clear();
+};
@@ -0,0 +1,62 @@
+#include "MultiDrawIndirect.h"
+#include "GLStateCache.h"
+#include <SFML/Window.hpp>
+#include <algorithm>
+#include <cstring>
+
+MultiDrawIndirect::MultiDrawIndirect()
+	: m_queried(false), m_multiDrawElementsIndirect(nullptr), m_buffer(), m_capacity(0), m_enabled(true) {}
+
+MultiDrawIndirect& MultiDrawIndirect::global() {
+	static MultiDrawIndirect indirect;
+	return indirect;
+}
+
+bool MultiDrawIndirect::supported() {
+	if (!m_queried) {
+		m_queried = true;
+		bool multiDraw = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+		bool baseInstance = multiDraw;
+		int32_t extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (int32_t i = 0; i < extensionCount; i++) {
+			auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (std::strcmp(name, "GL_ARB_multi_draw_indirect") == 0) {
+				multiDraw = true;
+			}
+			else if (std::strcmp(name, "GL_ARB_base_instance") == 0) {
+				baseInstance = true;
+			}
+		}
+		// Without base instances every draw would read the first instance's attributes.
+		if (multiDraw && baseInstance) {
+			m_multiDrawElementsIndirect = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC>(
+				sf::Context::getFunction("glMultiDrawElementsIndirect"));
+		}
+	}
+	return m_enabled && m_multiDrawElementsIndirect != nullptr;
+}
+
+void MultiDrawIndirect::upload(const std::vector<DrawElementsIndirectCommand>& commands) {
+	if (!m_buffer) {
+		m_buffer = GLBuffer::generate();
+	}
+	GLStateCache::global().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer.id());
+	// Reallocating orphans the storage the previous frame's draws may still be reading.
+	m_capacity = std::max(m_capacity, commands.size());
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand),
+		commands.data());
+}
+
+void MultiDrawIndirect::draw(uint32_t indexType, size_t firstCommand, size_t commandCount) {
+	GLStateCache::global().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer.id());
+	m_multiDrawElementsIndirect(GL_TRIANGLES, indexType,
+		reinterpret_cast<const void*>(firstCommand * sizeof(DrawElementsIndirectCommand)),
+		static_cast<int32_t>(commandCount), 0);
+}
+
+void MultiDrawIndirect::clear() {
+	m_buffer.reset();
+	m_capacity = 0;
+}
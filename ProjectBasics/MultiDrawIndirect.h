@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "GLObject.h"
+
+// Declared by glad only for profiles of OpenGL 4.0 and later.
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect,
+	GLsizei drawcount, GLsizei stride);
+
+/**
+ * @brief One draw of a glMultiDrawElementsIndirect call, laid out as GL reads it from the
+ * GL_DRAW_INDIRECT_BUFFER.
+ */
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;
+	// In indices, not bytes.
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	// Added to the instance number when fetching attributes with a divisor, so each draw reads its
+	// own slice of the instance buffer.
+	uint32_t baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(uint32_t), "DrawElementsIndirectCommand must be tightly packed");
+
+/**
+ * @brief Submits many draws of one vertex array with a single glMultiDrawElementsIndirect call.
+ * This needs OpenGL 4.3, or the ARB_multi_draw_indirect and ARB_base_instance extensions; the
+ * loaded glad only covers 3.3, so the entry point is fetched from SFML's context. Callers check
+ * supported() and keep a per-draw path for contexts without it.
+ *
+ * Each frame's commands are uploaded once with upload(), which orphans the previous frame's
+ * buffer, and then drawn as slices by draw().
+ */
+class MultiDrawIndirect {
+private:
+	bool m_queried;
+	PFNGLMULTIDRAWELEMENTSINDIRECTPROC m_multiDrawElementsIndirect;
+	GLBuffer m_buffer;
+	size_t m_capacity;
+	// Lets the per-draw path be forced for comparison even where indirect drawing works.
+	bool m_enabled;
+
+public:
+	MultiDrawIndirect();
+
+	MultiDrawIndirect(const MultiDrawIndirect&) = delete;
+	MultiDrawIndirect& operator=(const MultiDrawIndirect&) = delete;
+
+	/**
+	 * @brief The indirect drawing state of the process's OpenGL context.
+	 */
+	static MultiDrawIndirect& global();
+
+	/**
+	 * @brief True if the context can draw indirectly and indirect drawing is enabled. The first
+	 * call queries the context, which must be current.
+	 */
+	bool supported();
+	void setEnabled(bool enabled) { m_enabled = enabled; }
+
+	/**
+	 * @brief Replaces the command buffer's contents with the given commands.
+	 */
+	void upload(const std::vector<DrawElementsIndirectCommand>& commands);
+
+	/**
+	 * @brief Draws triangles with commandCount uploaded commands, starting at firstCommand, from the
+	 * currently bound vertex array.
+	 */
+	void draw(uint32_t indexType, size_t firstCommand, size_t commandCount);
+
+	/**
+	 * @brief Deletes the command buffer. Must be called while the OpenGL context still exists.
+	 */
+	void clear();
+};
@@ -1,18 +1,11 @@
 #include <glm/gtx/string_cast.hpp>
 #include <glm/ext.hpp>
 #include "Object3D.h"
+#include "UniformBlocks.h"
 #include <iostream>
 
-void Object3D::rebuildModelMatrix() {
-	auto m = glm::translate(glm::mat4(1), m_position);
-	m = glm::translate(m, m_center * m_scale);
-	m = glm::rotate(m, m_orientation[2], glm::vec3(0, 0, 1));
-	m = glm::rotate(m, m_orientation[0], glm::vec3(1, 0, 0));
-	m = glm::rotate(m, m_orientation[1], glm::vec3(0, 1, 0));
-	m = glm::scale(m, m_scale);
-	m = glm::translate(m, -m_center);
-	m = m * m_baseTransform;
-	m_modelMatrix = m;
+void Object3D::invalidateTransform() {
+	TransformSystem::global().markDirty(m_transform);
 }
 
 ///// Simulation
@@ -31,14 +24,18 @@ void Object3D::tick(float_t dt) {
 	m_velocity += acceleration * dt; // new one 
 
 	// velocity modify position 
-	m_position += m_velocity * dt;
+	local().position += m_velocity * dt;
 
-	// rotational velocity added to objects orientation w/ acceleration after each tick ?
+	// rotational velocity turns the object about its own axes, on top of its current rotation
 	m_rotationalVelocity += m_rotationalAcceleration * dt;
-	m_orientation += m_rotationalVelocity * dt;
+	glm::vec3 turn = m_rotationalVelocity * dt;
+	if (turn != glm::vec3(0)) {
+		local().rotation = glm::normalize(local().rotation * TransformSystem::eulerToQuat(turn));
+		local().orientation = TransformSystem::quatToEuler(local().rotation);
+	}
 
 
-	rebuildModelMatrix();
+	invalidateTransform();
 
 	// clear forces at the end of tick
 	m_forces.clear();
@@ -57,33 +54,109 @@ void Object3D::addTexture(Texture texture) {
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes)
 	: Object3D(std::move(meshes), glm::mat4(1)) {
-	rebuildModelMatrix();
 }
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes, const glm::mat4& baseTransform)
-	: m_meshes(meshes), m_position(), m_orientation(), m_scale(1.0),
-	m_center(), m_baseTransform(baseTransform)
+	: m_transform(TransformSystem::global().create(baseTransform)), m_meshes(std::move(meshes)), m_lodLevel(0)
 {
-	rebuildModelMatrix();
+}
+
+Object3D::Object3D(const Object3D& other)
+	: m_transform(TransformSystem::global().clone(other.m_transform)), m_meshes(other.m_meshes),
+	m_children(other.m_children), m_subtreeBounds(other.m_subtreeBounds), m_occluder(other.m_occluder),
+	m_lodLevel(other.m_lodLevel),
+	m_name(other.m_name), m_velocity(other.m_velocity), m_rotationalVelocity(other.m_rotationalVelocity),
+	m_rotationalAcceleration(other.m_rotationalAcceleration), m_mass(other.m_mass), m_forces(other.m_forces)
+{
+	// The children's copies start out as roots.
+	for (auto& child : m_children) {
+		TransformSystem::global().setParent(child.m_transform, m_transform);
+	}
+}
+
+Object3D::Object3D(Object3D&& other) noexcept
+	: m_transform(other.m_transform), m_meshes(std::move(other.m_meshes)),
+	m_children(std::move(other.m_children)), m_subtreeBounds(other.m_subtreeBounds),
+	m_occluder(std::move(other.m_occluder)), m_lodLevel(other.m_lodLevel),
+	m_name(std::move(other.m_name)), m_velocity(other.m_velocity), m_rotationalVelocity(other.m_rotationalVelocity),
+	m_rotationalAcceleration(other.m_rotationalAcceleration), m_mass(other.m_mass), m_forces(std::move(other.m_forces))
+{
+	// The children keep their nodes, whose parent is the node this object now owns.
+	other.m_transform = TransformSystem::NULL_HANDLE;
+}
+
+Object3D& Object3D::operator=(const Object3D& other) {
+	if (this != &other) {
+		*this = Object3D(other);
+	}
+	return *this;
+}
+
+Object3D& Object3D::operator=(Object3D&& other) noexcept {
+	if (this == &other) {
+		return *this;
+	}
+	auto& system = TransformSystem::global();
+	auto parent = TransformSystem::NULL_HANDLE;
+	if (m_transform != TransformSystem::NULL_HANDLE) {
+		parent = system.parent(m_transform);
+		system.release(m_transform);
+	}
+	m_transform = other.m_transform;
+	other.m_transform = TransformSystem::NULL_HANDLE;
+	if (m_transform != TransformSystem::NULL_HANDLE) {
+		system.setParent(m_transform, parent);
+	}
+
+	m_meshes = std::move(other.m_meshes);
+	m_children = std::move(other.m_children);
+	m_subtreeBounds = other.m_subtreeBounds;
+	m_occluder = std::move(other.m_occluder);
+	m_lodLevel = other.m_lodLevel;
+	m_name = std::move(other.m_name);
+	m_velocity = other.m_velocity;
+	m_rotationalVelocity = other.m_rotationalVelocity;
+	m_rotationalAcceleration = other.m_rotationalAcceleration;
+	m_mass = other.m_mass;
+	m_forces = std::move(other.m_forces);
+	return *this;
+}
+
+Object3D::~Object3D() {
+	if (m_transform != TransformSystem::NULL_HANDLE) {
+		TransformSystem::global().release(m_transform);
+	}
+}
+
+TransformSystem::LocalTransform& Object3D::local() {
+	return TransformSystem::global().local(m_transform);
+}
+
+const TransformSystem::LocalTransform& Object3D::local() const {
+	return static_cast<const TransformSystem&>(TransformSystem::global()).local(m_transform);
 }
 
 const glm::vec3& Object3D::getPosition() const {
-	return m_position;
+	return local().position;
 }
 
 const glm::vec3& Object3D::getOrientation() const {
-	return m_orientation;
+	return local().orientation;
+}
+
+const glm::quat& Object3D::getRotation() const {
+	return local().rotation;
 }
 
 const glm::vec3& Object3D::getScale() const {
-	return m_scale;
+	return local().scale;
 }
 
 /**
  * @brief Gets the center of the object's rotation.
  */
 const glm::vec3& Object3D::getCenter() const {
-	return m_center;
+	return local().center;
 }
 
 const std::string& Object3D::getName() const {
@@ -108,6 +181,45 @@ const float Object3D::getMass() const {
 }
 
 
+const glm::mat4& Object3D::getModelMatrix() const {
+	return TransformSystem::global().localMatrix(m_transform);
+}
+
+const glm::mat4& Object3D::getWorldMatrix() const {
+	return TransformSystem::global().worldMatrix(m_transform);
+}
+
+const std::vector<Mesh3D>& Object3D::getMeshes() const {
+	return m_meshes;
+}
+
+const BoundingBox& Object3D::getLocalBounds() const {
+	auto& system = TransformSystem::global();
+	if (system.boundsDirty(m_transform)) {
+		m_subtreeBounds = BoundingBox();
+		for (auto& mesh : m_meshes) {
+			m_subtreeBounds.expand(mesh.bounds());
+		}
+		for (auto& child : m_children) {
+			m_subtreeBounds.expand(child.getWorldBounds(glm::mat4(1)));
+		}
+		system.clearBoundsDirty(m_transform);
+	}
+	return m_subtreeBounds;
+}
+
+BoundingBox Object3D::getWorldBounds(const glm::mat4& parentMatrix) const {
+	return getLocalBounds().transformed(parentMatrix * getModelMatrix());
+}
+
+const std::vector<glm::vec3>& Object3D::getOccluder() const {
+	return m_occluder;
+}
+
+uint32_t Object3D::getLodLevel() const {
+	return m_lodLevel;
+}
+
 size_t Object3D::numberOfChildren() const {
 	return m_children.size();
 }
@@ -121,34 +233,38 @@ Object3D& Object3D::getChild(size_t index) {
 }
 
 void Object3D::setPosition(const glm::vec3& position) {
-	m_position = position;
-	rebuildModelMatrix();
+	local().position = position;
+	invalidateTransform();
 }
 
 void Object3D::setOrientation(const glm::vec3& orientation) {
-	m_orientation = orientation;
-	rebuildModelMatrix();
+	local().orientation = orientation;
+	local().rotation = TransformSystem::eulerToQuat(orientation);
+	invalidateTransform();
+}
+
+void Object3D::setRotation(const glm::quat& rotation) {
+	local().rotation = glm::normalize(rotation);
+	local().orientation = TransformSystem::quatToEuler(local().rotation);
+	invalidateTransform();
 }
 
 void Object3D::setScale(const glm::vec3& scale) {
-	m_scale = scale;
-	rebuildModelMatrix();
+	local().scale = scale;
+	invalidateTransform();
 }
 
 void Object3D::setVelocity(const glm::vec3& velocity) {
 	m_velocity = velocity;
-	rebuildModelMatrix();
 }
  
 
 void Object3D::setRotationalAcceleration(const glm::vec3& rotacceleration) {
 	m_rotationalAcceleration = rotacceleration;
-	rebuildModelMatrix();
 }
 
 void Object3D::setRotationalVelocity(const glm::vec3& rotvelocity) {
 	m_rotationalVelocity = rotvelocity;
-	rebuildModelMatrix();
 }
 
 void Object3D::setMass(const float mass) {
@@ -162,31 +278,44 @@ void Object3D::setMass(const float mass) {
  */
 void Object3D::setCenter(const glm::vec3& center)
 {
-	m_center = center;
+	local().center = center;
+	invalidateTransform();
 }
 
 void Object3D::setName(const std::string& name) {
 	m_name = name;
 }
 
+void Object3D::setOccluder(std::vector<glm::vec3>&& triangles) {
+	m_occluder = std::move(triangles);
+}
+
+void Object3D::setLodLevel(uint32_t level) const {
+	m_lodLevel = level;
+}
+
 void Object3D::move(const glm::vec3& offset) {
-	m_position = m_position + offset;
-	rebuildModelMatrix();
+	local().position = local().position + offset;
+	invalidateTransform();
 }
 
 void Object3D::rotate(const glm::vec3& rotation) {
-	m_orientation = m_orientation + rotation;
-	rebuildModelMatrix();
+	rotate(TransformSystem::eulerToQuat(rotation));
+}
+
+void Object3D::rotate(const glm::quat& rotation) {
+	setRotation(local().rotation * rotation);
 }
 
 void Object3D::grow(const glm::vec3& growth) {
-	m_scale = m_scale * growth;
-	rebuildModelMatrix();
+	local().scale = local().scale * growth;
+	invalidateTransform();
 }
 
 void Object3D::addChild(Object3D&& child)
 {
-	m_children.emplace_back(child);
+	m_children.emplace_back(std::move(child));
+	TransformSystem::global().setParent(m_children.back().m_transform, m_transform);
 }
 
 void Object3D::render(sf::RenderWindow& window, ShaderProgram& shaderProgram) const {
@@ -199,9 +328,11 @@ void Object3D::render(sf::RenderWindow& window, ShaderProgram& shaderProgram) co
  */
 void Object3D::renderRecursive(sf::RenderWindow& window, ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const {
 	// This object's true model matrix is the combination of its parent's matrix and the object's matrix.
-	glm::mat4 trueModel = parentMatrix * m_modelMatrix;
-	shaderProgram.setUniform("model", trueModel);
-	// Render each mesh in the object.
+	glm::mat4 trueModel = parentMatrix * getModelMatrix();
+	// Render each mesh in the object, with the object's transforms in the ObjectBlock.
+	if (!m_meshes.empty()) {
+		UniformBlocks::global().bindObject(trueModel);
+	}
 	for (auto& mesh : m_meshes) {
 		mesh.render(window, shaderProgram);
 	}
@@ -3,6 +3,7 @@
 #include <vector>
 #include "Mesh3D.h"
 #include "ShaderProgram.h"
+#include "TransformSystem.h"
 /**
  * @brief Represents an object placed in a 3D scene. The object is a node in an hierarchy of
  * objects representing a single 3D model. Each object in the hierarchy has its own position,
@@ -13,19 +14,28 @@ private:
 	// The object's mesh.
 	//std::shared_ptr<Mesh3D> m_mesh;
 
+	// The object's node in the TransformSystem, which holds its position, orientation, scale,
+	// and local and world matrices. Null only for an object that was moved from. Declared first, so
+	// that a copied object's node is created before its children's.
+	TransformSystem::Handle m_transform;
+
 	// The object's list of meshes and children.
 	std::vector<Mesh3D> m_meshes;
 	std::vector<Object3D> m_children;
 
-	// The object's position, orientation, and scale in world space.
-	glm::vec3 m_position;
-	glm::vec3 m_orientation;
-	glm::vec3 m_scale;
-	glm::vec3 m_center;
+	// Bounds of the object's meshes and all of its descendants, in the object's model space, so
+	// that a whole subtree can be culled with one test. Recomputed on demand once the
+	// TransformSystem reports that a descendant was added or moved.
+	mutable BoundingBox m_subtreeBounds;
+
+	// Simplified stand-in geometry for occlusion culling, as a triangle list in the object's model
+	// space; empty if the object hides nothing. See OcclusionCuller.
+	std::vector<glm::vec3> m_occluder;
 
-	// The object's cached local->world transformation matrix.
-	glm::mat4 m_modelMatrix;
-	glm::mat4 m_baseTransform;
+	// The level of detail the object's meshes were last drawn at, which the renderer keeps until
+	// the object's screen size moves clearly past a threshold, so it does not flicker between two
+	// levels. Updated while rendering through a const reference, like m_subtreeBounds.
+	mutable uint32_t m_lodLevel;
 
 	// Some objects from Assimp imports have a "name" field, useful for debugging.
 	std::string m_name;
@@ -43,8 +53,12 @@ private:
 	// forces 
 	std::vector<glm::vec3> m_forces;
 
-	// Recomputes the local->world transformation matrix.
-	void rebuildModelMatrix();
+	// Marks the object's matrices for rebuilding after its position, orientation, scale or center
+	// changed. They are rebuilt once, when next needed, however many changes come first.
+	void invalidateTransform();
+	// The object's position, orientation, scale and center, stored in the TransformSystem.
+	TransformSystem::LocalTransform& local();
+	const TransformSystem::LocalTransform& local() const;
 
 public:
 	// No default constructor; you must have a mesh to initialize an object.
@@ -53,6 +67,14 @@ public:
 	Object3D(std::vector<Mesh3D>&& meshes);
 	Object3D(std::vector<Mesh3D>&& meshes, const glm::mat4& baseTransform);
 
+	// A copy gets its own transform nodes, for itself and each of its descendants.
+	Object3D(const Object3D& other);
+	Object3D(Object3D&& other) noexcept;
+	// Assignment keeps the object's place in its parent's hierarchy.
+	Object3D& operator=(const Object3D& other);
+	Object3D& operator=(Object3D&& other) noexcept;
+	~Object3D();
+
 	// TextureBasics
 	void addTexture(Texture texture);  
 	
@@ -62,6 +84,7 @@ public:
 	// Simple accessors.
 	const glm::vec3& getPosition() const;
 	const glm::vec3& getOrientation() const;
+	const glm::quat& getRotation() const;
 	const glm::vec3& getScale() const;
 	const glm::vec3& getCenter() const;
 	const std::string& getName() const;
@@ -69,18 +92,50 @@ public:
 	const glm::vec3& getRotationalAcceleration() const;
 	const glm::vec3& getRotationalVelocity() const;
 	const float getMass() const;
+	const glm::mat4& getModelMatrix() const;
+	/**
+	 * @brief The object's local->world matrix, combining its ancestors' model matrices, as of the
+	 * last TransformSystem::update().
+	 */
+	const glm::mat4& getWorldMatrix() const;
+	const std::vector<Mesh3D>& getMeshes() const;
+	/**
+	 * @brief The bounds of the object's meshes and descendants, before the object's own model
+	 * matrix is applied.
+	 */
+	const BoundingBox& getLocalBounds() const;
+	/**
+	 * @brief The bounds of the object and its descendants in the space of the given parent matrix,
+	 * e.g. world space for the identity.
+	 */
+	BoundingBox getWorldBounds(const glm::mat4& parentMatrix) const;
+	const std::vector<glm::vec3>& getOccluder() const;
+	uint32_t getLodLevel() const;
 
 	// Child management.
 	size_t numberOfChildren() const;
 	const Object3D& getChild(size_t index) const;
+	// Moving the child through this reference still invalidates the object's bounds, since the
+	// TransformSystem marks every ancestor of a moved node.
 	Object3D& getChild(size_t index);
 
 	// Simple mutators.
 	void setPosition(const glm::vec3& position);
 	void setOrientation(const glm::vec3& orientation);
+	/**
+	 * @brief Sets the orientation as a quaternion; getOrientation() then returns equivalent Euler
+	 * angles.
+	 */
+	void setRotation(const glm::quat& rotation);
 	void setScale(const glm::vec3& scale);
 	void setCenter(const glm::vec3& center);
 	void setName(const std::string& name);
+	/**
+	 * @brief Marks the object as an occluder, standing in for it with the given triangles, which
+	 * must lie inside its meshes and wind counterclockwise seen from outside.
+	 */
+	void setOccluder(std::vector<glm::vec3>&& triangles);
+	void setLodLevel(uint32_t level) const;
 	void setVelocity(const glm::vec3& velocity); 
 	void setRotationalAcceleration(const glm::vec3& rotacceleration);
 	void setRotationalVelocity(const glm::vec3& rotvelocity);
@@ -88,7 +143,10 @@ public:
 
 	// Transformations.
 	void move(const glm::vec3& offset);
+	// Applies a further rotation by the given Euler angles, about the object's own axes.
 	void rotate(const glm::vec3& rotation);
+	// Applies a further rotation about the object's own axes, free of gimbal lock.
+	void rotate(const glm::quat& rotation);
 	void grow(const glm::vec3& growth);
 	void addChild(Object3D&& child);
 
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include "Object3D.h"
+#include "SlotMap.h"
+
+/**
+ * @brief Owns a scene's top-level objects. Animations and game code refer to objects by handle,
+ * so objects can be spawned and despawned at runtime, and the store moved, without leaving them
+ * holding dangling references.
+ */
+using ObjectStore = SlotMap<Object3D>;
+using ObjectHandle = ObjectStore::Handle;
+
+/**
+ * @brief Names an object in an ObjectStore, or a descendant of one by the indices of the
+ * children leading down to it.
+ */
+class ObjectRef {
+private:
+	ObjectHandle m_handle;
+	std::vector<size_t> m_childPath;
+
+public:
+	ObjectRef(ObjectHandle handle) : m_handle(handle) {}
+
+	/**
+	 * @brief The given child of the object this names.
+	 */
+	ObjectRef child(size_t index) const {
+		ObjectRef ref(*this);
+		ref.m_childPath.push_back(index);
+		return ref;
+	}
+
+	/**
+	 * @brief The handle of the top-level object this is, or is a descendant of.
+	 */
+	ObjectHandle handle() const { return m_handle; }
+
+	/**
+	 * @brief The object, or nullptr if it, or the object it descends from, was erased.
+	 */
+	Object3D* resolve(ObjectStore& objects) const {
+		Object3D* object = objects.get(m_handle);
+		for (size_t index : m_childPath) {
+			if (object == nullptr || index >= object->numberOfChildren()) {
+				return nullptr;
+			}
+			object = &object->getChild(index);
+		}
+		return object;
+	}
+};
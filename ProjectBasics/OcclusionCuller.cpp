@@ -0,0 +1,279 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	float_t millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<float_t, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Twice the signed area of the 2D triangle; positive when it winds counterclockwise.
+	 */
+	float_t doubleArea(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	/**
+	 * @brief The coefficients (A, B, C) of the edge function A*x + B*y + C from p to q, which is
+	 * positive on the left of the edge.
+	 */
+	glm::vec3 edgeFunction(const glm::vec3& p, const glm::vec3& q) {
+		float_t dx = q.x - p.x;
+		float_t dy = q.y - p.y;
+		return glm::vec3(-dy, dx, dy * p.x - dx * p.y);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+	: m_width((width + 3) & ~3u), m_height(height), m_depth(static_cast<size_t>(m_width) * height, 1.0f),
+	m_viewProjection(1), m_maxOccluders(8), m_minOccluderArea(64), m_stats() {}
+
+void OcclusionCuller::setOccluderLimits(size_t maxOccluders, float_t minScreenArea) {
+	m_maxOccluders = maxOccluders;
+	m_minOccluderArea = minScreenArea;
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection) {
+	m_viewProjection = viewProjection;
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	m_clipVertices.clear();
+	m_candidates.clear();
+	m_stats = Stats();
+}
+
+glm::vec3 OcclusionCuller::toWindow(const glm::vec4& clip) const {
+	glm::vec3 ndc = glm::vec3(clip) / clip.w;
+	return glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+}
+
+void OcclusionCuller::addOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& model) {
+	++m_stats.occluderCandidates;
+	glm::mat4 modelViewProjection = m_viewProjection * model;
+	Candidate candidate{ m_clipVertices.size(), triangles.size() / 3 * 3, 0 };
+	for (size_t i = 0; i < candidate.vertexCount; i++) {
+		m_clipVertices.push_back(modelViewProjection * glm::vec4(triangles[i], 1));
+	}
+	// Estimate the occluder's size from its triangles wholly in front of the camera.
+	auto first = m_clipVertices.begin() + candidate.firstVertex;
+	for (size_t i = 0; i < candidate.vertexCount; i += 3) {
+		auto& a = first[i];
+		auto& b = first[i + 1];
+		auto& c = first[i + 2];
+		if (a.w > 0 && b.w > 0 && c.w > 0) {
+			candidate.screenArea += std::max<float_t>(doubleArea(toWindow(a), toWindow(b), toWindow(c)), 0) * 0.5f;
+		}
+	}
+	m_candidates.push_back(candidate);
+}
+
+void OcclusionCuller::rasterizeOccluders() {
+	auto start = Clock::now();
+	std::sort(m_candidates.begin(), m_candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.screenArea > b.screenArea; });
+	for (auto& candidate : m_candidates) {
+		if (m_stats.occludersRasterized == m_maxOccluders || candidate.screenArea < m_minOccluderArea) {
+			break;
+		}
+		++m_stats.occludersRasterized;
+		auto first = m_clipVertices.begin() + candidate.firstVertex;
+		for (size_t i = 0; i < candidate.vertexCount; i += 3) {
+			rasterizeClipped(first[i], first[i + 1], first[i + 2]);
+		}
+	}
+	m_stats.rasterizeMilliseconds += millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeClipped(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+	// Clip against the near plane z = -w (Sutherland-Hodgman with one plane), which also removes
+	// everything behind the camera. A triangle leaves at most a quad.
+	std::array<glm::vec4, 3> input = { a, b, c };
+	std::array<glm::vec4, 4> output;
+	size_t count = 0;
+	for (size_t i = 0; i < 3; i++) {
+		auto& current = input[i];
+		auto& next = input[(i + 1) % 3];
+		float_t currentDistance = current.z + current.w;
+		float_t nextDistance = next.z + next.w;
+		if (currentDistance >= 0) {
+			output[count++] = current;
+		}
+		if ((currentDistance >= 0) != (nextDistance >= 0)) {
+			float_t t = currentDistance / (currentDistance - nextDistance);
+			output[count++] = current + (next - current) * t;
+		}
+	}
+	if (count < 3) {
+		return;
+	}
+	glm::vec3 first = toWindow(output[0]);
+	glm::vec3 previous = toWindow(output[1]);
+	for (size_t i = 2; i < count; i++) {
+		glm::vec3 current = toWindow(output[i]);
+		rasterize(first, previous, current);
+		previous = current;
+	}
+}
+
+void OcclusionCuller::rasterize(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	float_t area = doubleArea(a, b, c);
+	// Back facing or degenerate.
+	if (area <= 0) {
+		return;
+	}
+
+	// The pixels whose centers may be inside the triangle. Rows and groups of four pixels are
+	// walked from aligned starts, so the SIMD loads never straddle a row.
+	int32_t minX = std::max(0, static_cast<int32_t>(std::floor(std::min({ a.x, b.x, c.x }))));
+	int32_t maxX = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::ceil(std::max({ a.x, b.x, c.x }))));
+	int32_t minY = std::max(0, static_cast<int32_t>(std::floor(std::min({ a.y, b.y, c.y }))));
+	int32_t maxY = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::ceil(std::max({ a.y, b.y, c.y }))));
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+	minX &= ~3;
+	++m_stats.trianglesRasterized;
+
+	// Each edge function is the barycentric weight of the opposite vertex, times the area.
+	glm::vec3 edgeA = edgeFunction(b, c);
+	glm::vec3 edgeB = edgeFunction(c, a);
+	glm::vec3 edgeC = edgeFunction(a, b);
+	float_t inverseArea = 1.0f / area;
+
+#ifdef OCCLUSION_CULLER_SSE2
+	const __m128 pixelCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 aX = _mm_set1_ps(edgeA.x), bX = _mm_set1_ps(edgeB.x), cX = _mm_set1_ps(edgeC.x);
+	const __m128 depthA = _mm_set1_ps(a.z * inverseArea);
+	const __m128 depthB = _mm_set1_ps(b.z * inverseArea);
+	const __m128 depthC = _mm_set1_ps(c.z * inverseArea);
+	for (int32_t y = minY; y <= maxY; y++) {
+		float_t centerY = y + 0.5f;
+		__m128 rowA = _mm_set1_ps(edgeA.y * centerY + edgeA.z);
+		__m128 rowB = _mm_set1_ps(edgeB.y * centerY + edgeB.z);
+		__m128 rowC = _mm_set1_ps(edgeC.y * centerY + edgeC.z);
+		float_t* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		for (int32_t x = minX; x <= maxX; x += 4) {
+			__m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float_t>(x)), pixelCenters);
+			__m128 weightA = _mm_add_ps(_mm_mul_ps(aX, centerX), rowA);
+			__m128 weightB = _mm_add_ps(_mm_mul_ps(bX, centerX), rowB);
+			__m128 weightC = _mm_add_ps(_mm_mul_ps(cX, centerX), rowC);
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(weightA, zero), _mm_cmpge_ps(weightB, zero)),
+				_mm_cmpge_ps(weightC, zero));
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+			__m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weightA, depthA), _mm_mul_ps(weightB, depthB)),
+				_mm_mul_ps(weightC, depthC));
+			__m128 old = _mm_loadu_ps(row + x);
+			__m128 nearer = _mm_min_ps(old, depth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+	}
+#else
+	for (int32_t y = minY; y <= maxY; y++) {
+		float_t centerY = y + 0.5f;
+		float_t* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		for (int32_t x = minX; x <= maxX; x++) {
+			float_t centerX = x + 0.5f;
+			float_t weightA = edgeA.x * centerX + edgeA.y * centerY + edgeA.z;
+			float_t weightB = edgeB.x * centerX + edgeB.y * centerY + edgeB.z;
+			float_t weightC = edgeC.x * centerX + edgeC.y * centerY + edgeC.z;
+			if (weightA >= 0 && weightB >= 0 && weightC >= 0) {
+				float_t depth = (weightA * a.z + weightB * b.z + weightC * c.z) * inverseArea;
+				row[x] = std::min(row[x], depth);
+			}
+		}
+	}
+#endif
+}
+
+bool OcclusionCuller::isOccluded(const BoundingBox& worldBounds) {
+	if (worldBounds.isEmpty()) {
+		return false;
+	}
+	auto start = Clock::now();
+	++m_stats.objectsTested;
+
+	// The screen rectangle and nearest depth of the box's corners.
+	glm::vec3 windowMin(std::numeric_limits<float_t>::max());
+	glm::vec3 windowMax(std::numeric_limits<float_t>::lowest());
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 position((corner & 1) ? worldBounds.max.x : worldBounds.min.x,
+			(corner & 2) ? worldBounds.max.y : worldBounds.min.y,
+			(corner & 4) ? worldBounds.max.z : worldBounds.min.z);
+		glm::vec4 clip = m_viewProjection * glm::vec4(position, 1);
+		if (clip.z + clip.w <= 0) {
+			m_stats.testMilliseconds += millisecondsSince(start);
+			return false;
+		}
+		glm::vec3 window = toWindow(clip);
+		windowMin = glm::min(windowMin, window);
+		windowMax = glm::max(windowMax, window);
+	}
+	int32_t minX = std::max(0, static_cast<int32_t>(std::floor(windowMin.x)) - 1);
+	int32_t maxX = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::floor(windowMax.x)) + 1);
+	int32_t minY = std::max(0, static_cast<int32_t>(std::floor(windowMin.y)) - 1);
+	int32_t maxY = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::floor(windowMax.y)) + 1);
+	float_t nearest = windowMin.z;
+
+	// The box is hidden if every pixel of the rectangle has an occluder nearer than the box.
+	bool occluded = minX <= maxX && minY <= maxY;
+	for (int32_t y = minY; occluded && y <= maxY; y++) {
+		const float_t* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		int32_t x = minX;
+#ifdef OCCLUSION_CULLER_SSE2
+		const __m128 boxDepth = _mm_set1_ps(nearest);
+		for (; x + 3 <= maxX; x += 4) {
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0) {
+				occluded = false;
+				break;
+			}
+		}
+#endif
+		for (; occluded && x <= maxX; x++) {
+			if (row[x] >= nearest) {
+				occluded = false;
+			}
+		}
+	}
+
+	if (occluded) {
+		++m_stats.objectsOccluded;
+	}
+	m_stats.testMilliseconds += millisecondsSince(start);
+	return occluded;
+}
+
+std::vector<glm::vec3> OcclusionCuller::boxTriangles(const BoundingBox& box) {
+	auto corner = [&box](int index) {
+		return glm::vec3((index & 1) ? box.max.x : box.min.x, (index & 2) ? box.max.y : box.min.y,
+			(index & 4) ? box.max.z : box.min.z);
+	};
+	// Each face as a quad of corner indices, counterclockwise seen from outside.
+	const int faces[6][4] = {
+		{ 0, 4, 6, 2 }, // -x
+		{ 1, 3, 7, 5 }, // +x
+		{ 0, 1, 5, 4 }, // -y
+		{ 2, 6, 7, 3 }, // +y
+		{ 0, 2, 3, 1 }, // -z
+		{ 4, 5, 7, 6 }, // +z
+	};
+	std::vector<glm::vec3> triangles;
+	triangles.reserve(36);
+	for (auto& face : faces) {
+		triangles.insert(triangles.end(), { corner(face[0]), corner(face[1]), corner(face[2]) });
+		triangles.insert(triangles.end(), { corner(face[0]), corner(face[2]), corner(face[3]) });
+	}
+	return triangles;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+/**
+ * @brief Software occlusion culling: rasterizes a few large, simplified occluders into a small
+ * depth buffer on the CPU, then rejects objects whose screen-space bounds lie entirely behind
+ * that depth, before they cost any vertex or fragment shading.
+ *
+ * Each frame: begin() with the view-projection matrix, addOccluder() for each candidate occluder
+ * in view, rasterizeOccluders(), and then isOccluded() for each object about to be drawn. Of the
+ * candidates, only the largest on screen are rasterized, since a small occluder costs about as
+ * much to rasterize as it saves.
+ *
+ * Occluder triangles must lie inside the real geometry they stand for, and wind counterclockwise
+ * seen from outside; back faces are skipped, so a camera inside a closed occluder is not blinded
+ * by it. Rasterization and tests run four pixels at a time with SSE2 where available.
+ */
+class OcclusionCuller {
+public:
+	struct Stats {
+		// Occluders offered by addOccluder(), and those large enough on screen to be rasterized.
+		size_t occluderCandidates;
+		size_t occludersRasterized;
+		// Front-facing triangles rasterized, after clipping to the near plane.
+		size_t trianglesRasterized;
+		// Calls to isOccluded(), and how many of them rejected the object.
+		size_t objectsTested;
+		size_t objectsOccluded;
+		// Time spent in rasterizeOccluders() and in isOccluded() since begin().
+		float_t rasterizeMilliseconds;
+		float_t testMilliseconds;
+	};
+
+private:
+	struct Candidate {
+		// The occluder's vertices in m_clipVertices, three per triangle.
+		size_t firstVertex;
+		size_t vertexCount;
+		// Screen area of its front faces, in depth buffer pixels; overlapping faces count twice.
+		float_t screenArea;
+	};
+
+	uint32_t m_width;
+	uint32_t m_height;
+	// Window-space depth in [0, 1], row by row from the bottom of the screen.
+	std::vector<float_t> m_depth;
+	glm::mat4 m_viewProjection;
+	std::vector<glm::vec4> m_clipVertices;
+	std::vector<Candidate> m_candidates;
+	size_t m_maxOccluders;
+	float_t m_minOccluderArea;
+	Stats m_stats;
+
+	/**
+	 * @brief Rasterizes one triangle, given in clip space, into the depth buffer, after clipping it
+	 * to the near plane.
+	 */
+	void rasterizeClipped(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	/**
+	 * @brief Rasterizes one triangle in window coordinates: x and y in depth buffer pixels, z
+	 * the depth.
+	 */
+	void rasterize(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	glm::vec3 toWindow(const glm::vec4& clip) const;
+
+public:
+	/**
+	 * @brief Creates a culler with a width x height depth buffer; the width is rounded up to a
+	 * multiple of four. The buffer need not match the window's resolution, only its aspect ratio.
+	 */
+	OcclusionCuller(uint32_t width = 256, uint32_t height = 160);
+
+	/**
+	 * @brief Rasterizes at most this many occluders per frame, the largest ones on screen, and none
+	 * covering fewer than minScreenArea pixels of the depth buffer.
+	 */
+	void setOccluderLimits(size_t maxOccluders, float_t minScreenArea);
+
+	/**
+	 * @brief Clears the depth buffer and the occluder candidates, and starts a frame seen through
+	 * the given projection * view matrix.
+	 */
+	void begin(const glm::mat4& viewProjection);
+
+	/**
+	 * @brief Offers an occluder: a triangle list in the space of the given model matrix.
+	 */
+	void addOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& model);
+
+	/**
+	 * @brief Rasterizes the largest of the offered occluders into the depth buffer.
+	 */
+	void rasterizeOccluders();
+
+	/**
+	 * @brief True if the world-space box is entirely hidden behind the rasterized occluders. The
+	 * test is conservative: it uses the nearest depth of the box over the whole screen rectangle
+	 * around it, widened by a pixel, and never rejects a box that crosses the near plane.
+	 */
+	bool isOccluded(const BoundingBox& worldBounds);
+
+	/**
+	 * @brief The twelve triangles of the box's faces, wound counterclockwise seen from outside, for
+	 * use as an occluder.
+	 */
+	static std::vector<glm::vec3> boxTriangles(const BoundingBox& box);
+
+	/**
+	 * @brief Counters for the frame since begin().
+	 */
+	Stats stats() const { return m_stats; }
+};
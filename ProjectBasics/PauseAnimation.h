@@ -15,14 +15,13 @@ private:
 	/**
 	 * @brief Advance the animation by the given time interval. -> do nothing
 	 */
-	void applyAnimation(float_t dt) override {
-		object();
+	void applyAnimation(Object3D& object, float_t dt) override {
 	}
 
 public:
 	/**
 	 * @brief Constructs a animation of a constant translation
 	 */
-	PauseAnimation(Object3D& object, float_t duration) :
-		Animation(object, duration) {}
+	PauseAnimation(ObjectRef object, float_t duration) :
+		Animation(std::move(object), duration) {}
 };
@@ -0,0 +1,291 @@
+#include "RenderQueue.h"
+#include "BatchMath.h"
+#include "GLStateCache.h"
+#include "MultiDrawIndirect.h"
+#include "UniformBlocks.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	const uint64_t PROGRAM_BITS = 7;
+	const uint64_t TEXTURE_BITS = 16;
+	const uint64_t GEOMETRY_BITS = 16;
+	// The geometry field is the vertex array's id followed by the range's id within it, so that
+	// meshes sharing a vertex array sort next to each other and can share an indirect draw.
+	const uint64_t VERTEX_ARRAY_BITS = 6;
+	const uint64_t RANGE_BITS = GEOMETRY_BITS - VERTEX_ARRAY_BITS;
+	const uint64_t DEPTH_BITS = 24;
+	const uint64_t TRANSLUCENT_BIT = uint64_t(1) << 63;
+
+	uint64_t mask(uint64_t bits) {
+		return (uint64_t(1) << bits) - 1;
+	}
+
+	/**
+	 * @brief Combines a value into an FNV-1a style hash.
+	 */
+	uint64_t hashCombine(uint64_t hash, uint64_t value) {
+		return (hash ^ value) * 1099511628211ull;
+	}
+
+	/**
+	 * @brief The id for a key in a per-frame table, assigning the next one if it is new. Ids wrap
+	 * around past the width of their key field, which only costs sorting quality.
+	 */
+	template <typename K>
+	uint64_t internId(std::unordered_map<K, uint64_t>& ids, const K& key, uint64_t bits) {
+		return ids.emplace(key, ids.size()).first->second & mask(bits);
+	}
+
+	/**
+	 * @brief A non-negative depth quantized so that larger depths give larger values. The bits of
+	 * a non-negative IEEE float already sort like the float; keep the most significant ones.
+	 */
+	uint64_t quantizeDepth(float_t depth) {
+		depth = std::max(depth, 0.0f);
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits >> (32 - DEPTH_BITS);
+	}
+
+	bool sameTextures(const Mesh3D& a, const Mesh3D& b) {
+		auto& ta = a.textures();
+		auto& tb = b.textures();
+		return std::equal(ta.begin(), ta.end(), tb.begin(), tb.end(),
+			[](const Texture& x, const Texture& y) { return x.textureId == y.textureId; });
+	}
+}
+
+RenderQueue::RenderQueue()
+	: m_view(1), m_viewProjection(1), m_frustum(glm::mat4(1)), m_culling(true), m_projectionScale(1),
+	m_lodThresholds{ 0.25f, 0.12f, 0.06f }, m_lodHysteresis(0.15f), m_instanceBuffer(), m_instanceCapacity(0),
+	m_stats() {}
+
+void RenderQueue::begin(const glm::mat4& view, const glm::mat4& projection) {
+	m_view = view;
+	m_viewProjection = projection * view;
+	m_frustum = Frustum(m_viewProjection);
+	m_projectionScale = projection[1][1];
+	m_stats = Stats();
+	m_items.clear();
+	m_transforms.clear();
+	m_programIds.clear();
+	m_textureIds.clear();
+	m_vertexArrayIds.clear();
+	m_rangeIds.clear();
+}
+
+void RenderQueue::setLodThresholds(std::vector<float_t> thresholds, float_t hysteresis) {
+	m_lodThresholds = std::move(thresholds);
+	m_lodHysteresis = hysteresis;
+}
+
+void RenderQueue::submit(const Object3D& object, ShaderProgram& program) {
+	submitRecursive(object, program, !m_culling);
+}
+
+void RenderQueue::submitRecursive(const Object3D& object, ShaderProgram& program, bool insideFrustum) {
+	// Computed for the whole hierarchy at once by TransformSystem::update().
+	const glm::mat4& trueModel = object.getWorldMatrix();
+	if (!insideFrustum) {
+		++m_stats.nodesTested;
+		auto containment = m_frustum.classify(object.getLocalBounds().transformed(trueModel));
+		if (containment == Containment::Outside) {
+			++m_stats.nodesCulled;
+			return;
+		}
+		insideFrustum = containment == Containment::Inside;
+	}
+
+	if (!object.getMeshes().empty()) {
+		uint32_t transformIndex = static_cast<uint32_t>(m_transforms.size());
+		m_transforms.push_back(trueModel);
+		++m_stats.nodesDrawn;
+		// The camera looks down -z in view space.
+		float_t viewDepth = -(m_view * trueModel[3]).z;
+		size_t levels = 1;
+		for (auto& mesh : object.getMeshes()) {
+			levels = std::max(levels, mesh.lodCount());
+		}
+		uint32_t level = levels > 1 ? selectLod(object, trueModel, levels) : 0;
+		for (auto& lodMesh : object.getMeshes()) {
+			auto& mesh = lodMesh.lod(level);
+			// A node straddling the frustum may still have meshes wholly outside it.
+			if (!insideFrustum && object.getMeshes().size() > 1
+				&& !m_frustum.intersects(mesh.boundingSphere().transformed(trueModel))) {
+				++m_stats.meshesCulled;
+				continue;
+			}
+			if (&mesh != &lodMesh) {
+				++m_stats.lodMeshes;
+			}
+			m_items.push_back(DrawItem{ sortKey(mesh, program, viewDepth), &mesh, &program, transformIndex,
+				viewDepth });
+		}
+	}
+	for (size_t i = 0; i < object.numberOfChildren(); i++) {
+		submitRecursive(object.getChild(i), program, insideFrustum);
+	}
+}
+
+uint32_t RenderQueue::selectLod(const Object3D& object, const glm::mat4& trueModel, size_t levels) {
+	auto sphere = BoundingSphere::around(object.getLocalBounds()).transformed(trueModel);
+	float_t depth = -(m_view * glm::vec4(sphere.center, 1)).z;
+	// Up close, and with the camera inside the sphere, the projected size is unbounded.
+	if (depth <= sphere.radius) {
+		object.setLodLevel(0);
+		return 0;
+	}
+	float_t screenSize = sphere.radius * m_projectionScale / depth;
+
+	size_t maxLevel = std::min(levels - 1, m_lodThresholds.size());
+	size_t level = std::min<size_t>(object.getLodLevel(), maxLevel);
+	while (level < maxLevel && screenSize < m_lodThresholds[level] * (1 - m_lodHysteresis)) {
+		level++;
+	}
+	while (level > 0 && screenSize > m_lodThresholds[level - 1] * (1 + m_lodHysteresis)) {
+		level--;
+	}
+	object.setLodLevel(static_cast<uint32_t>(level));
+	return static_cast<uint32_t>(level);
+}
+
+uint64_t RenderQueue::sortKey(const Mesh3D& mesh, ShaderProgram& program, float_t viewDepth) {
+	uint64_t programId = internId(m_programIds, &program, PROGRAM_BITS);
+
+	uint64_t textureHash = 14695981039346656037ull;
+	for (auto& texture : mesh.textures()) {
+		textureHash = hashCombine(textureHash, texture.textureId);
+	}
+	uint64_t textureId = internId(m_textureIds, textureHash, TEXTURE_BITS);
+
+	uint64_t vertexArrayId = internId(m_vertexArrayIds, uint64_t(mesh.vao()), VERTEX_ARRAY_BITS);
+	uint64_t rangeHash = hashCombine(hashCombine(hashCombine(14695981039346656037ull, mesh.vao()),
+		mesh.indexOffset()), static_cast<uint32_t>(mesh.baseVertex()));
+	uint64_t geometryId = (vertexArrayId << RANGE_BITS) | internId(m_rangeIds, rangeHash, RANGE_BITS);
+
+	uint64_t depth = quantizeDepth(viewDepth);
+	uint64_t state = (programId << (TEXTURE_BITS + GEOMETRY_BITS)) | (textureId << GEOMETRY_BITS) | geometryId;
+	if (mesh.isTranslucent()) {
+		return TRANSLUCENT_BIT | ((mask(DEPTH_BITS) - depth) << (PROGRAM_BITS + TEXTURE_BITS + GEOMETRY_BITS)) | state;
+	}
+	return (state << DEPTH_BITS) | depth;
+}
+
+void RenderQueue::flush(sf::RenderWindow& window) {
+	m_stats.items = m_items.size();
+	if (m_items.empty()) {
+		return;
+	}
+
+	std::sort(m_items.begin(), m_items.end(), [](const DrawItem& a, const DrawItem& b) {
+		return a.key != b.key ? a.key < b.key : a.transformIndex < b.transformIndex;
+	});
+
+	// Lay the transforms out in draw order, so each run of identical meshes reads a contiguous
+	// slice of the instance buffer. Objects with several meshes share one computation.
+	auto& batchMath = BatchMath::global();
+	m_modelViewProjections.resize(m_transforms.size());
+	m_normalMatrices.resize(m_transforms.size());
+	batchMath.multiply(m_viewProjection, m_transforms.data(), m_modelViewProjections.data(), m_transforms.size());
+	batchMath.normalMatrices(m_transforms.data(), m_normalMatrices.data(), m_transforms.size());
+	m_objectConstants.clear();
+	for (size_t i = 0; i < m_transforms.size(); i++) {
+		m_objectConstants.push_back(ObjectConstants{ m_transforms[i], m_modelViewProjections[i], m_normalMatrices[i] });
+	}
+	m_instanceData.clear();
+	for (auto& item : m_items) {
+		m_instanceData.push_back(MeshInstance{ m_objectConstants[item.transformIndex],
+			glm::vec4(item.mesh->positionOffset(), 0), glm::vec4(item.mesh->positionScale(), 0) });
+	}
+
+	// Reallocating the whole buffer every frame orphans the storage the previous frame's draws
+	// may still be reading, instead of waiting for them.
+	if (!m_instanceBuffer) {
+		m_instanceBuffer = GLBuffer::generate();
+	}
+	auto& state = GLStateCache::global();
+	state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.id());
+	m_instanceCapacity = std::max(m_instanceCapacity, m_instanceData.size());
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(MeshInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_instanceData.size() * sizeof(MeshInstance), m_instanceData.data());
+
+	// Split the items into runs of identical meshes, each one instanced draw command.
+	m_runs.clear();
+	size_t runStart = 0;
+	while (runStart < m_items.size()) {
+		const DrawItem& first = m_items[runStart];
+		size_t runEnd = runStart + 1;
+		while (runEnd < m_items.size() && m_items[runEnd].program == first.program
+			&& m_items[runEnd].mesh->isTranslucent() == first.mesh->isTranslucent()
+			&& m_items[runEnd].mesh->drawsSameAs(*first.mesh)) {
+			runEnd++;
+		}
+		m_runs.push_back(DrawElementsIndirectCommand{ static_cast<uint32_t>(first.mesh->indexCount()),
+			static_cast<uint32_t>(runEnd - runStart), static_cast<uint32_t>(first.mesh->firstIndex()),
+			first.mesh->baseVertex(), static_cast<uint32_t>(runStart) });
+		m_stats.triangles += first.mesh->indexCount() / 3 * (runEnd - runStart);
+		runStart = runEnd;
+	}
+	m_stats.commands = m_runs.size();
+
+	// With indirect drawing, consecutive runs that bind the same state go into one multi-draw call.
+	auto& indirect = MultiDrawIndirect::global();
+	bool drawIndirect = indirect.supported();
+	if (drawIndirect) {
+		indirect.upload(m_runs);
+	}
+
+	const DrawItem* previous = nullptr;
+	bool blending = false;
+	size_t batchStart = 0;
+	while (batchStart < m_runs.size()) {
+		const DrawItem& first = m_items[m_runs[batchStart].baseInstance];
+		size_t batchEnd = batchStart + 1;
+		while (drawIndirect && batchEnd < m_runs.size()) {
+			const DrawItem& next = m_items[m_runs[batchEnd].baseInstance];
+			if (next.program != first.program || next.mesh->isTranslucent() != first.mesh->isTranslucent()
+				|| !next.mesh->bindsSameAs(*first.mesh)) {
+				break;
+			}
+			batchEnd++;
+		}
+
+		if (first.mesh->isTranslucent() && !blending) {
+			state.setEnabled(GL_BLEND, true);
+			state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state.depthMask(false);
+			blending = true;
+		}
+		if (previous == nullptr || previous->program != first.program) {
+			first.program->activate();
+			++m_stats.programChanges;
+		}
+		if (previous == nullptr || !sameTextures(*previous->mesh, *first.mesh)) {
+			++m_stats.textureChanges;
+		}
+		if (previous == nullptr || previous->mesh->vao() != first.mesh->vao()) {
+			++m_stats.vertexArrayChanges;
+		}
+
+		if (drawIndirect) {
+			first.mesh->renderIndirect(window, *first.program, m_instanceBuffer.id(), indirect, batchStart,
+				batchEnd - batchStart);
+		}
+		else {
+			auto& run = m_runs[batchStart];
+			first.mesh->renderInstanced(window, *first.program, m_instanceBuffer.id(), run.baseInstance, run.instanceCount);
+		}
+		++m_stats.drawCalls;
+		previous = &first;
+		batchStart = batchEnd;
+	}
+
+	if (blending) {
+		state.setEnabled(GL_BLEND, false);
+		state.depthMask(true);
+	}
+	m_items.clear();
+	m_transforms.clear();
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Object3D.h"
+#include "Bounds.h"
+#include "GLObject.h"
+#include "MultiDrawIndirect.h"
+#include "UniformBlocks.h"
+
+/**
+ * @brief One mesh to draw this frame, as emitted by RenderQueue::submit.
+ */
+struct DrawItem {
+	// Sorting by this key orders the items for submission; see RenderQueue.
+	uint64_t key;
+	const Mesh3D* mesh;
+	ShaderProgram* program;
+	// Index of the item's world transform in the queue's transform list.
+	uint32_t transformIndex;
+	// Distance from the camera along the view direction.
+	float_t viewDepth;
+};
+
+/**
+ * @brief Collects the meshes of a frame as DrawItems, sorts them by state, and draws them in one
+ * pass. Consecutive items of the same mesh become a single instanced draw, so programs must take
+ * their transforms from the instance attributes (see Mesh3D::setInstanceLayout), as
+ * light_perspective_instanced.vert does. The queue computes each object's ObjectConstants once
+ * on the CPU.
+ *
+ * Where the context supports MultiDrawIndirect, every run of items that binds the same program,
+ * vertex array and textures is submitted with one glMultiDrawElementsIndirect call, each run a
+ * command that finds its instances through its base instance. So the number of draw calls
+ * follows the number of distinct states rather than the number of distinct meshes. Otherwise
+ * each run is its own instanced draw.
+ *
+ * Opaque items come first, grouped by program, then textures, then geometry, and front to back
+ * within each group so early depth testing rejects hidden fragments. Translucent items follow,
+ * back to front, with blending on and depth writes off.
+ *
+ * Sort keys, from the most significant bit:
+ *   opaque:      0 | program (7) | textures (16) | geometry (16) | depth (24)
+ *   translucent: 1 | inverted depth (24) | program (7) | textures (16) | geometry (16)
+ * Program, texture and geometry fields are small ids handed out in the order they are first seen
+ * each frame; the geometry id is a vertex array id (6 bits) followed by a range id (10 bits).
+ *
+ * Meshes with levels of detail (see Mesh3D::addLod) are drawn at the level their node's size on
+ * screen calls for: the projected diameter of its bounding sphere as a fraction of the viewport
+ * height. Level i + 1 takes over once that size falls below the i-th LOD threshold. To keep a
+ * node from flickering between two levels as it hovers around a threshold, it only leaves its
+ * current level once its size is past the threshold by the hysteresis fraction.
+ */
+class RenderQueue {
+public:
+	struct Stats {
+		// Items drawn by the last flush().
+		size_t items;
+		// Runs of identical meshes, each drawn as instances.
+		size_t commands;
+		// GL draw calls; fewer than commands when runs are drawn indirectly.
+		size_t drawCalls;
+		// Times flush() activated a different program, bound a different set of textures, or bound
+		// a different vertex array than the draw before.
+		size_t programChanges;
+		size_t textureChanges;
+		size_t vertexArrayChanges;
+		// Object nodes tested against the view frustum by submit(), subtrees culled because their
+		// bounds were outside it, and nodes whose meshes were queued. Nodes inside a subtree that
+		// is entirely in view are queued without a test.
+		size_t nodesTested;
+		size_t nodesCulled;
+		size_t nodesDrawn;
+		// Meshes of queued nodes culled by their own bounding spheres.
+		size_t meshesCulled;
+		// Items queued at a simplified level of detail rather than their full mesh.
+		size_t lodMeshes;
+		// Triangles drawn by the last flush(), over all instances.
+		size_t triangles;
+	};
+
+private:
+	std::vector<DrawItem> m_items;
+	std::vector<glm::mat4> m_transforms;
+	glm::mat4 m_view;
+	glm::mat4 m_viewProjection;
+	Frustum m_frustum;
+	bool m_culling;
+	// The projection's vertical scale, cot(fovy / 2), turning view-space sizes at a depth into
+	// fractions of the viewport's half-height.
+	float_t m_projectionScale;
+	std::vector<float_t> m_lodThresholds;
+	float_t m_lodHysteresis;
+
+	// Per-frame ids for the key fields.
+	std::unordered_map<ShaderProgram*, uint64_t> m_programIds;
+	std::unordered_map<uint64_t, uint64_t> m_textureIds;
+	std::unordered_map<uint64_t, uint64_t> m_vertexArrayIds;
+	std::unordered_map<uint64_t, uint64_t> m_rangeIds;
+
+	// Constants for each entry of m_transforms, and then in draw order, uploaded to the instance
+	// buffer by flush(). The matrices are computed in batches first.
+	std::vector<glm::mat4> m_modelViewProjections;
+	std::vector<glm::mat4> m_normalMatrices;
+	std::vector<ObjectConstants> m_objectConstants;
+	std::vector<MeshInstance> m_instanceData;
+	// One command per run of identical meshes, in draw order; baseInstance is the run's first item.
+	std::vector<DrawElementsIndirectCommand> m_runs;
+	GLBuffer m_instanceBuffer;
+	size_t m_instanceCapacity;
+	Stats m_stats;
+
+	void submitRecursive(const Object3D& object, ShaderProgram& program, bool insideFrustum);
+	uint64_t sortKey(const Mesh3D& mesh, ShaderProgram& program, float_t viewDepth);
+	/**
+	 * @brief The level of detail to draw the object's meshes at, of the given number of levels,
+	 * updating the level the object remembers.
+	 */
+	uint32_t selectLod(const Object3D& object, const glm::mat4& trueModel, size_t levels);
+
+public:
+	RenderQueue();
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	/**
+	 * @brief Starts a frame seen through the given view and projection matrices. The view matrix
+	 * decides item depths.
+	 */
+	void begin(const glm::mat4& view, const glm::mat4& projection);
+
+	/**
+	 * @brief Emits a DrawItem for every mesh of the object and its children that may be in view;
+	 * subtrees whose bounds are outside the view frustum are skipped. Objects are placed by their
+	 * world matrices, so TransformSystem::update() must have run since they last moved. The object
+	 * must stay alive, and its meshes unchanged, until flush() returns.
+	 */
+	void submit(const Object3D& object, ShaderProgram& program);
+
+	/**
+	 * @brief Turns frustum culling in submit() on or off. It is on by default.
+	 */
+	void setCulling(bool culling) { m_culling = culling; }
+
+	/**
+	 * @brief Sets the screen sizes, as fractions of the viewport height in decreasing order, below
+	 * which each successive level of detail is drawn, and the fraction by which a node's size must
+	 * cross a threshold before it changes level. Defaults to 0.25, 0.12 and 0.06, with 0.15.
+	 */
+	void setLodThresholds(std::vector<float_t> thresholds, float_t hysteresis);
+
+	/**
+	 * @brief Sorts and draws everything submitted since begin(), then empties the queue.
+	 */
+	void flush(sf::RenderWindow& window);
+
+	/**
+	 * @brief Counters for the last frame: culling by submit() since begin(), and drawing by flush().
+	 */
+	Stats stats() const { return m_stats; }
+};
@@ -2,20 +2,33 @@
 #include "Object3D.h"
 #include "Animation.h"
 /**
- * @brief Rotates an object at a continuous rate over an interval.
+ * @brief Rotates an object at a continuous rate over an interval, either by Euler angles or about
+ * one of its own axes.
  */
 class RotationAnimation : public Animation {
 private:
 	/**
-	 * @brief How much to increment the orientation by each second.
+	 * @brief The Euler angles to turn the object by each second.
 	 */
 	glm::vec3 m_perSecond;
 
+	/**
+	 * @brief For an axis rotation, the unit axis and the angle to turn about it each second.
+	 */
+	glm::vec3 m_axis;
+	float_t m_radiansPerSecond;
+	bool m_aboutAxis;
+
 	/**
 	 * @brief Advance the animation by the given time interval.
 	 */
-	void applyAnimation(float_t dt) override {
-		object().rotate(m_perSecond * dt);
+	void applyAnimation(Object3D& object, float_t dt) override {
+		if (m_aboutAxis) {
+			object.rotate(glm::angleAxis(m_radiansPerSecond * dt, m_axis));
+		}
+		else {
+			object.rotate(m_perSecond * dt);
+		}
 	}
 
 public:
@@ -23,7 +36,16 @@ public:
 	 * @brief Constructs a animation of a constant rotation by the given total rotation 
 	 * angle, linearly interpolated across the given duration.
 	 */
-	RotationAnimation(Object3D& object, float_t duration, const glm::vec3& totalRotation) : 
-		Animation(object, duration), m_perSecond(totalRotation / duration) {}
+	RotationAnimation(ObjectRef object, float_t duration, const glm::vec3& totalRotation) : 
+		Animation(std::move(object), duration), m_perSecond(totalRotation / duration), m_axis(), m_radiansPerSecond(0),
+		m_aboutAxis(false) {}
+
+	/**
+	 * @brief Constructs an animation turning the object by the given total angle about one of its
+	 * own axes, at a constant rate across the given duration.
+	 */
+	RotationAnimation(ObjectRef object, float_t duration, const glm::vec3& axis, float_t totalAngle) :
+		Animation(std::move(object), duration), m_perSecond(), m_axis(glm::normalize(axis)),
+		m_radiansPerSecond(totalAngle / duration), m_aboutAxis(true) {}
 };
 
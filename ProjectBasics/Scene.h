@@ -0,0 +1,72 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Animator.h"
+#include "BoundingVolumeTree.h"
+#include "ObjectStore.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief Defines a collection of objects that should be rendered with a specific shader program.
+ */
+struct Scene {
+	ShaderProgram defaultShader;
+	ObjectStore objects;
+	std::vector<Animator> animators;
+
+	// Indexes the objects by their world bounds, for finding what is in view and what the bird
+	// hits. Each leaf's value is its object's slot in the store.
+	BoundingVolumeTree tree{};
+	std::unordered_map<ObjectHandle, BoundingVolumeTree::Proxy, ObjectHandle::Hash> proxies{};
+
+	/**
+	 * @brief Adds every object not yet in the tree to it.
+	 */
+	void index() {
+		for (auto it = objects.begin(); it != objects.end(); ++it) {
+			if (proxies.count(it.handle()) == 0) {
+				proxies[it.handle()] = tree.insert(it->getWorldBounds(glm::mat4(1)), it.handle().index);
+			}
+		}
+	}
+
+	/**
+	 * @brief Adds an object to the store and the tree, and returns its handle.
+	 */
+	ObjectHandle spawn(Object3D&& object) {
+		auto handle = objects.insert(std::move(object));
+		proxies[handle] = tree.insert(objects.at(handle).getWorldBounds(glm::mat4(1)), handle.index);
+		return handle;
+	}
+
+	/**
+	 * @brief Removes an object from the tree and the store. Returns false if the handle was stale.
+	 */
+	bool despawn(ObjectHandle handle) {
+		auto proxy = proxies.find(handle);
+		if (proxy != proxies.end()) {
+			tree.remove(proxy->second);
+			proxies.erase(proxy);
+		}
+		return objects.erase(handle);
+	}
+
+	/**
+	 * @brief Refits the tree to the objects' current bounds. Objects that stayed inside their fat
+	 * boxes cost only a containment test.
+	 */
+	void updateTree() {
+		for (auto& [handle, proxy] : proxies) {
+			tree.update(proxy, objects.at(handle).getWorldBounds(glm::mat4(1)));
+		}
+	}
+
+	/**
+	 * @brief The object a tree leaf's value names, or NULL_HANDLE if its slot now holds an object
+	 * the tree does not index.
+	 */
+	ObjectHandle treeHandle(uint32_t value) const {
+		auto handle = objects.handleAt(value);
+		return proxies.count(handle) != 0 ? handle : ObjectStore::NULL_HANDLE;
+	}
+};
@@ -1,11 +1,15 @@
 #include "ShaderProgram.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
 #include <glad/glad.h>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 ShaderProgram::ShaderProgram()
-    : m_programId(-1) {
+    : m_programId(-1), m_stats() {
 
 }
 
@@ -88,54 +92,184 @@ void ShaderProgram::load(const std::string& vertexShaderPath, const std::string&
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    // Attach the shared blocks to their binding points; programs that don't declare a block skip it.
+    uint32_t frameBlock = glGetUniformBlockIndex(m_programId, "FrameBlock");
+    if (frameBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programId, frameBlock, FRAME_BLOCK_BINDING);
+    }
+    uint32_t objectBlock = glGetUniformBlockIndex(m_programId, "ObjectBlock");
+    if (objectBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programId, objectBlock, OBJECT_BLOCK_BINDING);
+    }
+
+    reflectUniforms();
+}
+
+void ShaderProgram::reflectUniforms()
+{
+    m_uniforms.clear();
+    m_uniformIndices.clear();
+
+    int32_t count = 0, maxNameLength = 0;
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+    for (int32_t i = 0; i < count; i++) {
+        int32_t length = 0, size = 0;
+        uint32_t type = 0;
+        glGetActiveUniform(m_programId, i, static_cast<int32_t>(nameBuffer.size()), &length, &size, &type,
+            nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+        int32_t location = glGetUniformLocation(m_programId, name.c_str());
+        if (location < 0) {
+            // Uniforms in blocks have no location, and are not set through this table.
+            continue;
+        }
+
+        int32_t index = static_cast<int32_t>(m_uniforms.size());
+        m_uniforms.push_back(UniformSlot{ location, type, {}, false });
+        m_uniformIndices[name] = index;
+        // Arrays are reported as "name[0]"; let them be found without the subscript too.
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            m_uniformIndices[name.substr(0, name.size() - 3)] = index;
+        }
+    }
+}
+
+UniformHandle ShaderProgram::uniform(const std::string& uniformName) const
+{
+    auto found = m_uniformIndices.find(uniformName);
+    return found == m_uniformIndices.end() ? UniformHandle() : UniformHandle{ found->second };
+}
+
+template <typename T>
+const ShaderProgram::UniformSlot* ShaderProgram::change(UniformHandle handle, const T& value)
+{
+    static_assert(sizeof(T) <= sizeof(UniformSlot::value), "Uniform value is larger than its cache");
+    if (!handle.isValid()) {
+        return nullptr;
+    }
+    auto& slot = m_uniforms[handle.index];
+    if (slot.hasValue && std::memcmp(slot.value.data(), &value, sizeof(T)) == 0) {
+        ++m_stats.skipped;
+        return nullptr;
+    }
+    std::memcpy(slot.value.data(), &value, sizeof(T));
+    slot.hasValue = true;
+    ++m_stats.issued;
+    return &slot;
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, bool value)
+{
+    setUniform(handle, static_cast<int32_t>(value));
 }
 
+void ShaderProgram::setUniform(UniformHandle handle, int32_t value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniform1i(slot->location, value);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, float_t value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniform1f(slot->location, value);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec2& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniform2fv(slot->location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec3& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniform3fv(slot->location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec4& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniform4fv(slot->location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::mat2& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniformMatrix2fv(slot->location, 1, false, &value[0][0]);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::mat3& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniformMatrix3fv(slot->location, 1, false, &value[0][0]);
+    }
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::mat4& value)
+{
+    if (auto* slot = change(handle, value)) {
+        glUniformMatrix4fv(slot->location, 1, false, &value[0][0]);
+    }
+}
+
+
 void ShaderProgram::activate()
 {
-    glUseProgram(m_programId);
+    GLStateCache::global().useProgram(m_programId);
 }
 
+
 void ShaderProgram::setUniform(const std::string& uniformName, bool value)
 {
-    glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), (int32_t)value);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, int32_t value)
 {
-    glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), value);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, float_t value)
 {
-    glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), (int)value);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec2& value)
 {
-    glUniform2fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec3& value)
 {
-    glUniform3fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec4& value)
 {
-    glUniform4fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat2& value)
 {
-    glUniformMatrix2fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat3& value)
 {
-    glUniformMatrix3fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+    setUniform(uniform(uniformName), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::mat4& value)
 {
-    glUniformMatrix4fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, false, &value[0][0]);
+    setUniform(uniform(uniformName), value);
 }
@@ -1,8 +1,57 @@
 #pragma once
 #include <glm/ext.hpp>
+#include <array>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Identifies one active uniform of a ShaderProgram, resolved once by name with
+ * ShaderProgram::uniform(). A handle for a name the program does not use is invalid, and setting
+ * it does nothing, just as GL ignores location -1.
+ */
+struct UniformHandle {
+	int32_t index = -1;
+
+	bool isValid() const { return index >= 0; }
+};
+
 class ShaderProgram {
+public:
+	struct Stats {
+		// glUniform calls made.
+		size_t issued;
+		// Calls skipped because the uniform already had the value.
+		size_t skipped;
+	};
+
+private:
+	/**
+	 * @brief An active uniform found by reflection after linking, and the value it was last set to.
+	 */
+	struct UniformSlot {
+		int32_t location;
+		uint32_t type;
+		std::array<uint8_t, sizeof(glm::mat4)> value;
+		bool hasValue;
+	};
+
 	uint32_t m_programId;
+	std::vector<UniformSlot> m_uniforms;
+	std::unordered_map<std::string, int32_t> m_uniformIndices;
+	Stats m_stats;
+
+	/**
+	 * @brief Reads every active uniform of the linked program into the uniform table.
+	 */
+	void reflectUniforms();
+
+	/**
+	 * @brief The slot to set, or nullptr if the handle is invalid or the uniform already holds the
+	 * value. Records the value as the uniform's current one.
+	 */
+	template <typename T>
+	const UniformSlot* change(UniformHandle handle, const T& value);
 
 public:
 	ShaderProgram();
@@ -10,6 +59,28 @@ public:
 
 	void activate();
 
+	uint32_t id() const { return m_programId; }
+
+	/**
+	 * @brief The handle of the named uniform. Array uniforms are found by their name with or
+	 * without "[0]".
+	 */
+	UniformHandle uniform(const std::string& uniformName) const;
+
+	/**
+	 * @brief Setting a uniform by handle involves no strings, and is skipped if the uniform already
+	 * has the value. Like the by-name overloads, the program must be active.
+	 */
+	void setUniform(UniformHandle handle, bool value);
+	void setUniform(UniformHandle handle, int32_t value);
+	void setUniform(UniformHandle handle, float_t value);
+	void setUniform(UniformHandle handle, const glm::vec2& value);
+	void setUniform(UniformHandle handle, const glm::vec3& value);
+	void setUniform(UniformHandle handle, const glm::vec4& value);
+	void setUniform(UniformHandle handle, const glm::mat2& value);
+	void setUniform(UniformHandle handle, const glm::mat3& value);
+	void setUniform(UniformHandle handle, const glm::mat4& value);
+
 	void setUniform(const std::string& uniformName, bool value);
 	void setUniform(const std::string& uniformName, int32_t value);
 	void setUniform(const std::string& uniformName, float_t value);
@@ -19,4 +90,6 @@ public:
 	void setUniform(const std::string& uniformName, const glm::mat2& value);
 	void setUniform(const std::string& uniformName, const glm::mat3& value);
 	void setUniform(const std::string& uniformName, const glm::mat4& value);
-};
\ No newline at end of file
+
+	Stats stats() const { return m_stats; }
+};
@@ -0,0 +1,195 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Stores values in slots named by generational handles: a slot index and the generation
+ * of the value in that slot. Erasing a value bumps its slot's generation, so handles to it go
+ * stale rather than dangling, and a later insert reuses the slot under the new generation.
+ * Looking a handle up is a bounds check, an index and a generation check.
+ *
+ * Slots live in fixed-size blocks that never move: inserting never invalidates references to
+ * other values, and moving the map keeps every handle valid. Iteration visits the live values in
+ * slot order, which for a map nothing was erased from is the order they were inserted in.
+ */
+template <typename T>
+class SlotMap {
+public:
+	struct Handle {
+		uint32_t index;
+		uint32_t generation;
+
+		bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Handle& other) const { return !(*this == other); }
+
+		/**
+		 * @brief Hashes handles, for keying unordered containers by them.
+		 */
+		struct Hash {
+			size_t operator()(const Handle& handle) const {
+				return std::hash<uint64_t>()(uint64_t(handle.generation) << 32 | handle.index);
+			}
+		};
+	};
+	static constexpr Handle NULL_HANDLE = { UINT32_MAX, 0 };
+
+private:
+	static constexpr uint32_t BLOCK_SIZE = 256;
+
+	struct Slot {
+		std::optional<T> value;
+		uint32_t generation = 0;
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> m_blocks;
+	uint32_t m_slotCount = 0;
+	std::vector<uint32_t> m_freeSlots;
+	size_t m_size = 0;
+
+	Slot& slot(uint32_t index) { return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+	const Slot& slot(uint32_t index) const { return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+
+	/**
+	 * @brief Walks the live values, skipping empty slots.
+	 */
+	template <typename Map, typename Value>
+	class Iterator {
+	private:
+		Map* m_map;
+		uint32_t m_index;
+
+		void skipEmpty() {
+			while (m_index < m_map->m_slotCount && !m_map->slot(m_index).value) {
+				++m_index;
+			}
+		}
+
+	public:
+		Iterator(Map* map, uint32_t index) : m_map(map), m_index(index) { skipEmpty(); }
+
+		Value& operator*() const { return *m_map->slot(m_index).value; }
+		Value* operator->() const { return &*m_map->slot(m_index).value; }
+		Iterator& operator++() {
+			++m_index;
+			skipEmpty();
+			return *this;
+		}
+		bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+		bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+
+		/**
+		 * @brief The handle of the value the iterator is at.
+		 */
+		Handle handle() const { return Handle{ m_index, m_map->slot(m_index).generation }; }
+	};
+
+public:
+	using iterator = Iterator<SlotMap, T>;
+	using const_iterator = Iterator<const SlotMap, const T>;
+
+	/**
+	 * @brief Constructs a value in a free slot, and returns its handle.
+	 */
+	template <typename... Args>
+	Handle emplace(Args&&... args) {
+		uint32_t index;
+		if (!m_freeSlots.empty()) {
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else {
+			if (m_slotCount % BLOCK_SIZE == 0) {
+				m_blocks.push_back(std::make_unique<Slot[]>(BLOCK_SIZE));
+			}
+			index = m_slotCount++;
+		}
+		Slot& s = slot(index);
+		s.value.emplace(std::forward<Args>(args)...);
+		++m_size;
+		return Handle{ index, s.generation };
+	}
+
+	Handle insert(T&& value) { return emplace(std::move(value)); }
+
+	/**
+	 * @brief Destroys the value, if the handle is not already stale. Returns whether it was.
+	 */
+	bool erase(Handle handle) {
+		if (!contains(handle)) {
+			return false;
+		}
+		Slot& s = slot(handle.index);
+		s.value.reset();
+		++s.generation;
+		m_freeSlots.push_back(handle.index);
+		--m_size;
+		return true;
+	}
+
+	void clear() {
+		for (uint32_t index = 0; index < m_slotCount; index++) {
+			Slot& s = slot(index);
+			if (s.value) {
+				erase(Handle{ index, s.generation });
+			}
+		}
+	}
+
+	bool contains(Handle handle) const {
+		return handle.index < m_slotCount && slot(handle.index).generation == handle.generation
+			&& slot(handle.index).value.has_value();
+	}
+
+	/**
+	 * @brief The value, or nullptr if the handle is stale.
+	 */
+	T* get(Handle handle) { return contains(handle) ? &*slot(handle.index).value : nullptr; }
+	const T* get(Handle handle) const { return contains(handle) ? &*slot(handle.index).value : nullptr; }
+
+	/**
+	 * @brief The value; throws if the handle is stale.
+	 */
+	T& at(Handle handle) {
+		if (!contains(handle)) {
+			throw std::runtime_error("Stale slot map handle");
+		}
+		return *slot(handle.index).value;
+	}
+	const T& at(Handle handle) const { return const_cast<SlotMap*>(this)->at(handle); }
+
+	/**
+	 * @brief The handle of the value in a slot, or NULL_HANDLE if the slot is free. For callers that
+	 * key other structures by slot index.
+	 */
+	Handle handleAt(uint32_t index) const {
+		return index < m_slotCount && slot(index).value ? Handle{ index, slot(index).generation } : NULL_HANDLE;
+	}
+
+	/**
+	 * @brief The handles of the live values, in slot order.
+	 */
+	std::vector<Handle> handles() const {
+		std::vector<Handle> result;
+		result.reserve(m_size);
+		for (auto it = begin(); it != end(); ++it) {
+			result.push_back(it.handle());
+		}
+		return result;
+	}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	/**
+	 * @brief One past the highest slot index in use so far, the size of arrays indexed by slot.
+	 */
+	uint32_t slotCount() const { return m_slotCount; }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, m_slotCount); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, m_slotCount); }
+};
@@ -1,25 +1,35 @@
 #pragma once
 #include <string>
 #include <filesystem>
+#include <memory>
 #include <SFML/Graphics.hpp>
+#include "CompressedTexture.h"
+#include "GLStateCache.h"
+#include "GLObject.h"
+
+class TextureEntry;
 
 /**
  * @brief Represents a texture that has been loaded into VRAM, and is expected to be bound
  * to a sampler2D with a given sampler name in the fragment shader.
+ *
+ * Textures come from the TextureRegistry, whose entry owns the GL texture. Copies share the
+ * entry, and the last one destroyed deletes the texture.
  */
 struct Texture {
 	// The ID of the texture, to be bound with glBindTexture when drawing a mesh.
 	uint32_t textureId;
 	// The name of the sampler2D uniform in the fragment shader that this texture will bind to.
 	std::string samplerName;
+	// Keeps the texture alive while anything uses it.
+	std::shared_ptr<const TextureEntry> entry;
 
 	/**
-	 * @brief Loads an SFML Image into VRAM and returns a Texture object identifying it.
+	 * @brief Loads an SFML Image into VRAM, returning the GL texture that owns it.
 	 */
-	static Texture loadImage(const sf::Image& texture, const std::string& samplerName) {
-		uint32_t texId;
-		glGenTextures(1, &texId);
-		glBindTexture(GL_TEXTURE_2D, texId);
+	static GLTexture loadImage(const sf::Image& texture) {
+		GLTexture texId = GLTexture::generate();
+		GLStateCache::global().bindTexture(0, texId.id());
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -27,8 +37,48 @@ struct Texture {
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.getSize().x, texture.getSize().y, 0, GL_RGBA,
 			GL_UNSIGNED_BYTE, texture.getPixelsPtr());
 		glGenerateMipmap(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLStateCache::global().bindTexture(0, 0);
+
+		return texId;
+	}
+
+	/**
+	 * @brief The OpenGL internal format for a block-compressed format. These enums come from
+	 * extensions, so glad's core 3.3 header does not define them.
+	 */
+	static uint32_t compressedInternalFormat(CompressedFormat format) {
+		switch (format) {
+		case CompressedFormat::BC1_RGB:
+			return 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		case CompressedFormat::BC3_RGBA:
+			return 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		case CompressedFormat::ETC2_RGB:
+			return 0x9274; // GL_COMPRESSED_RGB8_ETC2
+		case CompressedFormat::ETC2_RGBA:
+			return 0x9278; // GL_COMPRESSED_RGBA8_ETC2_EAC
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Loads a block-compressed image and its precomputed mip chain into VRAM as-is. The
+	 * driver neither decompresses nor generates mipmaps, so this is much cheaper than loadImage.
+	 */
+	static GLTexture loadCompressedImage(const CompressedImage& image) {
+		GLTexture texId = GLTexture::generate();
+		GLStateCache::global().bindTexture(0, texId.id());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int32_t>(image.levels.size()) - 1);
+		for (size_t i = 0; i < image.levels.size(); i++) {
+			auto& level = image.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<int32_t>(i), compressedInternalFormat(image.format),
+				level.width, level.height, 0, static_cast<int32_t>(level.size), level.data);
+		}
+		GLStateCache::global().bindTexture(0, 0);
 
-		return Texture{ texId, samplerName };
+		return texId;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include <glad/glad.h>
+#include "TextureRegistry.h"
+#include "MappedFile.h"
+#include "TextureStreamer.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	const CompressedFormat COMPRESSED_FORMATS[] = {
+		CompressedFormat::BC1_RGB, CompressedFormat::BC3_RGBA, CompressedFormat::ETC2_RGB, CompressedFormat::ETC2_RGBA
+	};
+
+	uint32_t formatBit(CompressedFormat format) {
+		for (uint32_t i = 0; i < std::size(COMPRESSED_FORMATS); i++) {
+			if (COMPRESSED_FORMATS[i] == format) {
+				return 1u << i;
+			}
+		}
+		return 0;
+	}
+}
+
+TextureEntry::~TextureEntry() {
+	// m_texture deletes the GL texture after this.
+	if (m_registry != nullptr) {
+		m_registry->release(*this);
+	}
+}
+
+TextureRegistry& TextureRegistry::global() {
+	static TextureRegistry registry;
+	return registry;
+}
+
+uint64_t TextureRegistry::hashContent(const void* data, size_t size) {
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+	auto bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+std::string TextureRegistry::pathKey(const std::filesystem::path& path) {
+	return std::filesystem::weakly_canonical(path).generic_string();
+}
+
+Texture TextureRegistry::share(const std::shared_ptr<const TextureEntry>& entry, const std::string& pathKey,
+	const std::string& samplerName) {
+	auto& byPath = m_byPath[pathKey];
+	if (pathKey != entry->m_pathKey && byPath.lock() != entry) {
+		entry->m_aliasKeys.push_back(pathKey);
+	}
+	byPath = entry;
+	return Texture{ entry->textureId(), samplerName, entry };
+}
+
+std::shared_ptr<const TextureEntry> TextureRegistry::findContent(uint64_t contentHash, size_t contentSize) const {
+	auto existing = m_byContent.find(contentHash);
+	if (existing == m_byContent.end()) {
+		return nullptr;
+	}
+	auto entry = existing->second.lock();
+	// A matching size makes a 64-bit hash collision between two different images vanishingly unlikely.
+	if (entry != nullptr && entry->m_contentSize != contentSize) {
+		return nullptr;
+	}
+	return entry;
+}
+
+void TextureRegistry::release(const TextureEntry& entry) {
+	auto forgetPath = [this](const std::string& pathKey) {
+		// The path may since have been bound to another, live entry.
+		auto byPath = m_byPath.find(pathKey);
+		if (byPath != m_byPath.end() && byPath->second.expired()) {
+			m_byPath.erase(byPath);
+		}
+	};
+	forgetPath(entry.m_pathKey);
+	for (const auto& alias : entry.m_aliasKeys) {
+		forgetPath(alias);
+	}
+	auto byContent = m_byContent.find(entry.m_contentHash);
+	if (byContent != m_byContent.end() && byContent->second.expired()) {
+		m_byContent.erase(byContent);
+	}
+	--m_stats.live;
+}
+
+bool TextureRegistry::supportsFormat(CompressedFormat format) {
+	if (!m_formatsQueried) {
+		m_formatsQueried = true;
+		bool s3tc = false, etc2 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+		int32_t extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (int32_t i = 0; i < extensionCount; i++) {
+			auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+				s3tc = true;
+			}
+			else if (std::strcmp(name, "GL_ARB_ES3_compatibility") == 0) {
+				etc2 = true;
+			}
+		}
+		if (s3tc) {
+			m_supportedFormats |= formatBit(CompressedFormat::BC1_RGB) | formatBit(CompressedFormat::BC3_RGBA);
+		}
+		if (etc2) {
+			m_supportedFormats |= formatBit(CompressedFormat::ETC2_RGB) | formatBit(CompressedFormat::ETC2_RGBA);
+		}
+	}
+	return (m_supportedFormats & formatBit(format)) != 0;
+}
+
+std::shared_ptr<const TextureEntry> TextureRegistry::lookup(const std::string& pathKey, uint64_t contentHash,
+	size_t contentSize) {
+	++m_stats.requested;
+	auto existing = m_byPath.find(pathKey);
+	if (existing != m_byPath.end()) {
+		if (auto entry = existing->second.lock()) {
+			++m_stats.pathHits;
+			return entry;
+		}
+	}
+	if (auto entry = findContent(contentHash, contentSize)) {
+		++m_stats.contentHits;
+		return entry;
+	}
+	return nullptr;
+}
+
+Texture TextureRegistry::insert(GLTexture&& texture, uint64_t contentHash, size_t contentSize,
+	const std::string& pathKey, const std::string& samplerName) {
+	auto entry = std::make_shared<const TextureEntry>(std::move(texture), contentHash, contentSize, pathKey, this);
+	m_byContent[contentHash] = entry;
+	++m_stats.uploaded;
+	++m_stats.live;
+	return share(entry, pathKey, samplerName);
+}
+
+std::optional<Texture> TextureRegistry::acquireCompressed(const std::filesystem::path& path,
+	const std::string& samplerName) {
+	if (!isCompressedTextureCurrent(path)) {
+		return std::nullopt;
+	}
+	try {
+		MappedFile file(compressedTexturePath(path));
+		auto image = parseKtx2(file.data(), file.size());
+		if (supportsFormat(image.format)) {
+			return acquire(path, hashContent(file.data(), file.size()), file.size(), image, samplerName);
+		}
+	}
+	catch (std::runtime_error&) {
+		// A damaged .ktx2 is only a cache; fall back to the source image.
+	}
+	return std::nullopt;
+}
+
+Texture TextureRegistry::acquire(const std::filesystem::path& path, const std::string& samplerName) {
+	auto key = pathKey(path);
+	auto existing = m_byPath.find(key);
+	if (existing != m_byPath.end()) {
+		if (auto entry = existing->second.lock()) {
+			++m_stats.requested;
+			++m_stats.pathHits;
+			return Texture{ entry->textureId(), samplerName, entry };
+		}
+	}
+
+	if (auto texture = acquireCompressed(path, samplerName)) {
+		return *texture;
+	}
+
+	// Hash the encoded file rather than the decoded pixels, so a duplicate is found before
+	// paying for the decode.
+	std::ifstream file(path, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	uint64_t hash = hashContent(bytes.data(), bytes.size());
+	if (auto entry = findContent(hash, bytes.size())) {
+		++m_stats.requested;
+		++m_stats.contentHits;
+		return share(entry, key, samplerName);
+	}
+
+	sf::Image image;
+	image.loadFromMemory(bytes.data(), bytes.size());
+	return acquire(path, hash, bytes.size(), image, samplerName);
+}
+
+Texture TextureRegistry::acquire(const std::filesystem::path& path, uint64_t contentHash, size_t contentSize,
+	const sf::Image& image, const std::string& samplerName) {
+	auto key = pathKey(path);
+	if (auto entry = lookup(key, contentHash, contentSize)) {
+		return share(entry, key, samplerName);
+	}
+	return insert(Texture::loadImage(image), contentHash, contentSize, key, samplerName);
+}
+
+Texture TextureRegistry::acquire(const std::filesystem::path& path, uint64_t contentHash, size_t contentSize,
+	const CompressedImage& image, const std::string& samplerName) {
+	auto key = pathKey(path);
+	if (auto entry = lookup(key, contentHash, contentSize)) {
+		return share(entry, key, samplerName);
+	}
+	++m_stats.compressedUploads;
+	return insert(Texture::loadCompressedImage(image), contentHash, contentSize, key,
+		samplerName);
+}
+
+Texture TextureRegistry::acquireStreamed(const std::filesystem::path& path, const std::string& samplerName) {
+	auto key = pathKey(path);
+	auto existing = m_byPath.find(key);
+	if (existing != m_byPath.end()) {
+		if (auto entry = existing->second.lock()) {
+			++m_stats.requested;
+			++m_stats.pathHits;
+			return Texture{ entry->textureId(), samplerName, entry };
+		}
+	}
+	// A compressed copy is a fraction of the size and already carries its mips; upload it at once.
+	if (auto texture = acquireCompressed(path, samplerName)) {
+		return *texture;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	uint64_t hash = hashContent(bytes.data(), bytes.size());
+	if (auto entry = lookup(key, hash, bytes.size())) {
+		return share(entry, key, samplerName);
+	}
+
+	sf::Image image;
+	image.loadFromMemory(bytes.data(), bytes.size());
+	auto levels = buildMipChain(image.getPixelsPtr(), image.getSize().x, image.getSize().y);
+	auto texture = insert(TextureStreamer::createTexture(levels), hash, bytes.size(), key, samplerName);
+	++m_stats.streamed;
+	TextureStreamer::global().enqueue(texture.entry, std::move(levels));
+	return texture;
+}
+
+bool TextureRegistry::contains(const std::filesystem::path& path) const {
+	auto existing = m_byPath.find(pathKey(path));
+	return existing != m_byPath.end() && !existing->second.expired();
+}
+
+TextureRegistry::Stats TextureRegistry::stats() const {
+	return m_stats;
+}
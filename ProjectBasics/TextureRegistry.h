@@ -0,0 +1,144 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Texture.h"
+
+class TextureRegistry;
+
+/**
+ * @brief One texture in VRAM shared through the TextureRegistry. The GL texture is deleted when
+ * the last Texture referring to the entry is destroyed.
+ */
+class TextureEntry {
+	friend class TextureRegistry;
+
+private:
+	GLTexture m_texture;
+	uint64_t m_contentHash;
+	size_t m_contentSize;
+	std::string m_pathKey;
+	// Other paths the registry has shared the entry under, whose lookups it forgets on release.
+	mutable std::vector<std::string> m_aliasKeys;
+	TextureRegistry* m_registry;
+
+public:
+	TextureEntry(GLTexture&& texture, uint64_t contentHash, size_t contentSize, const std::string& pathKey,
+		TextureRegistry* registry)
+		: m_texture(std::move(texture)), m_contentHash(contentHash), m_contentSize(contentSize), m_pathKey(pathKey),
+		m_registry(registry) {}
+	~TextureEntry();
+
+	TextureEntry(const TextureEntry&) = delete;
+	TextureEntry& operator=(const TextureEntry&) = delete;
+
+	uint32_t textureId() const { return m_texture.id(); }
+};
+
+/**
+ * @brief A process-wide registry of textures loaded from image files. Requests for a file that
+ * is already in VRAM, either under the same path or under another path with identical contents,
+ * share one GL texture instead of decoding and uploading it again.
+ */
+class TextureRegistry {
+	friend class TextureEntry;
+
+public:
+	struct Stats {
+		// Calls to acquire().
+		size_t requested;
+		// Textures that were decoded and uploaded, i.e. requests that missed the registry.
+		size_t uploaded;
+		// Requests satisfied by a texture already loaded from the same path.
+		size_t pathHits;
+		// Requests satisfied by a texture with identical file contents under a different path.
+		size_t contentHits;
+		// Textures currently in VRAM.
+		size_t live;
+		// Uploads that came from a precompressed .ktx2 file instead of the source image.
+		size_t compressedUploads;
+		// Uploads handed to the TextureStreamer by acquireStreamed().
+		size_t streamed;
+	};
+
+private:
+	std::unordered_map<std::string, std::weak_ptr<const TextureEntry>> m_byPath;
+	std::unordered_map<uint64_t, std::weak_ptr<const TextureEntry>> m_byContent;
+	Stats m_stats;
+	// Bit i is set if CompressedFormat with index i in COMPRESSED_FORMATS can be uploaded.
+	uint32_t m_supportedFormats;
+	bool m_formatsQueried;
+
+	static std::string pathKey(const std::filesystem::path& path);
+	Texture share(const std::shared_ptr<const TextureEntry>& entry, const std::string& pathKey,
+		const std::string& samplerName);
+	std::shared_ptr<const TextureEntry> findContent(uint64_t contentHash, size_t contentSize) const;
+	/**
+	 * @brief Counts a request and returns the live texture for the given path or contents, if any.
+	 */
+	std::shared_ptr<const TextureEntry> lookup(const std::string& pathKey, uint64_t contentHash, size_t contentSize);
+	Texture insert(GLTexture&& texture, uint64_t contentHash, size_t contentSize, const std::string& pathKey,
+		const std::string& samplerName);
+	void release(const TextureEntry& entry);
+	/**
+	 * @brief Acquires the image's .ktx2 copy, if it is current, intact and in a supported format.
+	 */
+	std::optional<Texture> acquireCompressed(const std::filesystem::path& path, const std::string& samplerName);
+
+public:
+	TextureRegistry() : m_stats(), m_supportedFormats(0), m_formatsQueried(false) {}
+
+	/**
+	 * @brief The registry shared by the whole process.
+	 */
+	static TextureRegistry& global();
+
+	/**
+	 * @brief A 64-bit FNV-1a hash of the given bytes, used to recognize identical image files.
+	 */
+	static uint64_t hashContent(const void* data, size_t size);
+
+	/**
+	 * @brief True if the current OpenGL context can sample textures of the given compressed format.
+	 * Must be called on the thread that owns the context.
+	 */
+	bool supportsFormat(CompressedFormat format);
+
+	/**
+	 * @brief Returns the texture for the image file at the given path, loading it into VRAM only
+	 * if no live texture has the same path or the same file contents. If the image has a current
+	 * .ktx2 copy in a format the GPU supports, that copy is uploaded instead of the source image.
+	 */
+	Texture acquire(const std::filesystem::path& path, const std::string& samplerName);
+
+	/**
+	 * @brief Like acquire(path, samplerName), for an image that was already read and decoded
+	 * elsewhere (e.g. on an AssetLoader worker thread).
+	 */
+	Texture acquire(const std::filesystem::path& path, uint64_t contentHash, size_t contentSize,
+		const sf::Image& image, const std::string& samplerName);
+
+	/**
+	 * @brief Like acquire(path, samplerName), for a compressed image that was already read and parsed
+	 * elsewhere. The content hash is of the .ktx2 file, not the source image.
+	 */
+	Texture acquire(const std::filesystem::path& path, uint64_t contentHash, size_t contentSize,
+		const CompressedImage& image, const std::string& samplerName);
+
+	/**
+	 * @brief Like acquire(path, samplerName), but a texture that has to be uploaded from its source
+	 * image starts with only its smallest mips resident and is completed over later frames by
+	 * TextureStreamer::global().update().
+	 */
+	Texture acquireStreamed(const std::filesystem::path& path, const std::string& samplerName);
+
+	/**
+	 * @brief True if a texture loaded from the given path is still in VRAM.
+	 */
+	bool contains(const std::filesystem::path& path) const;
+
+	Stats stats() const;
+};
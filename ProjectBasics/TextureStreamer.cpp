@@ -0,0 +1,158 @@
+#include "TextureStreamer.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <cstring>
+
+TextureStreamer::TextureStreamer(size_t pixelBufferCount, size_t pixelBufferBytes)
+	: m_pixelBuffers(pixelBufferCount), m_pixelBufferBytes(pixelBufferBytes),
+	m_nextPixelBuffer(0), m_stats() {}
+
+TextureStreamer& TextureStreamer::global() {
+	static TextureStreamer streamer;
+	return streamer;
+}
+
+GLTexture TextureStreamer::createTexture(const std::vector<MipLevel>& levels) {
+	GLTexture texId = GLTexture::generate();
+	GLStateCache::global().bindTexture(0, texId.id());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// GL 3.3 has no glTexStorage2D, so allocate every level up front with glTexImage2D; the
+	// texture never changes size afterwards, only its contents.
+	size_t baseLevel = levels.size() - 1;
+	for (size_t i = 0; i < levels.size(); i++) {
+		auto& level = levels[i];
+		bool resident = level.width <= RESIDENT_TAIL_SIZE && level.height <= RESIDENT_TAIL_SIZE;
+		glTexImage2D(GL_TEXTURE_2D, static_cast<int32_t>(i), GL_RGBA8, level.width, level.height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, resident ? level.rgba.data() : nullptr);
+		if (resident) {
+			baseLevel = std::min(baseLevel, i);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<int32_t>(baseLevel));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int32_t>(levels.size()) - 1);
+	GLStateCache::global().bindTexture(0, 0);
+	return texId;
+}
+
+void TextureStreamer::enqueue(const std::shared_ptr<const TextureEntry>& entry, std::vector<MipLevel>&& levels) {
+	++m_stats.started;
+	size_t baseLevel = 0;
+	while (levels[baseLevel].width > RESIDENT_TAIL_SIZE || levels[baseLevel].height > RESIDENT_TAIL_SIZE) {
+		baseLevel++;
+	}
+	if (baseLevel == 0) {
+		++m_stats.completed;
+		return;
+	}
+	// The tail is already in VRAM; only keep the levels still to be streamed.
+	levels.resize(baseLevel);
+	m_streams.push_back(Stream{ entry, entry->textureId(), std::move(levels), baseLevel - 1, 0 });
+}
+
+TextureStreamer::PixelBuffer* TextureStreamer::acquirePixelBuffer() {
+	auto& buffer = m_pixelBuffers[m_nextPixelBuffer];
+	if (buffer.fence != nullptr) {
+		if (glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+			return nullptr;
+		}
+		glDeleteSync(buffer.fence);
+		buffer.fence = nullptr;
+	}
+	m_nextPixelBuffer = (m_nextPixelBuffer + 1) % m_pixelBuffers.size();
+	return &buffer;
+}
+
+void TextureStreamer::update(size_t byteBudget) {
+	if (m_streams.empty()) {
+		return;
+	}
+	if (!m_pixelBuffers.front().buffer) {
+		for (auto& buffer : m_pixelBuffers) {
+			buffer.buffer = GLBuffer::generate();
+		}
+	}
+
+	auto& state = GLStateCache::global();
+	size_t sent = 0;
+	while (!m_streams.empty() && (sent == 0 || sent < byteBudget)) {
+		auto& stream = m_streams.front();
+		if (stream.entry.expired()) {
+			m_streams.pop_front();
+			continue;
+		}
+
+		auto* buffer = acquirePixelBuffer();
+		if (buffer == nullptr) {
+			++m_stats.stalls;
+			break;
+		}
+
+		auto& level = stream.levels[stream.level];
+		size_t rowBytes = size_t(level.width) * 4;
+		size_t budgetRows = std::max<size_t>(1, (byteBudget > sent ? byteBudget - sent : 0) / rowBytes);
+		size_t bufferRows = std::max<size_t>(1, m_pixelBufferBytes / rowBytes);
+		uint32_t rows = static_cast<uint32_t>(std::min<size_t>({ level.height - stream.rowsUploaded, budgetRows,
+			bufferRows }));
+		size_t bytes = rows * rowBytes;
+		const uint8_t* source = level.rgba.data() + stream.rowsUploaded * rowBytes;
+
+		// Orphan the buffer's previous storage, then copy the rows in. glTexSubImage2D then reads
+		// from the buffer asynchronously instead of from our memory.
+		state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->buffer.id());
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		bool copied = false;
+		if (mapped != nullptr) {
+			std::memcpy(mapped, source, bytes);
+			copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		}
+		state.bindTexture(0, stream.textureId);
+		if (copied) {
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<int32_t>(stream.level), 0, stream.rowsUploaded, level.width,
+				rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		else {
+			// The mapping failed or its contents were lost; upload these rows synchronously.
+			state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<int32_t>(stream.level), 0, stream.rowsUploaded, level.width,
+				rows, GL_RGBA, GL_UNSIGNED_BYTE, source);
+		}
+		state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		stream.rowsUploaded += rows;
+		sent += bytes;
+		m_stats.bytesUploaded += bytes;
+
+		if (stream.rowsUploaded == level.height) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<int32_t>(stream.level));
+			++m_stats.levelsUploaded;
+			level.rgba = std::vector<uint8_t>();
+			if (stream.level == 0) {
+				++m_stats.completed;
+				m_streams.pop_front();
+			}
+			else {
+				stream.level--;
+				stream.rowsUploaded = 0;
+			}
+		}
+		state.bindTexture(0, 0);
+	}
+}
+
+void TextureStreamer::clear() {
+	m_streams.clear();
+	for (auto& buffer : m_pixelBuffers) {
+		if (buffer.fence != nullptr) {
+			glDeleteSync(buffer.fence);
+		}
+		buffer.buffer.reset();
+		buffer.fence = nullptr;
+	}
+}
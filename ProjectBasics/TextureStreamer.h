@@ -0,0 +1,110 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include "CompressedTexture.h"
+#include "GLObject.h"
+#include "TextureRegistry.h"
+
+/**
+ * @brief Uploads large textures a few rows at a time, spreading the work over many frames.
+ * A streamed texture is usable immediately: its smallest mips are uploaded when it is created,
+ * and GL_TEXTURE_BASE_LEVEL is lowered each time a larger level finishes, so it sharpens as
+ * update() is called once per frame.
+ *
+ * Rows are copied into a ring of pixel buffer objects, so glTexSubImage2D returns without waiting
+ * for the transfer, and a buffer is only reused once a fence shows the GPU is done reading it.
+ */
+class TextureStreamer {
+public:
+	struct Stats {
+		// Textures handed to enqueue().
+		size_t started;
+		// Textures whose level 0 is resident.
+		size_t completed;
+		// Mip levels uploaded through pixel buffers.
+		size_t levelsUploaded;
+		size_t bytesUploaded;
+		// update() calls that stopped early because every pixel buffer was still in use.
+		size_t stalls;
+	};
+
+private:
+	struct Stream {
+		std::weak_ptr<const TextureEntry> entry;
+		uint32_t textureId;
+		std::vector<MipLevel> levels;
+		// The level being uploaded; every level above it is already resident.
+		size_t level;
+		uint32_t rowsUploaded;
+	};
+
+	struct PixelBuffer {
+		GLBuffer buffer;
+		GLsync fence = nullptr;
+	};
+
+	std::deque<Stream> m_streams;
+	std::vector<PixelBuffer> m_pixelBuffers;
+	size_t m_pixelBufferBytes;
+	size_t m_nextPixelBuffer;
+	Stats m_stats;
+
+	/**
+	 * @brief The next pixel buffer in the ring, or nullptr if the GPU is still reading from it.
+	 */
+	PixelBuffer* acquirePixelBuffer();
+
+public:
+	/**
+	 * @brief Levels at most this many pixels wide and high are uploaded as soon as a texture is
+	 * created, so it never samples as incomplete.
+	 */
+	static const uint32_t RESIDENT_TAIL_SIZE = 64;
+
+	/**
+	 * @brief The pixel buffer ring is created lazily, on the first update() with work queued.
+	 * Each buffer carries at most pixelBufferBytes per upload.
+	 */
+	explicit TextureStreamer(size_t pixelBufferCount = 3, size_t pixelBufferBytes = 4 * 1024 * 1024);
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	/**
+	 * @brief The streamer shared by the whole process.
+	 */
+	static TextureStreamer& global();
+
+	/**
+	 * @brief Creates a texture with storage for every level of the mip chain, uploads the levels
+	 * no larger than RESIDENT_TAIL_SIZE, and makes the largest of those the base level.
+	 */
+	static GLTexture createTexture(const std::vector<MipLevel>& levels);
+
+	/**
+	 * @brief Queues the remaining levels of a texture made by createTexture. Streaming stops early
+	 * if the entry is destroyed first.
+	 */
+	void enqueue(const std::shared_ptr<const TextureEntry>& entry, std::vector<MipLevel>&& levels);
+
+	/**
+	 * @brief Uploads queued rows until about the given number of bytes has been sent. At least one
+	 * row is uploaded per call while anything is queued. Call once per frame on the context thread.
+	 */
+	void update(size_t byteBudget);
+
+	/**
+	 * @brief True when every queued texture is fully resident.
+	 */
+	bool isIdle() const { return m_streams.empty(); }
+
+	/**
+	 * @brief Drops every queued texture and deletes the pixel buffers. Must be called while the
+	 * OpenGL context still exists.
+	 */
+	void clear();
+
+	Stats stats() const { return m_stats; }
+};
@@ -0,0 +1,279 @@
+#include "TransformSystem.h"
+#include "BatchMath.h"
+#include <cmath>
+#include <algorithm>
+
+TransformSystem::TransformSystem() : m_stats(), m_orderDirty(false) {}
+
+TransformSystem& TransformSystem::global() {
+	static TransformSystem system;
+	return system;
+}
+
+glm::mat4 TransformSystem::composeLocal(const LocalTransform& local, const glm::mat4& baseTransform) {
+	// The rotation matrix of the quaternion, with each column scaled: R * S.
+	const glm::quat& q = local.rotation;
+	float_t xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float_t xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float_t wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	const glm::vec3& s = local.scale;
+	glm::mat4 m(
+		(1 - 2 * (yy + zz)) * s.x, 2 * (xy + wz) * s.x, 2 * (xz - wy) * s.x, 0,
+		2 * (xy - wz) * s.y, (1 - 2 * (xx + zz)) * s.y, 2 * (yz + wx) * s.y, 0,
+		2 * (xz + wy) * s.z, 2 * (yz - wx) * s.z, (1 - 2 * (xx + yy)) * s.z, 0,
+		0, 0, 0, 1);
+	// Rotating and scaling about the center c takes x to position + S * c + R * S * (x - c).
+	const glm::vec3& c = local.center;
+	glm::vec3 rotatedCenter = glm::vec3(m[0]) * c.x + glm::vec3(m[1]) * c.y + glm::vec3(m[2]) * c.z;
+	m[3] = glm::vec4(local.position + c * s - rotatedCenter, 1);
+	return m * baseTransform;
+}
+
+glm::quat TransformSystem::eulerToQuat(const glm::vec3& orientation) {
+	return glm::angleAxis(orientation.z, glm::vec3(0, 0, 1)) * glm::angleAxis(orientation.x, glm::vec3(1, 0, 0))
+		* glm::angleAxis(orientation.y, glm::vec3(0, 1, 0));
+}
+
+glm::vec3 TransformSystem::quatToEuler(const glm::quat& rotation) {
+	// Rz(z) * Rx(x) * Ry(y) has sin(x) in row 2, column 1, and cos(x) times the sines and cosines
+	// of z and y beside it. Indexing is m[column][row].
+	glm::mat3 m = glm::mat3_cast(rotation);
+	float_t x = std::atan2(m[1][2], std::sqrt(m[0][2] * m[0][2] + m[2][2] * m[2][2]));
+	float_t z = std::atan2(-m[1][0], m[1][1]);
+	// Near gimbal lock, cos(x) leaves z and y only their sum to go by, and z from above may be
+	// anything. Taking y from the first row of Rx(x) * Ry(y) = Rz(-z) * m, which is (cos(y), 0,
+	// sin(y)) whatever x is, makes the three angles reproduce the rotation either way.
+	float_t cz = std::cos(z), sz = std::sin(z);
+	float_t y = std::atan2(cz * m[2][0] + sz * m[2][1], cz * m[0][0] + sz * m[0][1]);
+	return glm::vec3(x, y, z);
+}
+
+TransformSystem::Handle TransformSystem::create(const glm::mat4& baseTransform) {
+	Handle handle;
+	if (m_freeHandles.empty()) {
+		handle = static_cast<Handle>(m_entries.size());
+		m_entries.push_back(0);
+	}
+	else {
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	uint32_t entry = static_cast<uint32_t>(m_handles.size());
+	m_entries[handle] = entry;
+
+	LocalTransform local{ glm::vec3(0), glm::vec3(0), glm::quat(1, 0, 0, 0), glm::vec3(1), glm::vec3(0) };
+	glm::mat4 localMatrix = composeLocal(local, baseTransform);
+	m_parents.push_back(NO_ENTRY);
+	m_locals.push_back(local);
+	m_baseTransforms.push_back(baseTransform);
+	m_localMatrices.push_back(localMatrix);
+	m_localDirty.push_back(0);
+	// A root's world matrix is its local matrix, so a new node is correct even before update().
+	m_worldMatrices.push_back(localMatrix);
+	m_subtreeEnds.push_back(entry + 1);
+	m_handles.push_back(handle);
+	m_worldDirty.push_back(0);
+	m_boundsDirty.push_back(1);
+	return handle;
+}
+
+TransformSystem::Handle TransformSystem::clone(Handle source) {
+	// Bring the source's local matrix up to date, to copy it.
+	localMatrix(source);
+	Handle handle = create(m_baseTransforms[m_entries[source]]);
+	uint32_t from = m_entries[source];
+	uint32_t to = m_entries[handle];
+	m_locals[to] = m_locals[from];
+	m_localMatrices[to] = m_localMatrices[from];
+	m_worldMatrices[to] = m_localMatrices[from];
+	return handle;
+}
+
+void TransformSystem::release(Handle node) {
+	markBoundsDirty(m_parents[m_entries[node]]);
+	m_handles[m_entries[node]] = NULL_HANDLE;
+	m_entries[node] = NO_ENTRY;
+	m_freeHandles.push_back(node);
+	m_orderDirty = true;
+}
+
+void TransformSystem::setParent(Handle node, Handle parent) {
+	uint32_t entry = m_entries[node];
+	uint32_t parentEntry = parent == NULL_HANDLE ? NO_ENTRY : m_entries[parent];
+	if (m_parents[entry] == parentEntry) {
+		return;
+	}
+	// Both parents' subtrees change.
+	markBoundsDirty(m_parents[entry]);
+	markBoundsDirty(parentEntry);
+	m_parents[entry] = parentEntry;
+	// The node's subtree moves to follow its new parent.
+	m_orderDirty = true;
+	markWorldDirty(entry);
+}
+
+TransformSystem::Handle TransformSystem::parent(Handle node) const {
+	uint32_t parentEntry = m_parents[m_entries[node]];
+	return parentEntry == NO_ENTRY ? NULL_HANDLE : m_handles[parentEntry];
+}
+
+void TransformSystem::markDirty(Handle node) {
+	uint32_t entry = m_entries[node];
+	m_localDirty[entry] = 1;
+	markWorldDirty(entry);
+	// The node moves within its ancestors' subtrees, but its own subtree moves with it.
+	markBoundsDirty(m_parents[entry]);
+}
+
+void TransformSystem::markWorldDirty(uint32_t entry) {
+	if (!m_worldDirty[entry]) {
+		m_worldDirty[entry] = 1;
+		m_dirtyEntries.push_back(entry);
+	}
+}
+
+void TransformSystem::markBoundsDirty(uint32_t entry) {
+	while (entry != NO_ENTRY && !m_boundsDirty[entry]) {
+		m_boundsDirty[entry] = 1;
+		entry = m_parents[entry];
+	}
+}
+
+void TransformSystem::rebuildLocalEntry(uint32_t entry) const {
+	m_localMatrices[entry] = composeLocal(m_locals[entry], m_baseTransforms[entry]);
+	m_localDirty[entry] = 0;
+}
+
+const glm::mat4& TransformSystem::localMatrix(Handle node) const {
+	uint32_t entry = m_entries[node];
+	if (m_localDirty[entry]) {
+		rebuildLocalEntry(entry);
+	}
+	return m_localMatrices[entry];
+}
+
+void TransformSystem::update() {
+	m_stats = Stats();
+	if (m_orderDirty) {
+		reorder();
+	}
+	// In entry order, a dirty node's subtree covers any dirty nodes below it, which need no
+	// second pass.
+	std::sort(m_dirtyEntries.begin(), m_dirtyEntries.end());
+	uint32_t covered = 0;
+	for (uint32_t dirty : m_dirtyEntries) {
+		m_worldDirty[dirty] = 0;
+		if (dirty < covered) {
+			continue;
+		}
+		uint32_t end = m_subtreeEnds[dirty];
+		for (uint32_t i = dirty; i < end; i++) {
+			if (m_localDirty[i]) {
+				rebuildLocalEntry(i);
+				++m_stats.localRebuilds;
+			}
+		}
+		BatchMath::global().propagate(m_parents.data(), m_localMatrices.data(), m_worldMatrices.data(), dirty, end,
+			NO_ENTRY);
+		m_stats.worldUpdates += end - dirty;
+		covered = end;
+	}
+	m_dirtyEntries.clear();
+}
+
+void TransformSystem::reorder() {
+	uint32_t count = static_cast<uint32_t>(m_parents.size());
+	auto isLive = [this](uint32_t entry) { return entry != NO_ENTRY && m_handles[entry] != NULL_HANDLE; };
+
+	// The children of each entry, as consecutive runs of one array.
+	std::vector<uint32_t> childStart(count + 1, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (isLive(i) && isLive(m_parents[i])) {
+			childStart[m_parents[i] + 1]++;
+		}
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		childStart[i + 1] += childStart[i];
+	}
+	std::vector<uint32_t> children(childStart[count]);
+	std::vector<uint32_t> nextChild(childStart.begin(), childStart.end() - 1);
+	for (uint32_t i = 0; i < count; i++) {
+		if (isLive(i) && isLive(m_parents[i])) {
+			children[nextChild[m_parents[i]]++] = i;
+		}
+	}
+
+	// Depth first from each root, keeping roots and siblings in their current order. An entry
+	// whose parent was released becomes a root.
+	std::vector<uint32_t> order;
+	order.reserve(size());
+	std::vector<uint32_t> newEntry(count, NO_ENTRY);
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < count; root++) {
+		if (!isLive(root) || isLive(m_parents[root])) {
+			continue;
+		}
+		stack.push_back(root);
+		while (!stack.empty()) {
+			uint32_t entry = stack.back();
+			stack.pop_back();
+			newEntry[entry] = static_cast<uint32_t>(order.size());
+			order.push_back(entry);
+			for (uint32_t c = childStart[entry + 1]; c > childStart[entry]; c--) {
+				stack.push_back(children[c - 1]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> parents(order.size());
+	std::vector<LocalTransform> locals(order.size());
+	std::vector<glm::mat4> baseTransforms(order.size());
+	std::vector<glm::mat4> localMatrices(order.size());
+	std::vector<uint8_t> localDirty(order.size());
+	std::vector<glm::mat4> worldMatrices(order.size());
+	std::vector<Handle> handles(order.size());
+	std::vector<uint8_t> worldDirty(order.size());
+	std::vector<uint8_t> boundsDirty(order.size());
+	m_dirtyEntries.clear();
+	for (uint32_t i = 0; i < order.size(); i++) {
+		uint32_t from = order[i];
+		uint32_t parent = m_parents[from];
+		parents[i] = isLive(parent) ? newEntry[parent] : NO_ENTRY;
+		locals[i] = m_locals[from];
+		baseTransforms[i] = m_baseTransforms[from];
+		localMatrices[i] = m_localMatrices[from];
+		localDirty[i] = m_localDirty[from];
+		worldMatrices[i] = m_worldMatrices[from];
+		handles[i] = m_handles[from];
+		boundsDirty[i] = m_boundsDirty[from];
+		m_entries[handles[i]] = i;
+		// A node whose parent was released is now a root, and its world matrix changes.
+		worldDirty[i] = m_worldDirty[from] || (parent != NO_ENTRY && parents[i] == NO_ENTRY);
+		if (worldDirty[i]) {
+			m_dirtyEntries.push_back(i);
+		}
+	}
+
+	// Each subtree ends where the last of its children's subtrees does.
+	std::vector<uint32_t> subtreeEnds(order.size());
+	for (uint32_t i = 0; i < order.size(); i++) {
+		subtreeEnds[i] = i + 1;
+	}
+	for (uint32_t i = static_cast<uint32_t>(order.size()); i-- > 0;) {
+		if (parents[i] != NO_ENTRY) {
+			subtreeEnds[parents[i]] = std::max(subtreeEnds[parents[i]], subtreeEnds[i]);
+		}
+	}
+
+	m_parents = std::move(parents);
+	m_locals = std::move(locals);
+	m_baseTransforms = std::move(baseTransforms);
+	m_localMatrices = std::move(localMatrices);
+	m_localDirty = std::move(localDirty);
+	m_worldMatrices = std::move(worldMatrices);
+	m_subtreeEnds = std::move(subtreeEnds);
+	m_handles = std::move(handles);
+	m_worldDirty = std::move(worldDirty);
+	m_boundsDirty = std::move(boundsDirty);
+	m_orderDirty = false;
+}
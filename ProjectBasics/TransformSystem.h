@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * @brief Stores the transforms of every Object3D in the process in flat, parallel arrays: the
+ * parent, the local position/orientation/scale, the local matrix and the world matrix of each
+ * node. The arrays are kept in hierarchy order, every parent before its children, so update()
+ * computes all world matrices in one forward pass in which each parent's world matrix is already
+ * final when its children read it.
+ *
+ * Nodes are named by handles, which stay valid while the arrays are reordered. Creating,
+ * releasing and reparenting nodes is cheap; the arrays are compacted and put back into hierarchy
+ * order, depth first so that each subtree is contiguous, by the next update().
+ *
+ * Matrices are rebuilt lazily. Editing a node's local transform only marks it dirty, however many
+ * times it happens, and update() visits only the subtrees under dirty nodes: it rebuilds each
+ * dirty node's local matrix once and the world matrices below it. Nodes that did not move, like
+ * static props, cost nothing per frame.
+ *
+ * Like the other global() systems, it is used only from the thread that owns the OpenGL context.
+ */
+class TransformSystem {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle NULL_HANDLE = UINT32_MAX;
+
+	/**
+	 * @brief A node's transform relative to its parent, applied as Object3D documents: scale and
+	 * rotate around the center, then translate by the position, all after the node's base
+	 * transform.
+	 *
+	 * The rotation is the quaternion; orientation holds the same rotation as Euler angles, in
+	 * radians, composed as rotations about z, then x, then y. Whoever edits one updates the other.
+	 */
+	struct LocalTransform {
+		glm::vec3 position;
+		glm::vec3 orientation;
+		glm::quat rotation;
+		glm::vec3 scale;
+		glm::vec3 center;
+	};
+
+	struct Stats {
+		// Local matrices rebuilt, and world matrices recomputed, by the last update().
+		size_t localRebuilds;
+		size_t worldUpdates;
+	};
+
+private:
+	// Stands for a missing entry: the parent of a root, or the entry of a free handle.
+	static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+	// One entry per node, in hierarchy order. Released nodes keep their entries, with a null
+	// handle, until the next reorder.
+	std::vector<uint32_t> m_parents;
+	std::vector<LocalTransform> m_locals;
+	std::vector<glm::mat4> m_baseTransforms;
+	// Rebuilt on demand by localMatrix() as well as by update(), hence mutable.
+	mutable std::vector<glm::mat4> m_localMatrices;
+	mutable std::vector<uint8_t> m_localDirty;
+	std::vector<glm::mat4> m_worldMatrices;
+	// One past the last entry of each node's subtree.
+	std::vector<uint32_t> m_subtreeEnds;
+	std::vector<Handle> m_handles;
+
+	// Entries whose subtrees need new world matrices, and whether each entry is listed.
+	std::vector<uint32_t> m_dirtyEntries;
+	std::vector<uint8_t> m_worldDirty;
+	// Whether bounds cached over each entry's subtree are out of date. Every ancestor of a marked
+	// entry is marked too, so marking can stop at the first entry that already is.
+	std::vector<uint8_t> m_boundsDirty;
+	Stats m_stats;
+
+	// The entry of each handle, and the handles free for reuse.
+	std::vector<uint32_t> m_entries;
+	std::vector<Handle> m_freeHandles;
+	// Whether an entry may now come before its parent, or a released entry awaits compaction.
+	bool m_orderDirty;
+
+	/**
+	 * @brief Drops released entries and sorts the rest depth first, parents before children.
+	 */
+	void reorder();
+	void markWorldDirty(uint32_t entry);
+	void markBoundsDirty(uint32_t entry);
+	void rebuildLocalEntry(uint32_t entry) const;
+
+public:
+	TransformSystem();
+
+	TransformSystem(const TransformSystem&) = delete;
+	TransformSystem& operator=(const TransformSystem&) = delete;
+
+	/**
+	 * @brief The system shared by the whole process.
+	 */
+	static TransformSystem& global();
+
+	/**
+	 * @brief The matrix a local transform and base transform combine into, built in closed form
+	 * from the quaternion, the scale and the pivot, without trigonometry or intermediate matrices.
+	 */
+	static glm::mat4 composeLocal(const LocalTransform& local, const glm::mat4& baseTransform);
+
+	/**
+	 * @brief Converts between Euler angles, in LocalTransform's order, and a unit quaternion.
+	 */
+	static glm::quat eulerToQuat(const glm::vec3& orientation);
+	static glm::vec3 quatToEuler(const glm::quat& rotation);
+
+	/**
+	 * @brief Adds a root node at the origin with unit scale and the given base transform.
+	 */
+	Handle create(const glm::mat4& baseTransform);
+	/**
+	 * @brief Adds a root node with the same local transform as an existing one.
+	 */
+	Handle clone(Handle source);
+	void release(Handle node);
+
+	/**
+	 * @brief Attaches the node under a new parent, or makes it a root for NULL_HANDLE. Its world
+	 * matrix reflects the change after the next update(), which also reorders the arrays.
+	 */
+	void setParent(Handle node, Handle parent);
+	Handle parent(Handle node) const;
+
+	const LocalTransform& local(Handle node) const { return m_locals[m_entries[node]]; }
+	/**
+	 * @brief The node's local transform, for editing in place; call markDirty() afterward.
+	 */
+	LocalTransform& local(Handle node) { return m_locals[m_entries[node]]; }
+	/**
+	 * @brief Notes that the node's local transform changed, so that its local matrix and the
+	 * world matrices of its subtree are rebuilt when next needed.
+	 */
+	void markDirty(Handle node);
+
+	/**
+	 * @brief Whether the node's subtree changed since clearBoundsDirty(): a descendant was attached
+	 * or released, or its local transform edited. Bounds cached over the subtree, like Object3D's,
+	 * are then out of date.
+	 */
+	bool boundsDirty(Handle node) const { return m_boundsDirty[m_entries[node]] != 0; }
+	void clearBoundsDirty(Handle node) { m_boundsDirty[m_entries[node]] = 0; }
+
+	/**
+	 * @brief The node's local matrix, rebuilt first if its local transform changed.
+	 */
+	const glm::mat4& localMatrix(Handle node) const;
+	/**
+	 * @brief The node's local->world matrix as of the last update().
+	 */
+	const glm::mat4& worldMatrix(Handle node) const { return m_worldMatrices[m_entries[node]]; }
+
+	/**
+	 * @brief Recomputes the world matrices of the subtrees under nodes marked dirty since the last
+	 * update, each in one linear pass over its contiguous entries.
+	 */
+	void update();
+
+	/**
+	 * @brief Counters for the last update().
+	 */
+	Stats stats() const { return m_stats; }
+
+	/**
+	 * @brief How many nodes exist.
+	 */
+	size_t size() const { return m_entries.size() - m_freeHandles.size(); }
+};
@@ -5,11 +5,11 @@ class TranslationAnimation : public Animation {
 private:
 	glm::vec3 m_translation;
 
-	void applyAnimation(float_t dt) override {
-		object().move(m_translation * dt);
+	void applyAnimation(Object3D& object, float_t dt) override {
+		object.move(m_translation * dt);
 	}
 public:
-	TranslationAnimation(Object3D& object, float_t duration, 
+	TranslationAnimation(ObjectRef object, float_t duration, 
 		const glm::vec3& totalMovement) :
-		Animation(object, duration), m_translation(totalMovement / duration) {}
+		Animation(std::move(object), duration), m_translation(totalMovement / duration) {}
 };
@@ -0,0 +1,69 @@
+#include "UniformBlocks.h"
+#include "GLStateCache.h"
+#include <glad/glad.h>
+
+ObjectConstants ObjectConstants::compute(const glm::mat4& model, const glm::mat4& viewProjection) {
+	return ObjectConstants{ model, viewProjection * model, glm::transpose(glm::inverse(model)) };
+}
+
+UniformBlocks::UniformBlocks(size_t objectCapacity)
+	: m_frameBuffer(), m_objectBuffer(), m_objectStride(0), m_objectCapacity(objectCapacity), m_nextObject(0),
+	m_frame() {}
+
+UniformBlocks& UniformBlocks::global() {
+	static UniformBlocks blocks;
+	return blocks;
+}
+
+void UniformBlocks::createBuffers() {
+	auto& state = GLStateCache::global();
+	m_frameBuffer = GLBuffer::generate();
+	state.bindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer.id());
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+
+	int32_t alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, 1);
+	m_objectStride = (sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+	m_objectBuffer = GLBuffer::generate();
+	state.bindBuffer(GL_UNIFORM_BUFFER, m_objectBuffer.id());
+	glBufferData(GL_UNIFORM_BUFFER, m_objectCapacity * m_objectStride, nullptr, GL_STREAM_DRAW);
+}
+
+void UniformBlocks::setFrame(const FrameConstants& frame) {
+	if (!m_frameBuffer) {
+		createBuffers();
+	}
+	m_frame = frame;
+	m_frame.viewProjection = frame.projection * frame.view;
+
+	auto& state = GLStateCache::global();
+	state.bindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer.id());
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &m_frame);
+	state.bindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_frameBuffer.id(), 0, sizeof(FrameConstants));
+}
+
+void UniformBlocks::bindObject(const glm::mat4& model) {
+	if (!m_objectBuffer) {
+		createBuffers();
+	}
+	auto& state = GLStateCache::global();
+	state.bindBuffer(GL_UNIFORM_BUFFER, m_objectBuffer.id());
+	if (m_nextObject == m_objectCapacity) {
+		// Every slot has been used since the last orphaning; get fresh storage rather than wait
+		// for draws that may still read the old one.
+		glBufferData(GL_UNIFORM_BUFFER, m_objectCapacity * m_objectStride, nullptr, GL_STREAM_DRAW);
+		m_nextObject = 0;
+	}
+
+	auto constants = ObjectConstants::compute(model, m_frame.viewProjection);
+	size_t offset = m_nextObject++ * m_objectStride;
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(ObjectConstants), &constants);
+	state.bindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, m_objectBuffer.id(), offset, sizeof(ObjectConstants));
+}
+
+void UniformBlocks::clear() {
+	m_frameBuffer.reset();
+	m_objectBuffer.reset();
+	m_nextObject = 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "GLObject.h"
+
+/**
+ * Uniform blocks shared by every shader program. ShaderProgram::load binds a program's
+ * "FrameBlock" and "ObjectBlock" to these binding points, so data uploaded once reaches every
+ * program that declares the block.
+ */
+const uint32_t FRAME_BLOCK_BINDING = 0;
+const uint32_t OBJECT_BLOCK_BINDING = 1;
+
+/**
+ * @brief The std140 layout of FrameBlock: constants for a whole frame, set once before drawing.
+ * The shaders' declarations of the block must match this member for member. A vec3 takes 16
+ * bytes, so a float may follow it in the same 16.
+ */
+struct FrameConstants {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 viewPos;
+	float_t padding0;
+	glm::vec3 ambientColor;
+	float_t padding1;
+	// The "I" vector of the directional light, not the "L" vector.
+	glm::vec3 directionalLight;
+	float_t padding2;
+	glm::vec3 directionalColor;
+	float_t padding3;
+	glm::vec3 spotLightPos;
+	float_t spotLightCutOff;
+	glm::vec3 spotLightDir;
+	float_t spotLightOuterCutOff;
+	glm::vec3 spotLightColor;
+	float_t spotLightAmbient;
+	float_t spotLightDiffuse;
+	float_t spotLightSpecular;
+	float_t padding4[2];
+};
+static_assert(sizeof(FrameConstants) == 320, "FrameConstants must match the std140 layout of FrameBlock");
+
+/**
+ * @brief The std140 layout of ObjectBlock, and of one instance in a RenderQueue instance buffer:
+ * an object's transforms, computed once on the CPU instead of once per vertex.
+ */
+struct ObjectConstants {
+	glm::mat4 model;
+	glm::mat4 modelViewProjection;
+	// The inverse transpose of the model matrix. Shaders use its upper 3x3; a mat3 would pad each
+	// column to 16 bytes in std140 anyway.
+	glm::mat4 normalMatrix;
+
+	static ObjectConstants compute(const glm::mat4& model, const glm::mat4& viewProjection);
+};
+static_assert(sizeof(ObjectConstants) == 192, "ObjectConstants must match the std140 layout of ObjectBlock");
+
+/**
+ * @brief Owns the buffers behind FrameBlock and ObjectBlock. Per-object constants go into a ring
+ * buffer: each bindObject() writes the next slot and binds that range, and the buffer is orphaned
+ * when the ring wraps, so a slot is never overwritten while a draw may still read it.
+ */
+class UniformBlocks {
+private:
+	GLBuffer m_frameBuffer;
+	GLBuffer m_objectBuffer;
+	// Bytes between ring slots: ObjectConstants rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	size_t m_objectStride;
+	size_t m_objectCapacity;
+	size_t m_nextObject;
+	FrameConstants m_frame;
+
+	void createBuffers();
+
+public:
+	explicit UniformBlocks(size_t objectCapacity = 4096);
+
+	UniformBlocks(const UniformBlocks&) = delete;
+	UniformBlocks& operator=(const UniformBlocks&) = delete;
+
+	/**
+	 * @brief The blocks shared by the whole process.
+	 */
+	static UniformBlocks& global();
+
+	/**
+	 * @brief Uploads the frame constants, filling in viewProjection, and binds them to
+	 * FRAME_BLOCK_BINDING.
+	 */
+	void setFrame(const FrameConstants& frame);
+	const FrameConstants& frame() const { return m_frame; }
+
+	/**
+	 * @brief Writes the constants for an object with the given model matrix, seen through the
+	 * current frame, into the ring and binds them to OBJECT_BLOCK_BINDING for the next draw.
+	 */
+	void bindObject(const glm::mat4& model);
+
+	/**
+	 * @brief Deletes the buffers. Must be called while the OpenGL context still exists.
+	 */
+	void clear();
+};
@@ -0,0 +1,68 @@
+#include "VertexPacking.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+
+namespace {
+	glm::vec2 signNotZero(glm::vec2 v) {
+		return glm::vec2(v.x >= 0 ? 1.0f : -1.0f, v.y >= 0 ? 1.0f : -1.0f);
+	}
+}
+
+glm::vec2 octahedralEncode(glm::vec3 normal) {
+	float_t length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (length == 0) {
+		return glm::vec2(0, 0);
+	}
+	normal /= length;
+	glm::vec2 encoded(normal.x, normal.y);
+	// Fold the lower hemisphere over the diagonals of the square.
+	if (normal.z < 0) {
+		encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+	}
+	return encoded;
+}
+
+glm::vec3 octahedralDecode(glm::vec2 encoded) {
+	glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	float_t fold = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0 ? -fold : fold;
+	normal.y += normal.y >= 0 ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+PackedBounds packVertices(const Vertex3D* vertices, size_t vertexCount, std::vector<PackedVertex3D>& packed) {
+	glm::vec3 lower(0), upper(0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		glm::vec3 position(vertices[i].x, vertices[i].y, vertices[i].z);
+		lower = i == 0 ? position : glm::min(lower, position);
+		upper = i == 0 ? position : glm::max(upper, position);
+	}
+	PackedBounds bounds{ lower, upper - lower };
+
+	packed.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		auto& vertex = vertices[i];
+		glm::vec3 position(vertex.x, vertex.y, vertex.z);
+		// A flat axis (e.g. the z of a square) has zero extent; every vertex sits at its offset.
+		glm::vec3 unorm = glm::vec3(
+			bounds.scale.x > 0 ? (position.x - lower.x) / bounds.scale.x : 0,
+			bounds.scale.y > 0 ? (position.y - lower.y) / bounds.scale.y : 0,
+			bounds.scale.z > 0 ? (position.z - lower.z) / bounds.scale.z : 0);
+		glm::vec2 normal = octahedralEncode(glm::vec3(vertex.nx, vertex.ny, vertex.nz));
+
+		packed[i] = PackedVertex3D{
+			glm::packUnorm1x16(unorm.x), glm::packUnorm1x16(unorm.y), glm::packUnorm1x16(unorm.z), 0,
+			glm::packSnorm1x16(normal.x), glm::packSnorm1x16(normal.y),
+			glm::packHalf1x16(vertex.u), glm::packHalf1x16(vertex.v),
+		};
+	}
+	return bounds;
+}
+
+Vertex3D unpackVertex(const PackedVertex3D& vertex, const PackedBounds& bounds) {
+	glm::vec3 position = bounds.offset + glm::vec3(glm::unpackUnorm1x16(vertex.x), glm::unpackUnorm1x16(vertex.y),
+		glm::unpackUnorm1x16(vertex.z)) * bounds.scale;
+	glm::vec3 normal = octahedralDecode(glm::vec2(glm::unpackSnorm1x16(vertex.nx), glm::unpackSnorm1x16(vertex.ny)));
+	return Vertex3D(position.x, position.y, position.z, normal.x, normal.y, normal.z,
+		glm::unpackHalf1x16(vertex.u), glm::unpackHalf1x16(vertex.v));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh3D.h"
+
+/**
+ * @brief A Vertex3D quantized to half its size, for VertexFormat::Packed meshes.
+ */
+struct PackedVertex3D {
+	// Position within the mesh's bounds, as unorm16. w is padding that keeps vertices 8-byte aligned.
+	uint16_t x;
+	uint16_t y;
+	uint16_t z;
+	uint16_t w;
+
+	// Octahedral-encoded unit normal, as snorm16 bit patterns.
+	uint16_t nx;
+	uint16_t ny;
+
+	// Texture coordinates, as half floats. Precision falls off away from [0, 1], so heavily
+	// tiled UVs (say, beyond +-64) are better left in VertexFormat::Float.
+	uint16_t u;
+	uint16_t v;
+};
+
+static_assert(sizeof(PackedVertex3D) == 16, "PackedVertex3D must be half the size of Vertex3D");
+
+/**
+ * @brief Maps unorm16 positions back into model space: position = offset + unorm * scale.
+ */
+struct PackedBounds {
+	glm::vec3 offset;
+	glm::vec3 scale;
+};
+
+/**
+ * @brief Maps a unit vector to a point in [-1, 1]^2 on the unfolded octahedron.
+ */
+glm::vec2 octahedralEncode(glm::vec3 normal);
+
+/**
+ * @brief The inverse of octahedralEncode. The vertex shaders contain the same function.
+ */
+glm::vec3 octahedralDecode(glm::vec2 encoded);
+
+/**
+ * @brief Quantizes vertices into packed, and returns the bounds their positions are relative to.
+ */
+PackedBounds packVertices(const Vertex3D* vertices, size_t vertexCount, std::vector<PackedVertex3D>& packed);
+
+/**
+ * @brief Expands a packed vertex back to floats, as the vertex shader sees it.
+ */
+Vertex3D unpackVertex(const PackedVertex3D& vertex, const PackedBounds& bounds);
@@ -0,0 +1,122 @@
+#define GLM_FORCE_INLINE
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_relational.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <BatchMath.h>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+// Times ProjectBasics' BatchMath kernels on every path the CPU supports, and checks each path
+// against the scalar reference: model-view-projection matrices, world matrices propagated down a
+// hierarchy, and normal matrices.
+
+static std::uint32_t const NoParent = 0xFFFFFFFF;
+
+static glm::mat4 sample_matrix(std::size_t i)
+{
+	float const t = static_cast<float>(i % 1000) * 0.001f;
+	glm::mat4 M = glm::translate(glm::mat4(1), glm::vec3(t, -t, 0.5f * t));
+	M = glm::rotate(M, t * 7.0f, glm::normalize(glm::vec3(1.0f, t, 2.0f)));
+	return glm::scale(M, glm::vec3(1.0f + static_cast<float>(i % 3) * 0.25f, 1.0f, 0.75f));
+}
+
+// Each kernel runs repeatedly over arrays that fit in cache, so that the timings show arithmetic
+// throughput rather than memory bandwidth.
+static std::size_t const Repeats = 100;
+
+template <typename kernel>
+static int launch(kernel const& Kernel)
+{
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	for (std::size_t r = 0; r < Repeats; ++r)
+		Kernel();
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count());
+}
+
+static int count_errors(std::vector<glm::mat4> const& Reference, std::vector<glm::mat4> const& O)
+{
+	int Error = 0;
+	for (std::size_t i = 0, n = Reference.size(); i < n; ++i)
+		Error += glm::all(glm::equal(Reference[i], O[i], 0.001f)) ? 0 : 1;
+	return Error;
+}
+
+static int comp_batch(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::mat4> I(Samples);
+	std::vector<std::uint32_t> Parents(Samples);
+	for (std::size_t i = 0; i < Samples; ++i)
+	{
+		I[i] = sample_matrix(i);
+		// Trees of 64 nodes, each parent before its children.
+		Parents[i] = i % 64 == 0 ? NoParent : static_cast<std::uint32_t>(i / 64 * 64 + (i % 64) / 2);
+	}
+	glm::mat4 const ViewProjection = glm::perspective(0.8f, 1.5f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(3, 4, 5), glm::vec3(0), glm::vec3(0, 1, 0));
+
+	BatchMath& Batch = BatchMath::global();
+	std::vector<glm::mat4> MultiplyReference, PropagateReference, NormalReference;
+	BatchMath::Path const Paths[] = {BatchMath::Path::Scalar, BatchMath::Path::SSE41, BatchMath::Path::AVX2, BatchMath::Path::AVX512};
+	for (BatchMath::Path const Path : Paths)
+	{
+		if (!Batch.supports(Path))
+		{
+			std::printf("%s: not supported\n", BatchMath::name(Path));
+			continue;
+		}
+		Batch.setPath(Path);
+		std::printf("%s:\n", BatchMath::name(Path));
+
+		std::vector<glm::mat4> Multiply(Samples);
+		std::printf("- mat4 * mat4[]: %d us\n", launch([&]() { Batch.multiply(ViewProjection, I.data(), Multiply.data(), Samples); }));
+
+		std::vector<glm::mat4> Propagate(Samples);
+		std::printf("- propagate: %d us\n", launch([&]() { Batch.propagate(Parents.data(), I.data(), Propagate.data(), 0, Samples, NoParent); }));
+
+		std::vector<glm::mat4> Normal(Samples);
+		std::printf("- normal matrices: %d us\n", launch([&]() { Batch.normalMatrices(I.data(), Normal.data(), Samples); }));
+
+		if (Path == BatchMath::Path::Scalar)
+		{
+			MultiplyReference.swap(Multiply);
+			PropagateReference.swap(Propagate);
+			NormalReference.swap(Normal);
+			continue;
+		}
+		Error += count_errors(MultiplyReference, Multiply);
+		Error += count_errors(PropagateReference, Propagate);
+		Error += count_errors(NormalReference, Normal);
+	}
+
+	// Results in place, as the render queue does not do but callers may.
+	std::vector<glm::mat4> InPlace(I);
+	Batch.multiply(ViewProjection, InPlace.data(), InPlace.data(), Samples);
+	Error += count_errors(MultiplyReference, InPlace);
+
+	// An odd count exercises the kernels' remainders.
+	std::vector<glm::mat4> Tail(3);
+	Batch.normalMatrices(I.data(), Tail.data(), Tail.size());
+	for (std::size_t i = 0; i < Tail.size(); ++i)
+		Error += glm::all(glm::equal(Tail[i], glm::mat4(glm::transpose(glm::inverse(glm::mat3(I[i])))), 0.001f)) ? 0 : 1;
+
+	return Error;
+}
+
+int main()
+{
+	std::size_t const Samples = 4097;
+
+	int Error = 0;
+
+	std::printf("Batch matrix kernels:\n");
+	Error += comp_batch(Samples);
+
+	return Error;
+}
@@ -0,0 +1,106 @@
+#define GLM_FORCE_INLINE
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_relational.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+// Builds a model matrix from a translation, a rotation and a scale about a pivot, the way
+// ProjectBasics' TransformSystem::composeLocal does: from Euler angles with successive
+// translate/rotate/scale calls, and in closed form from a quaternion.
+
+struct trs
+{
+	glm::vec3 Position;
+	glm::vec3 Orientation;
+	glm::quat Rotation;
+	glm::vec3 Scale;
+	glm::vec3 Center;
+};
+
+static glm::mat4 euler_trs(trs const& T)
+{
+	glm::mat4 M = glm::translate(glm::mat4(1), T.Position);
+	M = glm::translate(M, T.Center * T.Scale);
+	M = glm::rotate(M, T.Orientation.z, glm::vec3(0, 0, 1));
+	M = glm::rotate(M, T.Orientation.x, glm::vec3(1, 0, 0));
+	M = glm::rotate(M, T.Orientation.y, glm::vec3(0, 1, 0));
+	M = glm::scale(M, T.Scale);
+	return glm::translate(M, -T.Center);
+}
+
+static glm::mat4 closed_form_trs(trs const& T)
+{
+	glm::quat const& q = T.Rotation;
+	float const xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float const xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float const wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	glm::vec3 const& s = T.Scale;
+	glm::mat4 M(
+		(1 - 2 * (yy + zz)) * s.x, 2 * (xy + wz) * s.x, 2 * (xz - wy) * s.x, 0,
+		2 * (xy - wz) * s.y, (1 - 2 * (xx + zz)) * s.y, 2 * (yz + wx) * s.y, 0,
+		2 * (xz + wy) * s.z, 2 * (yz - wx) * s.z, (1 - 2 * (xx + yy)) * s.z, 0,
+		0, 0, 0, 1);
+	glm::vec3 const& c = T.Center;
+	glm::vec3 const RotatedCenter = glm::vec3(M[0]) * c.x + glm::vec3(M[1]) * c.y + glm::vec3(M[2]) * c.z;
+	M[3] = glm::vec4(T.Position + c * s - RotatedCenter, 1);
+	return M;
+}
+
+template <glm::mat4 (*build)(trs const&)>
+static int launch_trs(std::vector<trs> const& I, std::vector<glm::mat4>& O)
+{
+	O.resize(I.size());
+
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0, n = I.size(); i < n; ++i)
+		O[i] = build(I[i]);
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count());
+}
+
+static int comp_trs(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<trs> I(Samples);
+	for (std::size_t i = 0; i < Samples; ++i)
+	{
+		float const t = static_cast<float>(i) * 0.001f;
+		trs& T = I[i];
+		T.Position = glm::vec3(t, -t, 2 * t);
+		T.Orientation = glm::vec3(t * 3.0f, t * 5.0f, t * 7.0f);
+		T.Rotation = glm::angleAxis(T.Orientation.z, glm::vec3(0, 0, 1))
+			* glm::angleAxis(T.Orientation.x, glm::vec3(1, 0, 0))
+			* glm::angleAxis(T.Orientation.y, glm::vec3(0, 1, 0));
+		T.Scale = glm::vec3(1.0f + static_cast<float>(i % 3) * 0.5f, 1.0f, 0.5f);
+		T.Center = glm::vec3(0.5f, -0.25f, 1.0f);
+	}
+
+	std::vector<glm::mat4> Euler;
+	std::printf("- Euler angles, translate/rotate/scale: %d us\n", launch_trs<euler_trs>(I, Euler));
+
+	std::vector<glm::mat4> ClosedForm;
+	std::printf("- Quaternion, closed form: %d us\n", launch_trs<closed_form_trs>(I, ClosedForm));
+
+	for (std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Euler[i], ClosedForm[i], 0.001f)) ? 0 : 1;
+
+	return Error;
+}
+
+int main()
+{
+	std::size_t const Samples = 1000000;
+
+	int Error = 0;
+
+	std::printf("TRS with pivot -> mat4:\n");
+	Error += comp_trs(Samples);
+
+	return Error;
+}
@@ -9,9 +9,23 @@ This application renders a textured mesh that was loaded with Assimp.
 #include "Mesh3D.h"
 #include "Object3D.h"
 #include "AssimpImport.h"
+#include "ModelCache.h"
+#include "AssetLoader.h"
+#include "GLStateCache.h"
+#include "MultiDrawIndirect.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
 #include "Animator.h"
+#include "BoundingVolumeTree.h"
+#include "OcclusionCuller.h"
+#include "TransformSystem.h"
+#include "ObjectStore.h"
+#include "Scene.h"
 #include "ShaderProgram.h"
 #include <unordered_set>
+#include <algorithm>
 #include <glm/gtx/string_cast.hpp>
 #include <SFML/Audio.hpp> 
 
@@ -42,13 +56,14 @@ bool isBirdInMotion(const glm::vec3& velocity, float threshold = 0.3f) {
 }
 
 /**
- * @brief Defines a collection of objects that should be rendered with a specific shader program.
+ * @brief A store holding the given objects, moved into it in order.
  */
-struct Scene {
-	ShaderProgram defaultShader;
-	std::vector<Object3D> objects;
-	std::vector<Animator> animators;
-};
+template <typename... Objects>
+ObjectStore storeOf(Objects&&... objects) {
+	ObjectStore store;
+	(store.insert(std::move(objects)), ...);
+	return store;
+}
 
 /**
  * @brief Constructs a shader program that renders textured meshes in the Phong reflection model.
@@ -67,6 +82,22 @@ ShaderProgram phongLighting() {
 	return program;
 }
 
+/**
+ * @brief Like phongLighting, for drawing through a RenderQueue: the transforms come from the
+ * instance buffer rather than the ObjectBlock.
+ */
+ShaderProgram phongLightingInstanced() {
+	ShaderProgram program;
+	try {
+		program.load("shaders/light_perspective_instanced.vert", "shaders/lighting.frag");
+	}
+	catch (std::runtime_error& e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		exit(1);
+	}
+	return program;
+}
+
 /**
  * @brief Constructs a shader program that renders textured meshes without lighting.
  */
@@ -83,12 +114,19 @@ ShaderProgram textureMapping() {
 }
 
 /**
- * @brief Loads an image from the given path into an OpenGL texture.
+ * @brief Loads an image from the given path into an OpenGL texture, sharing it with any other
+ * user of the same image.
  */
 Texture loadTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture") {
-	sf::Image i;
-	i.loadFromFile(path.string());
-	return Texture::loadImage(i, samplerName);
+	return TextureRegistry::global().acquire(path, samplerName);
+}
+
+/**
+ * @brief Like loadTexture, for large images: the texture starts blurry and sharpens over the next
+ * frames as TextureStreamer::global().update() uploads its larger mips.
+ */
+Texture streamTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture") {
+	return TextureRegistry::global().acquireStreamed(path, samplerName);
 }
 
 /**
@@ -100,7 +138,7 @@ Scene skipper() { //works lmao
 
 	return Scene{
 		phongLighting(),
-		{skipper}
+		storeOf(std::move(skipper))
 	};
 }
 
@@ -113,13 +151,13 @@ Scene Ground() { // works !
 	// load in texture
 	auto grass_texture = loadTexture("textures/grass-texture-seamless/153_artificial green grass texture-seamless.jpg");
 	std::vector<Texture> textures; 
-	textures.push_back(grass_texture); // into vector for square
+	textures.push_back(std::move(grass_texture)); // into vector for square
 
 	//auto grass_mesh = Mesh3D::triangle(grass_texture);
 	auto grass_mesh = Mesh3D::square(textures);
 
 	std::vector<Mesh3D> meshes; 
-	meshes.push_back(grass_mesh);
+	meshes.push_back(std::move(grass_mesh));
 
 	auto ground = Object3D(std::move(meshes));
 	ground.rotate(glm::vec3(M_PI/2,0, 0));
@@ -128,7 +166,7 @@ Scene Ground() { // works !
 
 	return Scene{
 		phongLighting(),
-		{ground}
+		storeOf(std::move(ground))
 	};
 }
 
@@ -144,7 +182,7 @@ Scene WoodPallet() { // works!
 
 	return Scene{
 		phongLighting(),
-		{pallet}
+		storeOf(std::move(pallet))
 	};
 }
 
@@ -160,7 +198,7 @@ Scene Slingshot() { // works!
 
 	return Scene{
 		phongLighting(),
-		{slingshot}
+		storeOf(std::move(slingshot))
 	};
 }
 
@@ -176,7 +214,7 @@ Scene Pig() { // works !
 
 	return Scene{
 		phongLighting(),
-		{pig}
+		storeOf(std::move(pig))
 	};
 }
 
@@ -192,7 +230,7 @@ Scene RedBird() { // works !
 
 	return Scene{
 		phongLighting(),
-		{redBird}
+		storeOf(std::move(redBird))
 	};
 }
 
@@ -207,21 +245,21 @@ Scene Crate() { // test adding texture to object
 
 	return Scene{
 		textureMapping(),
-		{crate}
+		storeOf(std::move(crate))
 	};
 }
 
 Object3D touchGrass() {
 
 	//auto grass_texture = loadTexture("textures/sky.png"); // does sky png work - yes 
-	auto grass_texture = loadTexture("textures/grass-texture-seamless/153_artificial green grass texture-seamless.jpg");
+	auto grass_texture = streamTexture("textures/grass-texture-seamless/153_artificial green grass texture-seamless.jpg");
 	std::vector<Texture> textures;
-	textures.push_back(grass_texture); // into vector for square
+	textures.push_back(std::move(grass_texture)); // into vector for square
 
 	auto grass_mesh = Mesh3D::square(textures);
 
 	std::vector<Mesh3D> meshes;
-	meshes.push_back(grass_mesh);
+	meshes.push_back(std::move(grass_mesh));
 
 	auto ground = Object3D(std::move(meshes));
 
@@ -229,123 +267,168 @@ Object3D touchGrass() {
 }
 
 Object3D iCanTouchTheSky() {
-	auto sky_texture = loadTexture("textures/sky.png");
+	auto sky_texture = streamTexture("textures/sky.png");
 	std::vector<Texture> textures;
-	textures.push_back(sky_texture); // into vector for rectangle 
+	textures.push_back(std::move(sky_texture)); // into vector for rectangle 
 
 	auto sky_mesh = Mesh3D::square(textures);
 
 	std::vector<Mesh3D> meshes;
-	meshes.push_back(sky_mesh);
+	meshes.push_back(std::move(sky_mesh));
 
 	auto sky = Object3D(std::move(meshes));
 
 	return sky; 
 }
 
+/**
+ * @brief The props in testScene() are dense meshes viewed from a distance, so they use the
+ * half-size vertex format.
+ */
+const VertexFormat TEST_SCENE_VERTEX_FORMAT = VertexFormat::Packed;
+
+/**
+ * @brief The same props shrink to a few pixels as the camera pulls back, so each gets a chain of
+ * simplified meshes for the renderer to switch to.
+ */
+const LodSettings TEST_SCENE_LODS = LodSettings::standard();
+
+/**
+ * @brief Every model file testScene() loads, so they can be imported before it runs.
+ */
+const std::vector<std::string> TEST_SCENE_MODELS = {
+	"models/wood_pallet/scene.gltf",
+	"models/hiberworld_minion_pig/scene.gltf",
+	"models/angry_bird_red/scene.gltf",
+	"models/scout_slingshot_from_secret_neighbor/scene.gltf",
+	"models/egg/scene.gltf",
+};
+
+/**
+ * @brief How many bytes of streamed texture data to upload each frame. A 2048x2048 texture and
+ * its mips take about ten frames.
+ */
+const size_t TEXTURE_STREAMING_BYTES_PER_FRAME = 2 * 1024 * 1024;
+
+/**
+ * @brief An occluder for a solid, box-like object: its bounds, shrunk by the given fraction
+ * around their center so that the box stays inside the object's real geometry.
+ */
+std::vector<glm::vec3> boxOccluder(const Object3D& object, float_t shrink) {
+	auto& bounds = object.getLocalBounds();
+	glm::vec3 extent = bounds.extent() * (1 - shrink);
+	return OcclusionCuller::boxTriangles(BoundingBox(bounds.center() - extent, bounds.center() + extent));
+}
+
 Scene testScene() {
 
+	// Repeated objects are copies of one prototype, so that they share a mesh and draw as
+	// instances of it.
+	auto skyPrototype = iCanTouchTheSky();
+	auto groundPrototype = touchGrass();
+	groundPrototype.setOccluder(boxOccluder(groundPrototype, 0));
+
 	// Needs a background eventually *** 
-	auto sky1 = iCanTouchTheSky();
+	auto sky1 = skyPrototype;
 	//sky.rotate();
 	//sky.rotate(glm::vec3(M_PI / 2, 0, 0)); 
 	sky1.move(glm::vec3(-40, 12, -9.5));
 	sky1.grow(glm::vec3(60, 40, 40)); 
 
-	auto sky2 = iCanTouchTheSky();
+	auto sky2 = skyPrototype;
 	sky2.move(glm::vec3(20, 12, -9.5));
 	sky2.grow(glm::vec3(60, 40, 40));
 
 
 	// grass ground  ===================================================================
  
-	auto ground1 = touchGrass();
+	auto ground1 = groundPrototype;
 	ground1.rotate(glm::vec3(M_PI / 2, 0, 0));
 	ground1.move(glm::vec3(0, -1, 0));
 	ground1.grow(glm::vec3(20, 20, 20));
 
-	auto ground2 = touchGrass(); 
+	auto ground2 = groundPrototype; 
 	ground2.rotate(glm::vec3(M_PI / 2, 0, 0)); 
 	ground2.move(glm::vec3(-20, -1, 0)); 
 	ground2.grow(glm::vec3(20, 20, 20)); 
 	 
-	auto ground3 = touchGrass(); 
+	auto ground3 = groundPrototype; 
 	ground3.rotate(glm::vec3(M_PI / 2, 0, 0)); 
 	ground3.move(glm::vec3(-40, -1, 0)); 
 	ground3.grow(glm::vec3(20, 20, 20)); 
 
-	auto ground4 = touchGrass();
+	auto ground4 = groundPrototype;
 	ground4.rotate(glm::vec3(M_PI / 2, 0, 0));
 	ground4.move(glm::vec3(20, -1, 0));
 	ground4.grow(glm::vec3(20, 20, 20));
 
-	auto ground5 = touchGrass();
+	auto ground5 = groundPrototype;
 	ground5.rotate(glm::vec3(M_PI / 2, 0, 0));
 	ground5.move(glm::vec3(-60, -1, 0));
 	ground5.grow(glm::vec3(20, 20, 20));
 
-	auto ground6 = touchGrass();
+	auto ground6 = groundPrototype;
 	ground6.rotate(glm::vec3(M_PI / 2, 0, 0));
 	ground6.move(glm::vec3(40, -1, 0));
 	ground6.grow(glm::vec3(20, 20, 20));
 
 	// wood pallets ====================================================================
 
-	auto base_pallet_left = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto base_pallet_left = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	base_pallet_left.move(glm::vec3(0.3, -0.9, -1));
 	base_pallet_left.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto base_pallet_right = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto base_pallet_right = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	base_pallet_right.move(glm::vec3(5.5, -0.9, -1));
 	base_pallet_right.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto low_pallet_left = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto low_pallet_left = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	low_pallet_left.move(glm::vec3(1, 2, -1)); 
 	low_pallet_left.rotate(glm::vec3(0,0, M_PI/2));
 	low_pallet_left.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto low_pallet_right = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto low_pallet_right = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	low_pallet_right.move(glm::vec3(5.2, 2, -1));
 	low_pallet_right.rotate(glm::vec3(0, 0, M_PI / 2));
 	low_pallet_right.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto mid_pallet = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto mid_pallet = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	mid_pallet.move(glm::vec3(2.8, 4.32, -1));
 	mid_pallet.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto up_pallet_left = assimpLoad("models/wood_pallet/scene.gltf", true); 
+	auto up_pallet_left = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS); 
 	up_pallet_left.move(glm::vec3(1.8, 7.2, -1));
 	up_pallet_left.rotate(glm::vec3(0, 0, M_PI / 2));
 	up_pallet_left.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto up_pallet_right = assimpLoad("models/wood_pallet/scene.gltf", true); 
+	auto up_pallet_right = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS); 
 	up_pallet_right.move(glm::vec3(4.5, 7.2, -1));
 	up_pallet_right.rotate(glm::vec3(0, 0, M_PI / 2));
 	up_pallet_right.grow(glm::vec3(0.5, 0.5, 0.5));
 
-	auto up_mid_pallet = assimpLoad("models/wood_pallet/scene.gltf", true);
+	auto up_mid_pallet = ModelCache::global().load("models/wood_pallet/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	up_mid_pallet.move(glm::vec3(2.8, 9.57, -1));
 	up_mid_pallet.grow(glm::vec3(0.4, 0.4, 0.4));
 
 	// PIG =========================================================================
 
-	auto pig = assimpLoad("models/hiberworld_minion_pig/scene.gltf", true);
+	auto pig = ModelCache::global().load("models/hiberworld_minion_pig/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	pig.move(glm::vec3(2.9, 5.5, -1));
 	pig.rotate(glm::vec3(0, M_PI, 0)); // rotate 180 degrees -> pi
 	pig.grow(glm::vec3(0.3,0.3,0.3));
 
 	// BIRDS =======================================================================
-	auto bird3 = assimpLoad("models/angry_bird_red/scene.gltf", true); //leftmost
+	auto bird3 = ModelCache::global().load("models/angry_bird_red/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS); //leftmost
 	bird3.move(glm::vec3(-30, 0.4, -1));
 	bird3.rotate(glm::vec3(0, M_PI / 2, 0));
 	bird3.grow(glm::vec3(0.07, 0.07, 0.07));
 
-	auto bird2 = assimpLoad("models/angry_bird_red/scene.gltf", true); //mid
+	auto bird2 = ModelCache::global().load("models/angry_bird_red/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS); //mid
 	bird2.move(glm::vec3(-33, 0.4, -1));
 	bird2.rotate(glm::vec3(0, M_PI / 2, 0));
 	bird2.grow(glm::vec3(0.07, 0.07, 0.07));
 
-	auto bird1 = assimpLoad("models/angry_bird_red/scene.gltf", true); //rightmost 
+	auto bird1 = ModelCache::global().load("models/angry_bird_red/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS); //rightmost 
 	bird1.move(glm::vec3(-36, 0.4, -1));
 	bird1.rotate(glm::vec3(0, M_PI / 2, 0));
 	bird1.grow(glm::vec3(0.07, 0.07, 0.07));
@@ -356,7 +439,7 @@ Scene testScene() {
 
 	// SLINGSHOT ===================================================================
 
-	auto slingshot = assimpLoad("models/scout_slingshot_from_secret_neighbor/scene.gltf", true);
+	auto slingshot = ModelCache::global().load("models/scout_slingshot_from_secret_neighbor/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	slingshot.move(glm::vec3(-46, 0.3, -3));
 	slingshot.rotate(glm::vec3(0, M_PI/2, 0));
 	slingshot.grow(glm::vec3(15, 15, 15));
@@ -366,46 +449,55 @@ Scene testScene() {
 
 	// EGG =========================================================================
 
-	auto egg1 = assimpLoad("models/egg/scene.gltf", true);
+	auto egg1 = ModelCache::global().load("models/egg/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	egg1.move(glm::vec3(26, 0.5, -3));
 	egg1.grow(glm::vec3(0.3, 0.3, 0.3));
 
-	auto egg2 = assimpLoad("models/egg/scene.gltf", true);
+	auto egg2 = ModelCache::global().load("models/egg/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	egg2.move(glm::vec3(28, 0.5, -5));
 	egg2.grow(glm::vec3(0.25, 0.25, 0.25));
 
-	auto egg3 = assimpLoad("models/egg/scene.gltf", true);
+	auto egg3 = ModelCache::global().load("models/egg/scene.gltf", true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS);
 	egg3.move(glm::vec3(24, 0.5, -5));
 	egg3.grow(glm::vec3(0.25, 0.25, 0.25));
 
 
+	// OCCLUDERS ===================================================================
+	// The pallet fort hides much of the scene behind it. The gaps between a pallet's boards are
+	// small from a distance; shrinking its box keeps the occluder inside the boards' outline.
+	for (auto* pallet : { &base_pallet_left, &base_pallet_right, &low_pallet_left, &low_pallet_right,
+		&mid_pallet, &up_pallet_left, &up_pallet_right, &up_mid_pallet }) {
+		pallet->setOccluder(boxOccluder(*pallet, 0.1f));
+	}
+
+
 	// Objects =====================================================================
 
-	std::vector<Object3D> objects;
-	objects.push_back(std::move(slingshot));
-	objects.push_back(std::move(bird1));
-	objects.push_back(std::move(bird2));
-	objects.push_back(std::move(bird3));
-	objects.push_back(std::move(ground1));
-	objects.push_back(std::move(ground2));
-	objects.push_back(std::move(ground3));
-	objects.push_back(std::move(ground4));
-	objects.push_back(std::move(ground5));
-	objects.push_back(std::move(ground6));
-	objects.push_back(std::move(base_pallet_left));
-	objects.push_back(std::move(base_pallet_right));
-	objects.push_back(std::move(low_pallet_left)); 
-	objects.push_back(std::move(low_pallet_right));
-	objects.push_back(std::move(mid_pallet));
-	objects.push_back(std::move(up_pallet_left));
-	objects.push_back(std::move(up_pallet_right));
-	objects.push_back(std::move(up_mid_pallet));
-	objects.push_back(std::move(pig));
-	objects.push_back(std::move(sky1));
-	objects.push_back(std::move(sky2));
-	objects.push_back(std::move(egg1));
-	objects.push_back(std::move(egg2));
-	objects.push_back(std::move(egg3));
+	ObjectStore objects;
+	objects.insert(std::move(slingshot));
+	ObjectHandle bird1Handle = objects.insert(std::move(bird1));
+	objects.insert(std::move(bird2));
+	objects.insert(std::move(bird3));
+	objects.insert(std::move(ground1));
+	objects.insert(std::move(ground2));
+	objects.insert(std::move(ground3));
+	objects.insert(std::move(ground4));
+	objects.insert(std::move(ground5));
+	objects.insert(std::move(ground6));
+	objects.insert(std::move(base_pallet_left));
+	objects.insert(std::move(base_pallet_right));
+	objects.insert(std::move(low_pallet_left)); 
+	objects.insert(std::move(low_pallet_right));
+	objects.insert(std::move(mid_pallet));
+	objects.insert(std::move(up_pallet_left));
+	objects.insert(std::move(up_pallet_right));
+	objects.insert(std::move(up_mid_pallet));
+	objects.insert(std::move(pig));
+	objects.insert(std::move(sky1));
+	objects.insert(std::move(sky2));
+	objects.insert(std::move(egg1));
+	objects.insert(std::move(egg2));
+	objects.insert(std::move(egg3));
 
 
 	// Starting Animation ==========================================================
@@ -415,19 +507,21 @@ Scene testScene() {
 	auto slingLoad = glm::vec3(-46.5, 3.8, -3);
 	auto jumpPoint = glm::vec3(-38, 8, -3);
 
-	loadBird.addAnimation(std::make_unique<PauseAnimation>(objects[1], 2));
-	loadBird.addAnimation(std::make_unique<RotationAnimation>(objects[1], 1, glm::vec3(0, M_PI, 0))); // 180 
-	loadBird.addAnimation(std::make_unique<RotationAnimation>(objects[1], 0.5, glm::vec3(0, 0, -M_PI/4.6))); // tilt up 
-	loadBird.addAnimation(std::make_unique<BezierTranslationAnimation>(objects[1], 1.5, objects[1].getPosition(), jumpPoint, slingLoad));
-	loadBird.addAnimation(std::make_unique<RotationAnimation>(objects[1], 0.5, glm::vec3(0, 0, M_PI / 4))); // tilt back 
-	loadBird.addAnimation(std::make_unique<RotationAnimation>(objects[1], 1, glm::vec3(0, M_PI, 0))); // 180 
+	loadBird.addAnimation(std::make_unique<PauseAnimation>(bird1Handle, 2));
+	loadBird.addAnimation(std::make_unique<RotationAnimation>(bird1Handle, 1, glm::vec3(0, M_PI, 0))); // 180 
+	// Rotations turn the bird about its own axes; turned to face the slingshot, it pitches about its x axis.
+	loadBird.addAnimation(std::make_unique<RotationAnimation>(bird1Handle, 0.5, glm::vec3(-M_PI / 4.6, 0, 0))); // tilt up 
+	loadBird.addAnimation(std::make_unique<BezierTranslationAnimation>(bird1Handle, 1.5, objects.at(bird1Handle).getPosition(), jumpPoint, slingLoad));
+	loadBird.addAnimation(std::make_unique<RotationAnimation>(bird1Handle, 0.5, glm::vec3(M_PI / 4, 0, 0))); // tilt back 
+	loadBird.addAnimation(std::make_unique<RotationAnimation>(bird1Handle, 1, glm::vec3(0, M_PI, 0))); // 180 
 
 	std::vector<Animator> animators;
 	animators.push_back(std::move(loadBird));
 
 	// Scene -----------------------------------------------------------------------
+	// Drawn through a RenderQueue; see main().
 	return Scene{
-		phongLighting(),
+		phongLightingInstanced(),
 		std::move(objects),
 		std::move(animators)
 		/*{
@@ -460,16 +554,17 @@ Scene testScene() {
  */
 Scene marbleSquare() {
 	std::vector<Texture> textures = {
-		loadTexture("models/White_marble_03/Textures_4K/white_marble_03_4k_baseColor.tga", "baseTexture"),
+		streamTexture("models/White_marble_03/Textures_4K/white_marble_03_4k_baseColor.tga", "baseTexture"),
 	};
 
-	auto mesh = Mesh3D::square(textures);
-	auto square = Object3D(std::vector<Mesh3D>{mesh});
+	std::vector<Mesh3D> meshes;
+	meshes.push_back(Mesh3D::square(textures));
+	auto square = Object3D(std::move(meshes));
 	square.grow(glm::vec3(5, 5, 5));
 	square.rotate(glm::vec3(-3.14159 / 4, 0, 0));
 	return Scene{
 		phongLighting(),
-		{square}
+		storeOf(std::move(square))
 	};
 }
 
@@ -490,15 +585,15 @@ Scene bunny() {
 	//bunny.setMass(4);
 	//bunny.addForceToList(gravity);
 
-	std::vector<Object3D> objects;
-	objects.push_back(std::move(bunny));
+	ObjectStore objects;
+	ObjectHandle bunnyHandle = objects.insert(std::move(bunny));
 
 	// Test animation 
 	Animator animBunny;
 	 
-	animBunny.addAnimation(std::make_unique<RotationAnimation>(objects[0], 5, glm::vec3(0, 6.28, 0)));
-	animBunny.addAnimation(std::make_unique<RotationAnimation>(objects[0], 5, glm::vec3(6.28, 0, 0)));
-	//animBunny.addAnimation(std::make_unique<BezierTranslationAnimation>(objects[0], 3, objects[0].getPosition(), glm::vec3(1, 0.5, -6), glm::vec3(2, -0.5, -6)));
+	animBunny.addAnimation(std::make_unique<RotationAnimation>(bunnyHandle, 5, glm::vec3(0, 1, 0), 6.28f));
+	animBunny.addAnimation(std::make_unique<RotationAnimation>(bunnyHandle, 5, glm::vec3(1, 0, 0), 6.28f));
+	//animBunny.addAnimation(std::make_unique<BezierTranslationAnimation>(bunnyHandle, 3, objects.at(bunnyHandle).getPosition(), glm::vec3(1, 0.5, -6), glm::vec3(2, -0.5, -6)));
 	
 	std::vector<Animator> animators;
 	animators.push_back(std::move(animBunny));
@@ -526,24 +621,25 @@ Scene lifeOfPi() {
 	boat.addChild(std::move(tiger));
 	
 	// Because boat and tiger are local variables, they will be destroyed when this
-	// function terminates. To prevent that, we need to move them into a vector, and then
-	// move that vector as part of the return value.
-	std::vector<Object3D> objects;
-	objects.push_back(std::move(boat));
+	// function terminates. To prevent that, we need to move them into a store, and then
+	// move that store as part of the return value.
+	ObjectStore objects;
+	ObjectHandle boatHandle = objects.insert(std::move(boat));
 	
 	// We want these animations to referenced the *moved* objects, which are no longer
-	// in the variables named "tiger" and "boat". "boat" is now in the "objects" list at
-	// index 0, and "tiger" is the index-1 child of the boat.
+	// in the variables named "tiger" and "boat". "boat" is now in the store under boatHandle,
+	// and "tiger" is the index-1 child of the boat. The handles stay valid however the store
+	// grows or moves.
 	Animator animBoat;
 	//animBoat.addAnimation([&objects[0]]() {
 		//return std::make_unique<RotationAnimation>(objects[0], 10, glm::vec3(0, 6.28, 0));
 	//});
-	animBoat.addAnimation(std::make_unique<RotationAnimation>(objects[0], 10, glm::vec3(0, 6.28, 0)));
+	animBoat.addAnimation(std::make_unique<RotationAnimation>(boatHandle, 10, glm::vec3(0, 1, 0), 6.28f));
 	Animator animTiger;
 	//animTiger.addAnimation([&objects[0].getChild(1)]() {
 		//return std::make_unique<RotationAnimation>(objects[0].getChild(1), 10, glm::vec3(0, 0, 6.28));
 	//});
-	animTiger.addAnimation(std::make_unique<RotationAnimation>(objects[0].getChild(1), 10, glm::vec3(0, 0, 6.28)));
+	animTiger.addAnimation(std::make_unique<RotationAnimation>(ObjectRef(boatHandle).child(1), 10, glm::vec3(0, 0, 1), 6.28f));
 
 	// The Animators will be destroyed when leaving this function, so we move them into
 	// a list to be returned.
@@ -559,6 +655,71 @@ Scene lifeOfPi() {
 	};
 }
 
+/**
+ * @brief Imports the given models on worker threads and adds them to the model cache, keeping
+ * the window responsive (and showing progress) while they stream into VRAM. Returns false if the
+ * window was closed first; the loader's workers are stopped and joined before it returns.
+ */
+bool preloadModels(sf::RenderWindow& window, const std::vector<std::string>& paths) {
+	AssetLoader loader;
+	std::vector<ModelHandle> handles;
+	for (auto& path : paths) {
+		handles.push_back(loader.loadModel(path, true, TEST_SCENE_VERTEX_FORMAT, TEST_SCENE_LODS));
+	}
+
+	// Leave most of each frame for presenting; GL uploads get a fixed slice of it.
+	const float_t uploadBudget = 1.0f / 120;
+	size_t finished = 0;
+	while (finished < handles.size()) {
+		sf::Event ev;
+		while (window.pollEvent(ev)) {
+			if (ev.type == sf::Event::Closed) {
+				return false;
+			}
+		}
+
+		loader.processUploads(uploadBudget);
+
+		finished = 0;
+		for (auto& handle : handles) {
+			if (handle->isReady() || handle->hasFailed()) {
+				++finished;
+			}
+		}
+
+		// A simple loading screen: fade from black to the sky color as models arrive.
+		float_t progress = static_cast<float_t>(finished) / handles.size();
+		glClearColor(0.4f * progress, 0.6f * progress, 0.9f * progress, 1);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		window.display();
+	}
+	glClearColor(0, 0, 0, 1);
+
+	for (auto& handle : handles) {
+		if (handle->isReady()) {
+			ModelCache::global().add(handle->path(), handle->flipTextureCoords(), handle->vertexFormat(),
+				handle->lodSettings(), std::move(handle->object()));
+		}
+		else {
+			// testScene() will retry the import synchronously and report the error.
+			std::cout << "ERROR: " << handle->path() << ": " << handle->error() << std::endl;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Deletes the GL objects held by the process-wide caches, which must happen while the
+ * context still exists.
+ */
+void releaseGLResources() {
+	// The cached prototypes hold textures.
+	ModelCache::global().clear();
+	TextureStreamer::global().clear();
+	UniformBlocks::global().clear();
+	MultiDrawIndirect::global().clear();
+}
+
 int main() {
 
 	// Initialize the window and OpenGL.
@@ -568,37 +729,54 @@ int main() {
 	Settings.antialiasingLevel = 2;  // Request 2 levels of antialiasing
 	sf::RenderWindow window(sf::VideoMode{ 1300, 800 }, "SFML Demo", sf::Style::Resize | sf::Style::Close, Settings);
 	gladLoadGL();
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::global().setEnabled(GL_DEPTH_TEST, true);
 
 	// Initialize scene objects. 
+	if (!preloadModels(window, TEST_SCENE_MODELS)) {
+		releaseGLResources();
+		window.close();
+		return 0;
+	}
 	auto scene = testScene();
+	auto textureStats = TextureRegistry::global().stats();
+	std::cout << "Textures: " << textureStats.requested << " requested, " << textureStats.uploaded
+		<< " unique (" << textureStats.pathHits << " shared by path, " << textureStats.contentHits
+		<< " by content), " << textureStats.compressedUploads << " precompressed" << std::endl;
 	
 	/**/
-	auto& slingshot = scene.objects[0];
-	auto& bird1 = scene.objects[1];
-	auto& bird2 = scene.objects[2];
-	auto& bird3 = scene.objects[3];  
-	auto& lower_left_pallet = scene.objects[11];
+	// testScene() fills an empty store, so the handles come in the order it added the objects.
+	auto sceneObjects = scene.objects.handles();
+	auto slingshot = sceneObjects[0];
+	auto bird1 = sceneObjects[1];
+	auto bird2 = sceneObjects[2];
+	auto bird3 = sceneObjects[3];  
+	auto lower_left_pallet = sceneObjects[11];
 
 	auto& animators = scene.animators; 
 
-	std::vector<std::reference_wrapper<Object3D>> birdQueue; 
-	birdQueue.push_back(std::ref(bird1)); 
-	birdQueue.push_back(std::ref(bird2)); 
-	birdQueue.push_back(std::ref(bird3)); 
+	std::vector<ObjectHandle> birdQueue; 
+	birdQueue.push_back(bird1); 
+	birdQueue.push_back(bird2); 
+	birdQueue.push_back(bird3); 
 
 	// Start with the leftmost bird 
 	auto currentBird = 0; 
 	 
 	// assign starting values to the birds 
-	for (auto& birdReference : birdQueue) {
-		Object3D& bird = birdReference.get();
+	for (auto birdHandle : birdQueue) {
+		Object3D& bird = scene.objects.at(birdHandle);
 
 		bird.setVelocity(glm::vec3(0, 0, 0));
 		bird.setMass(4);
 		bird.addForceToList(glm::vec3(0, -9.8, 0));
 	}
 
+	scene.index();
+	// testScene() adds the three eggs last.
+	const std::vector<ObjectHandle> eggs(sceneObjects.end() - 3, sceneObjects.end());
+	const float_t eggContactDistance = 2.5f;
+	std::cout << "Scene tree: " << scene.tree.size() << " objects, height " << scene.tree.height() << std::endl;
+
 	// wall / pallet dim
 	float palletHeight = 10;
 	float palletWidth = 3; 
@@ -626,8 +804,6 @@ int main() {
 	
 	ShaderProgram& mainShader = scene.defaultShader;
 	mainShader.activate();
-	mainShader.setUniform("view", camera);
-	mainShader.setUniform("projection", perspective);
 	 
 	// Lighting parameters
 	glm::vec3 ambientColor(0.1, 0.1, 0.1); // white...
@@ -644,21 +820,27 @@ int main() {
 	//program.activate(); 
 	mainShader.setUniform("baseTexture", 0);
 	mainShader.setUniform("material", glm::vec4(ambient, diffuse, specular, shininess));
-	mainShader.setUniform("ambientColor", ambientColor);
-	mainShader.setUniform("directionalLight", directionalLight);
-	mainShader.setUniform("directionalColor", directionalColor);
-	mainShader.setUniform("viewPos", camera);
+
+	// The camera and lights go in the frame block, shared by every program.
+	FrameConstants frame = {};
+	frame.view = camera;
+	frame.projection = perspective;
+	frame.viewPos = cameraPosition;
+	frame.ambientColor = ambientColor;
+	frame.directionalLight = directionalLight;
+	frame.directionalColor = directionalColor;
 
 	// do a spotlight for EGG https://learnopengl.com/Lighting/Light-casters
 	glm::vec3 color(1, 0, 1);
-	mainShader.setUniform("spotLightPos", glm::vec3(28, 4, -1)); // put over the first bird for now 
-	mainShader.setUniform("spotLightDir", glm::vec3(0, -1, 0)); // face to floor 
-	mainShader.setUniform("spotLightColor", color);
-	mainShader.setUniform("spotLightAmbient", 1.0f);
-	mainShader.setUniform("spotLightDiffuse", 0.8f);
-	mainShader.setUniform("spotLightSpecular", 1.0f); 
-	mainShader.setUniform("spotLightCutOff", glm::cos(glm::radians(12.5f)));
-	mainShader.setUniform("spotLightOuterCutOff", glm::cos(glm::radians(17.5f)));
+	frame.spotLightPos = glm::vec3(28, 4, -1); // put over the first bird for now 
+	frame.spotLightDir = glm::vec3(0, -1, 0); // face to floor 
+	frame.spotLightColor = color;
+	frame.spotLightAmbient = 1.0f;
+	frame.spotLightDiffuse = 0.8f;
+	frame.spotLightSpecular = 1.0f; 
+	frame.spotLightCutOff = glm::cos(glm::radians(12.5f));
+	frame.spotLightOuterCutOff = glm::cos(glm::radians(17.5f));
+	UniformBlocks::global().setFrame(frame);
 
 	// Physics?
 
@@ -677,6 +859,10 @@ int main() {
 	bool flag1 = false; 
 	bool flag2 = false; 
 	
+	RenderQueue renderQueue;
+	OcclusionCuller occlusionCuller;
+	std::vector<ObjectHandle> visibleObjects;
+
 	// Ready, set, go!
 	for (auto& animator : scene.animators) {
 		animator.start();
@@ -697,18 +883,29 @@ int main() {
 		auto diff = now - last;
 		auto diffSeconds = diff.asSeconds();
 
-		//bunny.tick(diffSeconds);
-		birdQueue[currentBird].get().tick(diffSeconds);
+		// The bird in play, resolved once per frame; spent birds are despawned, and if the one in
+		// play is gone too there is nothing left to play.
+		Object3D* bird = scene.objects.get(birdQueue[currentBird]);
+		if (bird == nullptr) {
+			gameEnd = true;
+		}
+		else {
+			//bunny.tick(diffSeconds);
+			bird->tick(diffSeconds);
+		}
 
 		last = now;
 		for (auto& animator : scene.animators) {
-			animator.tick(diffSeconds);
+			animator.tick(scene.objects, diffSeconds);
 		} 
+		scene.updateTree();
 
 
 
 		//printPosition(bunny.getPosition());
-		printPosition(birdQueue[currentBird].get().getPosition());
+		if (bird != nullptr) {
+			printPosition(bird->getPosition());
+		}
 
 		sf::Event ev;
 		while (window.pollEvent(ev)) {
@@ -725,9 +922,12 @@ int main() {
 		} 
 
 		if (gameEnd == true) {
+			// SFML changes GL state without going through the cache.
+			GLStateCache::global().unbindAll();
 			window.clear();
 			window.draw(endScreen);
 			window.display(); 
+			GLStateCache::global().invalidate();
 		}
 		else {
 
@@ -741,12 +941,12 @@ int main() {
 			}*/
 			if (keysPressed.find(sf::Keyboard::Key::B) != keysPressed.end()) {
 				//bunny.setVelocity(glm::vec3(1,1,1));
-				cameraPosition = birdQueue[currentBird].get().getPosition() + glm::vec3(-1, 0, 30); // Adjust the camera's offset from the bird
-				//cameraPosition.z = birdQueue[currentBird].get().getPosition().z;
+				cameraPosition = bird->getPosition() + glm::vec3(-1, 0, 30); // Adjust the camera's offset from the bird
+				//cameraPosition.z = bird->getPosition().z;
 
 				// have hit only occur once (don't fly forever if key held) 
 				//if (hitRelease == true) {
-				birdQueue[currentBird].get().setVelocity(glm::vec3(15, 10, 0));
+				bird->setVelocity(glm::vec3(15, 10, 0));
 				//	hitRelease = false; 
 				//}
 
@@ -763,9 +963,6 @@ int main() {
 
 				mainShader.setUniform("baseTexture", 0);
 				mainShader.setUniform("material", glm::vec4(ambient, diffuse, specular, shininess));
-				mainShader.setUniform("ambientColor", ambientColor);
-				mainShader.setUniform("directionalLight", directionalLight);
-				mainShader.setUniform("directionalColor", directionalColor);
 			}
 
 			if (keysPressed.find(sf::Keyboard::Key::P) != keysPressed.end()) { // turn on directional light 
@@ -776,9 +973,6 @@ int main() {
 
 				mainShader.setUniform("baseTexture", 0);
 				mainShader.setUniform("material", glm::vec4(ambient, diffuse, specular, shininess));
-				mainShader.setUniform("ambientColor", ambientColor);
-				mainShader.setUniform("directionalLight", directionalLight);
-				mainShader.setUniform("directionalColor", directionalColor);
 			}
 
 			if (keysPressed.find(sf::Keyboard::Key::Escape) != keysPressed.end()) {
@@ -787,17 +981,17 @@ int main() {
 			 
 
 
-			bool birdIsInMotion = isBirdInMotion(birdQueue[currentBird].get().getVelocity(), 0.09);
-			printBirdVelocity(birdQueue[currentBird].get());
+			bool birdIsInMotion = isBirdInMotion(bird->getVelocity(), 0.09);
+			printBirdVelocity(*bird);
 			// update camera with new position 
 			if (birdIsInMotion) {
-				cameraPosition = birdQueue[currentBird].get().getPosition() + glm::vec3(5, 5, 20);
-				camera = glm::lookAt(cameraPosition, birdQueue[currentBird].get().getPosition(), cameraUp);
+				cameraPosition = bird->getPosition() + glm::vec3(5, 5, 20);
+				camera = glm::lookAt(cameraPosition, bird->getPosition(), cameraUp);
 
 			}
 			else {
 
-				birdQueue[currentBird].get().setVelocity(glm::vec3(0, 0, 0));
+				bird->setVelocity(glm::vec3(0, 0, 0));
 				gravity = force0;
 				friction = force0;
 
@@ -826,7 +1020,10 @@ int main() {
 				if (currentBirdCanChange) { // make a boolean for currentBirdCanChange . . . so that we dont get stuck in the loop 
 
 					if (currentBird == 0) {
+						// The spent bird leaves the scene.
+						scene.despawn(birdQueue[currentBird]);
 						currentBird = 1;
+						bird = &scene.objects.at(birdQueue[currentBird]);
 
 						std::cout << "Reached next bird (2)" << std::endl; // reached 
 
@@ -836,12 +1033,12 @@ int main() {
 						auto jumpPoint = glm::vec3(-36, 9, -3);
 
 						// Add the load up animation 
-						loadBird2.addAnimation(std::make_unique<PauseAnimation>(birdQueue[currentBird].get(), 2));
-						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 1, glm::vec3(0, M_PI, 0))); // 180   
-						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 0.5, glm::vec3(0, 0, -M_PI / 4.6))); // tilt up   
-						loadBird2.addAnimation(std::make_unique<BezierTranslationAnimation>(birdQueue[currentBird].get(), 1.5, birdQueue[currentBird].get().getPosition(), jumpPoint, slingLoad));
-						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 0.5, glm::vec3(0, 0, M_PI / 4))); // tilt back   
-						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 1, glm::vec3(0, M_PI, 0))); // 180   
+						loadBird2.addAnimation(std::make_unique<PauseAnimation>(birdQueue[currentBird], 2));
+						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 1, glm::vec3(0, M_PI, 0))); // 180   
+						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 0.5, glm::vec3(-M_PI / 4.6, 0, 0))); // tilt up   
+						loadBird2.addAnimation(std::make_unique<BezierTranslationAnimation>(birdQueue[currentBird], 1.5, bird->getPosition(), jumpPoint, slingLoad));
+						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 0.5, glm::vec3(M_PI / 4, 0, 0))); // tilt back   
+						loadBird2.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 1, glm::vec3(0, M_PI, 0))); // 180   
 
 						loadBird2.start();
 						animators.push_back(std::move(loadBird2));
@@ -850,8 +1047,10 @@ int main() {
 						currentBirdCanChange = false;
 					}
 					else if (currentBird == 1) {
+						scene.despawn(birdQueue[currentBird]);
 						currentBird = 2;
-						//birdQueue[currentBird].get() 
+						bird = &scene.objects.at(birdQueue[currentBird]);
+						//scene.objects.at(birdQueue[currentBird]) 
 
 						Animator loadBird3;
 						// bird1.move(glm::vec3(-30, 0.4, -1)); // bird1 location 
@@ -859,12 +1058,12 @@ int main() {
 						auto jumpPoint = glm::vec3(-36, 9, -3);
 
 						// Add the load up animation
-						loadBird3.addAnimation(std::make_unique<PauseAnimation>(birdQueue[currentBird].get(), 2));
-						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 1, glm::vec3(0, M_PI, 0))); // 180   
-						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 0.5, glm::vec3(0, 0, -M_PI / 4.6))); // tilt up   
-						loadBird3.addAnimation(std::make_unique<BezierTranslationAnimation>(birdQueue[currentBird].get(), 1.5, birdQueue[currentBird].get().getPosition(), jumpPoint, slingLoad));
-						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 0.5, glm::vec3(0, 0, M_PI / 4))); // tilt back   
-						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird].get(), 1, glm::vec3(0, M_PI, 0))); // 180   
+						loadBird3.addAnimation(std::make_unique<PauseAnimation>(birdQueue[currentBird], 2));
+						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 1, glm::vec3(0, M_PI, 0))); // 180   
+						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 0.5, glm::vec3(-M_PI / 4.6, 0, 0))); // tilt up   
+						loadBird3.addAnimation(std::make_unique<BezierTranslationAnimation>(birdQueue[currentBird], 1.5, bird->getPosition(), jumpPoint, slingLoad));
+						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 0.5, glm::vec3(M_PI / 4, 0, 0))); // tilt back   
+						loadBird3.addAnimation(std::make_unique<RotationAnimation>(birdQueue[currentBird], 1, glm::vec3(0, M_PI, 0))); // 180   
 
 						loadBird3.start();
 						animators.push_back(std::move(loadBird3));
@@ -883,81 +1082,85 @@ int main() {
 
 			}
 			//camera = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
-			mainShader.setUniform("view", camera);
+			frame.view = camera;
+			frame.viewPos = cameraPosition;
+			UniformBlocks::global().setFrame(frame);
 
 			//bunny.addForceToList(gravity);
-			birdQueue[currentBird].get().addForceToList(gravity);
+			bird->addForceToList(gravity);
 
 			// collide with the ground 
-			if (birdQueue[currentBird].get().getPosition().y <= 0) { // say ground is at -1 
-				auto velocity = birdQueue[currentBird].get().getVelocity();
+			if (bird->getPosition().y <= 0) { // say ground is at -1 
+				auto velocity = bird->getVelocity();
 				velocity.y = -velocity.y * 0.6; // reduce 
-				birdQueue[currentBird].get().setVelocity(velocity);
-				birdQueue[currentBird].get().setPosition(glm::vec3(birdQueue[currentBird].get().getPosition().x, 0, birdQueue[currentBird].get().getPosition().z));
+				bird->setVelocity(velocity);
+				bird->setPosition(glm::vec3(bird->getPosition().x, 0, bird->getPosition().z));
 			}
 			// makes contact with the wall/pallet - center point located at (1,2,-1)
 			// lower left pallet 
-			if (birdQueue[currentBird].get().getPosition().x > -0.5
-				&& birdQueue[currentBird].get().getPosition().x <= 0
-				&& birdQueue[currentBird].get().getPosition().y < 5
+			if (bird->getPosition().x > -0.5
+				&& bird->getPosition().x <= 0
+				&& bird->getPosition().y < 5
 				) {
 				std::cout << "CONTACT - lower left pallet" << std::endl;
 
-				auto velo = birdQueue[currentBird].get().getVelocity();
+				auto velo = bird->getVelocity();
 				velo.x = -velo.x * 0.8;
-				birdQueue[currentBird].get().setVelocity(velo);
-				birdQueue[currentBird].get().setPosition(glm::vec3(-0.5, birdQueue[currentBird].get().getPosition().y, birdQueue[currentBird].get().getPosition().z));
+				bird->setVelocity(velo);
+				bird->setPosition(glm::vec3(-0.5, bird->getPosition().y, bird->getPosition().z));
 
 			}
 			// makes contact with the higher wall/pallet - center point located at (1.8,7.2,-1)
-			if (birdQueue[currentBird].get().getPosition().x > 0
-				&& birdQueue[currentBird].get().getPosition().x <= 1
-				&& birdQueue[currentBird].get().getPosition().y < 10.2
-				&& birdQueue[currentBird].get().getPosition().y > 4.3
+			if (bird->getPosition().x > 0
+				&& bird->getPosition().x <= 1
+				&& bird->getPosition().y < 10.2
+				&& bird->getPosition().y > 4.3
 				) {
 				std::cout << "CONTACT - upper left pallet" << std::endl;
 
-				auto velo = birdQueue[currentBird].get().getVelocity();
+				auto velo = bird->getVelocity();
 				velo.x = -velo.x * 0.99;
-				birdQueue[currentBird].get().setVelocity(velo);
-				birdQueue[currentBird].get().setPosition(glm::vec3(0, birdQueue[currentBird].get().getPosition().y, birdQueue[currentBird].get().getPosition().z));
+				bird->setVelocity(velo);
+				bird->setPosition(glm::vec3(0, bird->getPosition().y, bird->getPosition().z));
 			}
 
 			// makes contact with middle pallet 
-			if (birdQueue[currentBird].get().getPosition().x > 1
-				&& birdQueue[currentBird].get().getPosition().x <= 6
-				&& birdQueue[currentBird].get().getPosition().y <= 4.5
-				&& birdQueue[currentBird].get().getPosition().y > 4
+			if (bird->getPosition().x > 1
+				&& bird->getPosition().x <= 6
+				&& bird->getPosition().y <= 4.5
+				&& bird->getPosition().y > 4
 				) { // say ground is at -1 -> 0 bc -1 too low 
 				std::cout << "CONTACT - middle pallet" << std::endl;
 
-				auto velocity = birdQueue[currentBird].get().getVelocity();
+				auto velocity = bird->getVelocity();
 				velocity.y = -velocity.y * 0.75; // reduce 
-				birdQueue[currentBird].get().setVelocity(velocity);
-				birdQueue[currentBird].get().setPosition(glm::vec3(birdQueue[currentBird].get().getPosition().x, 4.5, birdQueue[currentBird].get().getPosition().z));
+				bird->setVelocity(velocity);
+				bird->setPosition(glm::vec3(bird->getPosition().x, 4.5, bird->getPosition().z));
 			}
 
 			// makes contact with roof pallet 
-			if (birdQueue[currentBird].get().getPosition().x > 1.5
-				&& birdQueue[currentBird].get().getPosition().x <= 5
-				&& birdQueue[currentBird].get().getPosition().y <= 11
-				&& birdQueue[currentBird].get().getPosition().y > 9.7
+			if (bird->getPosition().x > 1.5
+				&& bird->getPosition().x <= 5
+				&& bird->getPosition().y <= 11
+				&& bird->getPosition().y > 9.7
 				) { // say ground is at -1 -> 0 bc -1 too low 
 				std::cout << "CONTACT - roof pallet" << std::endl;
 
-				auto velocity = birdQueue[currentBird].get().getVelocity();
+				auto velocity = bird->getVelocity();
 				velocity.y = -velocity.y * 0.7; // reduce 
-				birdQueue[currentBird].get().setVelocity(velocity);
-				//birdQueue[currentBird].get().setRotationalVelocity(glm::vec3(0,0,-3)); // works but needs to slow down 
-				birdQueue[currentBird].get().setPosition(glm::vec3(birdQueue[currentBird].get().getPosition().x, 11, birdQueue[currentBird].get().getPosition().z));
+				bird->setVelocity(velocity);
+				//bird->setRotationalVelocity(glm::vec3(0,0,-3)); // works but needs to slow down 
+				bird->setPosition(glm::vec3(bird->getPosition().x, 11, bird->getPosition().z));
 			}
 
 
-			// makes contact with the eggs 
-			if (birdQueue[currentBird].get().getPosition().x > 23
-				&& birdQueue[currentBird].get().getPosition().x < 30
-				&& birdQueue[currentBird].get().getPosition().y <= 2
-				&& birdQueue[currentBird].get().getPosition().y > 0) {
+			// makes contact with the eggs: the nearest egg is within reach of the bird's center
+			auto nearestEgg = scene.tree.nearest(bird->getPosition(), eggContactDistance,
+				[&](uint32_t value) {
+					auto handle = scene.treeHandle(value);
+					return std::find(eggs.begin(), eggs.end(), handle) != eggs.end();
+				});
+			if (nearestEgg) {
 
 				std::cout << "CONTACT - eggs" << std::endl; 
 				 
@@ -968,15 +1171,45 @@ int main() {
 
 			// friction of the floor 
 			// my mu is 0.3 and go opposite direction of velocity (?) :D ? 
-			auto friction = -0.3f * birdQueue[currentBird].get().getVelocity() * birdQueue[currentBird].get().getMass();
-			birdQueue[currentBird].get().addForceToList(friction);
+			auto friction = -0.3f * bird->getVelocity() * bird->getMass();
+			bird->addForceToList(friction);
  
+			// Continue uploading any textures that are still streaming in.
+			TextureStreamer::global().update(TEXTURE_STREAMING_BYTES_PER_FRAME);
+
+			// Bring every world matrix up to date with this frame's movement, in one pass.
+			TransformSystem::global().update();
+
 			// Clear the OpenGL "context".
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			// Render each object in the scene.
-			for (auto& o : scene.objects) {
-				o.render(window, mainShader);
+			// Render each object in the scene: the queue sorts the meshes by state and depth, and
+			// draws each run of identical meshes as instances.
+			// The scene tree finds the objects in view without testing each one. The largest
+			// occluders among them then hide whatever is entirely behind them.
+			glm::mat4 viewProjection = glm::mat4(perspective) * camera;
+			visibleObjects.clear();
+			scene.tree.queryFrustum(Frustum(viewProjection), [&](uint32_t value) {
+				auto handle = scene.treeHandle(value);
+				if (handle != ObjectStore::NULL_HANDLE) {
+					visibleObjects.push_back(handle);
+				}
+			});
+			occlusionCuller.begin(viewProjection);
+			for (auto handle : visibleObjects) {
+				auto& object = scene.objects.at(handle);
+				auto& occluder = object.getOccluder();
+				if (!occluder.empty()) {
+					occlusionCuller.addOccluder(occluder, object.getWorldMatrix());
+				}
 			}
+			occlusionCuller.rasterizeOccluders();
+			renderQueue.begin(camera, perspective);
+			for (auto handle : visibleObjects) {
+				if (!occlusionCuller.isOccluded(scene.tree.bounds(scene.proxies.at(handle)))) {
+					renderQueue.submit(scene.objects.at(handle), mainShader);
+				}
+			}
+			renderQueue.flush(window);
 
 
 			window.display();
@@ -984,6 +1217,30 @@ int main() {
 	}
 
 
+	auto stateStats = GLStateCache::global().stats();
+	std::cout << "GL state changes: " << stateStats.issued << " issued, " << stateStats.skipped
+		<< " skipped as redundant" << std::endl;
+	auto queueStats = renderQueue.stats();
+	std::cout << "Last frame: " << queueStats.items << " meshes in " << queueStats.commands << " runs, "
+		<< queueStats.drawCalls << " draw calls"
+		<< (MultiDrawIndirect::global().supported() ? " (multi-draw indirect)" : " (instanced)") << std::endl;
+	std::cout << "Culling: " << queueStats.nodesTested << " nodes tested, " << queueStats.nodesCulled
+		<< " subtrees culled, " << queueStats.nodesDrawn << " nodes drawn, " << queueStats.meshesCulled
+		<< " meshes culled" << std::endl;
+	auto transformStats = TransformSystem::global().stats();
+	std::cout << "Transforms: " << transformStats.worldUpdates << " of " << TransformSystem::global().size()
+		<< " world matrices and " << transformStats.localRebuilds << " local matrices rebuilt" << std::endl;
+	std::cout << "Detail: " << queueStats.triangles << " triangles drawn, " << queueStats.lodMeshes << " of "
+		<< queueStats.items << " meshes at a reduced level of detail" << std::endl;
+	auto occlusionStats = occlusionCuller.stats();
+	std::cout << "Occlusion: " << occlusionStats.occludersRasterized << " of " << occlusionStats.occluderCandidates
+		<< " occluders rasterized (" << occlusionStats.trianglesRasterized << " triangles) in "
+		<< occlusionStats.rasterizeMilliseconds << " ms, " << occlusionStats.objectsOccluded << " of "
+		<< occlusionStats.objectsTested << " objects rejected in " << occlusionStats.testMilliseconds << " ms"
+		<< std::endl;
+
+	releaseGLResources();
+
 	return 0;
 }
 
@@ -0,0 +1,45 @@
+#version 330
+// A vertex shader for rendering vertices with normal vectors and texture coordinates,
+// which creates outputs needed for a Phong reflection fragment shader.
+// This variant draws many instances of a mesh at once: each instance's transforms and packed
+// position bounds are vertex attributes, filled with MeshInstance from an instance buffer by
+// RenderQueue, instead of an ObjectBlock and uniforms.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec2 vTexCoord;
+layout (location=3) in mat4 instanceModel;
+layout (location=7) in mat4 instanceModelViewProjection;
+layout (location=11) in mat3 instanceNormalMatrix;
+layout (location=14) in vec3 instancePositionOffset;
+layout (location=15) in vec3 instancePositionScale;
+
+// Meshes with VertexFormat::Packed store unorm16 positions relative to their bounds, octahedral
+// normals in vNormal.xy, and half-float texture coordinates; see VertexPacking.h.
+uniform bool packedVertices;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragWorldPos;
+
+
+void main() {
+    vec3 position = packedVertices ? instancePositionOffset + vPosition * instancePositionScale : vPosition;
+    vec3 normal = packedVertices ? octahedralDecode(vNormal.xy) : vNormal;
+
+    // Transform the position to clip space.
+    gl_Position = instanceModelViewProjection * vec4(position, 1.0);
+    TexCoord = vTexCoord;
+    Normal = instanceNormalMatrix * normal;
+    FragWorldPos = vec3(instanceModel * vec4(position, 1.0));
+
+
+}
\ No newline at end of file
@@ -16,27 +16,28 @@ uniform sampler2D baseTexture;
 // Material parameters for the whole mesh: k_a, k_d, k_s, shininess.
 uniform vec4 material;
 
-// Ambient light color.
-uniform vec3 ambientColor;
-
-// Direction and color of a single directional light.
-uniform vec3 directionalLight; // this is the "I" vector, not the "L" vector.
-uniform vec3 directionalColor;
-
-// Location of the camera.
-uniform vec3 viewPos;
-
-
-// Spot light things
-uniform vec3 spotLightPos;
-uniform vec3 spotLightDir;
-uniform vec3 spotLightColor; 
-uniform float spotLightCutOff;
-uniform float spotLightOuterCutOff;
-
-uniform float spotLightAmbient;
-uniform float spotLightDiffuse;
-uniform float spotLightSpecular;
+// Constants for the whole frame, shared by every program; see FrameConstants in UniformBlocks.h.
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    // Location of the camera.
+    vec3 viewPos;
+    // Ambient light color.
+    vec3 ambientColor;
+    // Direction and color of a single directional light.
+    vec3 directionalLight; // this is the "I" vector, not the "L" vector.
+    vec3 directionalColor;
+    // Spot light things
+    vec3 spotLightPos;
+    float spotLightCutOff;
+    vec3 spotLightDir;
+    float spotLightOuterCutOff;
+    vec3 spotLightColor;
+    float spotLightAmbient;
+    float spotLightDiffuse;
+    float spotLightSpecular;
+};
 
 
 void main() {
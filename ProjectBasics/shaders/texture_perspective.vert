@@ -4,19 +4,38 @@ layout (location=0) in vec3 vPosition;
 layout (location=1) in vec3 vNormal;
 layout (location=2) in vec2 vTexCoord;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+// The object's transforms, computed once on the CPU; see ObjectConstants in UniformBlocks.h.
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    mat4 modelViewProjection;
+    mat4 normalMatrix;
+};
+
+// Meshes with VertexFormat::Packed store unorm16 positions relative to their bounds, octahedral
+// normals in vNormal.xy, and half-float texture coordinates; see VertexPacking.h.
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
 
 out vec2 TexCoord;
 out vec3 Normal;
 
 void main() {
+    vec3 position = packedVertices ? positionOffset + vPosition * positionScale : vPosition;
+    vec3 normal = packedVertices ? octahedralDecode(vNormal.xy) : vNormal;
+
     // Transform the position to clip space.
-    gl_Position = projection * view * model * vec4(vPosition, 1.0);
+    gl_Position = modelViewProjection * vec4(position, 1.0);
     TexCoord = vTexCoord;
 
     // Transform the vertex normal to world space using the normal matrix.
-    mat4 normalMatrix = transpose(inverse(model));
-    Normal = mat3(normalMatrix) * vNormal;
+    Normal = mat3(normalMatrix) * normal;
 }
\ No newline at end of file